@@ -21,8 +21,10 @@
 #include <string.h>
 #include <errno.h>
 #include <paths.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -33,9 +35,13 @@
 #include <ostream>
 #include <string>
 #include <utility>
+#include <condition_variable>
 #include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
 
-#include "log/easelog_llqueue.h"
+#include "log/easelog_ringqueue.h"
 
 namespace logging {
 
@@ -49,17 +55,24 @@ namespace logging {
 // google styles禁止全局类初始化和销毁, 也不推荐使用Singleton模式, 主要是存在时序问题.
 // 所以在这里, 使用结构体来模拟全局类, 但是不提供初始化和销毁函数, 程序运行时就存在, 且不会被销毁.
 static struct LoggingSettings g_logging_settings = {
-    /* .log_file_path       = */ nullptr,
-    /* .log_file            = */ nullptr,
-    /* .log_min_level       = */ LOGGING_INFO,
-    /* .log_always_print    = */ LOGGING_ERROR,
-    /* .log_dest            = */ LOG_DEFAULT,
-    /* .log_process_id      = */ true,
-    /* .log_thread_id       = */ true,
-    /* .log_timestamp       = */ true,
-    /* .log_tickcount       = */ false,
-    /* .log_prefix          = */ nullptr,
-    /* .log_severity_names  = */ {"debug", "info", "warning", "error", "fatal"},
+    /* .log_file_path         = */ nullptr,
+    /* .log_file              = */ nullptr,
+    /* .log_min_level         = */ LOGGING_INFO,
+    /* .log_always_print      = */ LOGGING_ERROR,
+    /* .log_backtrace_trigger = */ LOGGING_ERROR,
+    /* .log_backtrace_size    = */ 0,
+    /* .log_dedup_window_ms   = */ 0,
+    /* .log_dedup_max_repeats = */ 0,
+    /* .log_dest              = */ LOG_DEFAULT,
+    /* .log_mode              = */ LOG_MODE_SYNC,
+    /* .log_async_rate        = */ 0,
+    /* .log_process_id        = */ true,
+    /* .log_thread_id         = */ true,
+    /* .log_timestamp         = */ true,
+    /* .log_tickcount         = */ false,
+    /* .log_prefix            = */ nullptr,
+    /* .log_vmodule           = */ nullptr,
+    /* .log_severity_names    = */ {"debug", "info", "warning", "error", "fatal"},
 };
 
 // 定义日志配置操作宏, 便于后续更改
@@ -74,51 +87,157 @@ const struct LoggingSettings &GetLoggingSettings()
 // warn: This is never instantiated, it's just used for EAT_STREAM_PARAMETERS to have
 // an object of the correct type on the LHS of the unused part of the ternary
 // operator.
-std::ostream *g_swallow_stream = nullptr;
+LogStream *g_swallow_stream = nullptr;
 
-// 定义无锁队列
-#define ASYNC_QUEUE_SIZE 4096
-static struct llqueue       g_log_free_queue;
-static struct llqueue       g_log_wait_queue;
-static struct llqueue_entry g_log_queue_entries[ASYNC_QUEUE_SIZE];
+// 允许构造日志消息的最低等级, 供LOG_IS_ON内联过滤, 和默认配置保持一致
+std::atomic< int32_t > g_log_create_level(LOGGING_INFO);
 
-// 初始化日志队列
-void InitLoggingQueue()
+// export: 按照最小日志等级计算ShouldCreateLogMessage()为真的最低等级.
+// 开启backtrace且没有输出目标时结果不是连续区间, 此时取下界, 多构造的消息在Flush中丢弃.
+// 实时订阅者要求的低等级日志也需要构造, 只发送给订阅者.
+int32_t GetLogCreateLevel(int32_t min_level)
 {
-    llqueue_init(&g_log_free_queue, g_log_queue_entries, ASYNC_QUEUE_SIZE);
-    llqueue_init(&g_log_wait_queue, g_log_queue_entries, ASYNC_QUEUE_SIZE);
-    for (uint32_t i = 0; i < ASYNC_QUEUE_SIZE; i++) {
-        llqueue_enqueue(&g_log_free_queue, i);
+    int32_t level = min_level;
+
+    if (log_settings.log_backtrace_size != 0) {
+        level = std::min(level, LOGGING_DEBUG);
+    } else if (log_settings.log_dest == LOG_NONE) {
+        level = std::max(level, log_settings.log_always_print);
     }
+    return std::min(level, std::max(GetLogTailMinSeverity(), LOGGING_DEBUG));
+}
+
+// export: 根据当前配置重新计算全局和所有命名日志对象的构造等级
+void UpdateLogCreateLevel()
+{
+    g_log_create_level.store(GetLogCreateLevel(log_settings.log_min_level),
+        std::memory_order_relaxed);
+    UpdateLoggerLevels();
 }
 
+// 定义日志队列, 槽位内联存放日志记录头部和日志内容, 不需要额外分配内存
+#define ASYNC_QUEUE_SIZE      1024
+#define ASYNC_QUEUE_DATA_SIZE 496
+alignas(RINGQUEUE_CACHELINE_SIZE) static uint8_t
+    g_log_queue_memory[RINGQUEUE_MEMSIZE(ASYNC_QUEUE_SIZE, ASYNC_QUEUE_DATA_SIZE)];
+static struct ringqueue *g_log_queue = nullptr;
+
 // 全局互斥锁
 static std::mutex g_log_mutex;
 
+// 后台线程模式: 生产者只入队, 由后台线程上锁输出. 条件变量由g_log_backend_mutex保护,
+// 加锁顺序为先g_log_mutex再g_log_backend_mutex, 后台线程不会同时持有两个锁.
+static std::atomic< bool >     g_log_async(false);
+static std::atomic< bool >     g_log_backend_sleeping(false);
+static std::mutex              g_log_backend_mutex;
+static std::condition_variable g_log_backend_cond;
+static std::thread            *g_log_backend      = nullptr;
+static bool                    g_log_backend_stop = false;
+// 协程生产者请求后台线程清空队列, 同步模式下也会处理一次
+static std::atomic< bool >     g_log_backend_request(false);
+
+// 等待刷新和等待队列空间的协程, 由g_log_waiter_mutex保护.
+// 登记等待者时在g_log_backend_mutex内获取, 加锁顺序为g_log_backend_mutex -> g_log_waiter_mutex
+static std::mutex g_log_waiter_mutex;
+static LogWaiter *g_log_flush_waiters = nullptr;
+static LogWaiter *g_log_space_waiters = nullptr;
+
+static void StartLogBackend();
+static void ResetLogDedupAfterFork();
+
+// fork之前获取日志锁, 保证子进程中的日志状态一致
+static void LogForkPrepare()
+{
+    g_log_mutex.lock();
+    g_log_backend_mutex.lock();
+}
+
+// fork之后在父进程中释放日志锁
+static void LogForkParent()
+{
+    g_log_backend_mutex.unlock();
+    g_log_mutex.unlock();
+}
+
+// 子进程中只剩下调用fork的线程, 后台线程和收集线程都不存在, 回到同步模式,
+// 清除缓存的进程ID和线程ID, 共享内存模式下重新占用环形队列
+static void LogForkChild()
+{
+    g_log_backend_mutex.unlock();
+    g_log_mutex.unlock();
+    new (&g_log_backend_cond) std::condition_variable();
+    g_log_async.store(false, std::memory_order_relaxed);
+    g_log_backend_sleeping.store(false, std::memory_order_relaxed);
+    g_log_backend_request.store(false, std::memory_order_relaxed);
+    g_log_backend = nullptr;
+    // 等待者属于父进程中的协程, 子进程中不再唤醒
+    new (&g_log_waiter_mutex) std::mutex();
+    g_log_flush_waiters = nullptr;
+    g_log_space_waiters = nullptr;
+    ResetLogProcessIds();
+    ResetLogDedupAfterFork();
+    ResetLogBinaryWriter();
+    ResetLogSharedMemoryAfterFork();
+    ResetLoggerRegistryAfterFork();
+    ResetVlogAfterFork();
+    ResetLogTailAfterFork();
+    ResetLogUringAfterFork();
+    ResetLogCompressAfterFork();
+}
+
+// 初始化日志队列和fork处理函数, 重复调用时不会重新初始化
+void InitLoggingQueue()
+{
+    static struct ringqueue *queue =
+        ringqueue_init(g_log_queue_memory, ASYNC_QUEUE_SIZE, ASYNC_QUEUE_DATA_SIZE);
+    static int g_log_atfork = pthread_atfork(LogForkPrepare, LogForkParent, LogForkChild);
+
+    (void)g_log_atfork;
+    g_log_queue = queue;
+}
+
 // export: 日志初始化函数, 用于设置日志配置
 bool BaseInitLoggingImpl(const LoggingSettings &settings)
 {
-    // MaybeInitializeVlogInfo();
+    // 日志路径由日志库持有一份拷贝, 调用者的字符串可以随时释放
+    static FilePath *g_log_file_path = nullptr;
+
+    std::lock_guard< std::mutex > lock(g_log_mutex);
+
+    // 重新初始化时关闭之前的日志文件, 下次写文件时按照新的配置打开
+    CloseLogFile();
     log_settings = settings;
+    UpdateLogCreateLevel();
+    MaybeInitializeVlogInfo(settings.log_vmodule);
+    // 最小日志等级可能改变了默认详细日志等级, 和SetMinLogLevel()一样让VLOG调用点重新解析
+    InvalidateVlogCallSites();
+    if (log_settings.log_mode == LOG_MODE_ASYNC) {
+        StartLogBackend();
+    } else if (log_settings.log_mode == LOG_MODE_SYNC) {
+        g_log_async.store(false, std::memory_order_relaxed);
+    }
 
     // Ignore file options unless logging to file is set.
     if ((log_settings.log_dest & LOG_TO_FILE) == 0) {
         return true;
     }
 
-    if (!log_settings.log_file_path) {
-        log_settings.log_file_path = new std::string("debug.log");
+    if (!g_log_file_path) {
+        g_log_file_path = new FilePath();
     }
-    *(log_settings.log_file_path) = *settings.log_file_path;
+    *g_log_file_path = settings.log_file_path ? *settings.log_file_path : FilePath("debug.log");
+    log_settings.log_file_path = g_log_file_path;
 
-    // return InitializeLogFileHandle();
-    return true;
+    return InitializeLogFileHandle();
 }
 
 // export: 设置日志等级
 void SetMinLogLevel(int32_t level)
 {
     log_settings.log_min_level = std::min(LOGGING_FATAL, level);
+    UpdateLogCreateLevel();
+    // 默认详细日志等级依赖最小日志等级, 需要让VLOG调用点重新解析
+    InvalidateVlogCallSites();
 }
 
 // export: 获取日志等级
@@ -130,14 +249,46 @@ int32_t GetMinLogLevel()
 // export: 设置日志输出等级
 bool ShouldCreateLogMessage(int32_t severity)
 {
+    // 实时订阅者要求的日志总是构造
+    if (UNLIKELY(IsLogTailActive()) && severity >= GetLogTailMinSeverity()) {
+        return true;
+    }
+
     if (severity < log_settings.log_min_level) {
-        return false;
+        // 开启backtrace时, 低等级日志仍然需要构造, 用于捕获到线程环形缓存中
+        return log_settings.log_backtrace_size != 0 && severity >= LOGGING_DEBUG;
     }
 
     // Return true here unless we know ~LogMessage won't do anything.
     return log_settings.log_dest != LOG_NONE || severity >= log_settings.log_always_print;
 }
 
+// export: LOG_EVERY_T限流判断, 多个线程同时到期时只有一个线程CAS成功
+bool LogEveryTShouldLog(std::atomic< uint64_t > &next_us, double seconds)
+{
+    uint64_t now_us = TickCountUs();
+    uint64_t next   = next_us.load(std::memory_order_relaxed);
+    uint64_t period = seconds > 0.0 ? static_cast< uint64_t >(seconds * 1000000.0) : 0;
+
+    if (now_us < next) {
+        return false;
+    }
+    return next_us.compare_exchange_strong(next, now_us + period, std::memory_order_relaxed);
+}
+
+// export: 生成LOG_SAMPLED使用的线程随机种子, 混合线程栈地址和时间戳
+uint64_t LogSampleSeed()
+{
+    int      stack_anchor = 0;
+    uint64_t seed         = TickCountUs() ^ reinterpret_cast< uintptr_t >(&stack_anchor);
+
+    // splitmix64 finalizer, 打散相邻线程的种子
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+    seed = seed ^ (seed >> 31);
+    return seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
 // Returns true when LOG_TO_STDERR flag is set, or |severity| is high.
 // If |severity| is high then true will be returned when no log destinations are
 // set, or only LOG_TO_FILE is set, since that is useful for local development
@@ -154,6 +305,45 @@ static inline bool ShouldLogToStderr(int32_t severity)
     return false;
 }
 
+// export: 设置backtrace模式, ring_size为0时关闭
+void SetLogBacktrace(uint32_t ring_size, LogSeverity trigger_severity)
+{
+    log_settings.log_backtrace_trigger = trigger_severity;
+    log_settings.log_backtrace_size    = ring_size;
+    UpdateLogCreateLevel();
+}
+
+// export: 设置重复日志合并, window_ms为0时关闭
+void SetLogDedup(uint32_t window_ms, uint32_t max_repeats)
+{
+    log_settings.log_dedup_window_ms   = window_ms;
+    log_settings.log_dedup_max_repeats = max_repeats;
+}
+
+// 需要等待落盘的最低日志等级, LOGGING_NUM_SEVERITIES表示关闭
+static std::atomic< int32_t > g_log_sync_severity(LOGGING_NUM_SEVERITIES);
+
+// export: 设置需要等待落盘的最低日志等级
+void SetLogFileSync(LogSeverity severity)
+{
+    g_log_sync_severity.store(severity, std::memory_order_relaxed);
+}
+
+// 日志内容的转义选项, 见SetLogSanitize()
+static std::atomic< uint32_t > g_log_sanitize(LOG_SANITIZE_NONE);
+
+// export: 设置日志内容的转义选项
+void SetLogSanitize(uint32_t flags)
+{
+    g_log_sanitize.store(flags, std::memory_order_relaxed);
+}
+
+// export: 获取日志内容的转义选项
+uint32_t GetLogSanitize()
+{
+    return g_log_sanitize.load(std::memory_order_relaxed);
+}
+
 // export: 设置日志信息配置
 void SetLogItems(bool enable_process_id, bool enable_thread_id, bool enable_timestamp,
     bool enable_tickcount)
@@ -171,6 +361,18 @@ void SetLogPrefix(const char *prefix)
     log_settings.log_prefix = prefix;
 }
 
+// Returns the LoggingDestination bits (LOG_TO_STDERR, LOG_TO_FILE) a record
+// of |severity| is written to.
+static inline uint32_t GetLogSinks(int32_t severity)
+{
+    uint32_t sinks = log_settings.log_dest & LOG_TO_FILE;
+
+    if (ShouldLogToStderr(severity)) {
+        sinks |= LOG_TO_STDERR;
+    }
+    return sinks;
+}
+
 static void WriteToFd(int fd, const char *data, size_t length)
 {
     size_t bytes_written = 0;
@@ -185,21 +387,930 @@ static void WriteToFd(int fd, const char *data, size_t length)
     }
 }
 
+// 写入时间戳和日志内容, 使用writev合并为一次系统调用, 部分写入时补齐剩余部分
+static void WriteLineToFd(int fd, const std::string &timestamp, const char *data, size_t length)
+{
+    struct iovec iov[2];
+    long         rv;
+
+    iov[0].iov_base = const_cast< char * >(timestamp.data());
+    iov[0].iov_len  = timestamp.size();
+    iov[1].iov_base = const_cast< char * >(data);
+    iov[1].iov_len  = length;
+    HANDLE_EINTR(rv, writev(fd, iov, 2));
+    if (rv < 0) {
+        return;
+    }
+
+    size_t written = static_cast< size_t >(rv);
+    if (written < timestamp.size()) {
+        WriteToFd(fd, timestamp.data() + written, timestamp.size() - written);
+        written = timestamp.size();
+    }
+    written -= timestamp.size();
+    if (written < length) {
+        WriteToFd(fd, data + written, length - written);
+    }
+}
+
+// 最近一条输出日志的时间, 由g_log_mutex保护
+static struct timeval g_log_last_tv;
+
+// 生成输出时间戳, 调用者需要持有g_log_mutex. 时间取生成日志的时间, 并发入队时可能比上一条
+// 输出的日志稍早, 此时沿用上一条的时间, 保证输出的时间戳不乱序.
+static void LogOutputTimestampLocked(const struct timeval &tv, std::string &timestamp)
+{
+    if (timercmp(&tv, &g_log_last_tv, >)) {
+        g_log_last_tv = tv;
+    }
+    LogSyslogPrefixTimestamp(log_settings, g_log_last_tv, timestamp);
+}
+
+// 日志队列中的日志记录头部, 日志内容紧跟在头部之后
+struct LogRecord {
+    const char    *file;             // 调用点文件名, 和行号一起用于重复日志合并
+    const char    *func;             // 调用点函数名, 用于二进制日志文件的调用点字典
+    int32_t        line;             // 调用点行号
+    LogSeverity    severity;         // 日志等级
+    uint32_t       sinks;            // 日志输出目的地
+    uint32_t       message_start;    // 日志内容(不包含前缀)起始位置
+    uint64_t       payload_hash;     // 日志内容摘要, 不包含前缀
+    uint32_t       length;           // 日志长度, 包括前缀和尾部换行符
+    uint32_t       coalesce;         // 是否参与重复日志合并
+    char          *external;         // 槽位放不下时, 日志内容存放在slab内存中
+    struct timeval tv;               // 生成日志的时间
+    int32_t        tid;              // 生成日志的线程ID
+    uint32_t       thread_name;      // 日志内容之后的线程名字长度(包括'\0'), 0表示没有
+};
+
+// 写入一行日志到二进制日志文件, 有日志记录时只保存调用点和日志内容, 否则保存整行文本
+static void WriteBinaryLineLocked(uint32_t severity_mask, const std::string &timestamp,
+    const char *data, size_t length, const LogRecord *record)
+{
+    LogBinaryLine line;
+
+    memset(&line, 0, sizeof(line));
+    line.tv            = g_log_last_tv;
+    line.severity_mask = severity_mask;
+    line.timestamp     = !timestamp.empty();
+    line.text          = data;
+    line.length        = length != 0 && data[length - 1] == '\n' ? length - 1 : length;
+    if (record != nullptr) {
+        line.file     = record->file;
+        line.func     = record->func;
+        line.line     = record->line;
+        line.severity = record->severity;
+        line.tid      = record->tid;
+        line.text     = data + record->message_start;
+        line.length   = record->length - record->message_start - 1;
+    }
+
+    const std::string &frame = EncodeLogBinaryLineLocked(line);
+    if (IsLogFileCompressed()) {
+        LogCompressWriteLocked(frame.data(), frame.size());
+    } else if (IsLogFileUringActive()) {
+        LogUringWriteLocked(frame.data(), frame.size());
+    } else {
+        WriteToFd(GetLogFileFd(), frame.data(), frame.size());
+    }
+    NoteLogFileWrite(g_log_last_tv, severity_mask, frame.size());
+}
+
+// 写入一行日志到指定的输出目的地, 调用者需要持有g_log_mutex.
+// severity_mask是这一行包含的日志等级, 用于日志文件的时间索引.
+// record是这一行对应的日志记录, 二进制日志文件用来保存调用点信息, 可以为空.
+static void WriteToLogSinksLocked(uint32_t sinks, uint32_t severity_mask,
+    const std::string &timestamp, const char *data, size_t length, const LogRecord *record)
+{
+    if (sinks & LOG_TO_STDERR) {
+        WriteLineToFd(STDERR_FILENO, timestamp, data, length);
+    }
+    // 日志文件按需打开, 打开失败时丢弃文件输出
+    if ((sinks & LOG_TO_FILE) && InitializeLogFileHandle()) {
+        if (IsLogFileBinary()) {
+            WriteBinaryLineLocked(severity_mask, timestamp, data, length, record);
+            return;
+        }
+        if (IsLogFileCompressed()) {
+            LogCompressWriteLocked(timestamp.data(), timestamp.size());
+            LogCompressWriteLocked(data, length);
+        } else if (IsLogFileUringActive()) {
+            LogUringWriteLocked(timestamp.data(), timestamp.size());
+            LogUringWriteLocked(data, length);
+        } else {
+            WriteLineToFd(GetLogFileFd(), timestamp, data, length);
+        }
+        NoteLogFileWrite(g_log_last_tv, severity_mask, timestamp.size() + length);
+    }
+}
+
+// backtrace环形缓存的单条记录, 只保留调用点, 记录时的时间和日志内容, 输出时再格式化前缀
+struct LogBacktraceEntry {
+    struct timeval tv;
+    uint64_t       tickcount;    // 只在开启log_tickcount时记录
+    const char    *file;
+    const char    *func;
+    int32_t        line;
+    LogSeverity    severity;
+    std::string    text;         // 日志内容, 包括日志上下文和尾部换行符, 不包括前缀
+};
+
+// 线程私有的backtrace环形缓存, 记录被抑制的低等级日志.
+// 缓存条目的字符串复用已有容量, 预热后捕获日志不会再分配内存, 也不需要上锁.
+struct LogBacktraceRing {
+    std::vector< LogBacktraceEntry > entries;
+    uint32_t                         head;     // 下一个写入位置
+    uint32_t                         count;    // 有效条目数量
+};
+
+static thread_local LogBacktraceRing g_log_backtrace;
+
+// 判断日志是否只需要捕获到backtrace缓存中, VLOG日志(负数等级)不参与.
+// min_level是日志所属的最小日志等级, 命名日志对象可以单独设置.
+static inline bool ShouldCaptureBacktrace(LogSeverity severity, int32_t min_level)
+{
+    return log_settings.log_backtrace_size != 0 && severity >= LOGGING_DEBUG &&
+        severity < min_level;
+}
+
+// 捕获一条低等级日志到当前线程的backtrace缓存中, 满了之后覆盖最旧的记录
+static void CaptureLogBacktrace(const char *file, const char *func, int32_t line,
+    LogSeverity severity, const char *text, size_t length)
+{
+    LogBacktraceRing &ring = g_log_backtrace;
+    uint32_t          size = log_settings.log_backtrace_size;
+
+    if (UNLIKELY(ring.entries.size() != size)) {
+        ring.entries.resize(size);
+        ring.head  = 0;
+        ring.count = 0;
+    }
+
+    LogBacktraceEntry &entry = ring.entries[ring.head];
+    gettimeofday(&entry.tv, nullptr);
+    entry.tickcount = log_settings.log_tickcount ? TickCountUs() : 0;
+    entry.file      = file;
+    entry.func      = func;
+    entry.line      = line;
+    entry.severity  = severity;
+    entry.text.assign(text, length);
+    ring.head  = (ring.head + 1) % size;
+    ring.count = std::min(ring.count + 1, size);
+}
+
+// 输出当前线程的backtrace缓存, 调用者需要持有g_log_mutex, 保证输出连续
+static void DumpLogBacktraceLocked(uint32_t sinks)
+{
+    LogBacktraceRing &ring = g_log_backtrace;
+    uint32_t          size = static_cast< uint32_t >(ring.entries.size());
+
+    if (ring.count == 0) {
+        return;
+    }
+
+    std::string empty;
+    std::string marker =
+        "----- backtrace begin: " + std::to_string(ring.count) + " suppressed records -----\n";
+    WriteToLogSinksLocked(sinks, LOG_SEVERITY_MASK_ALL, empty, marker.data(), marker.size(),
+        nullptr);
+
+    // 记录时的时间戳作为文本的一部分输出, 输出时间戳只用于单调递增的输出时间.
+    // 捕获的日志在这里才生成前缀, 缓存属于当前线程, 线程名字和线程ID和记录时相同
+    uint32_t index = (ring.head + size - ring.count) % size;
+    for (uint32_t i = 0; i < ring.count; i++) {
+        const LogBacktraceEntry &entry = ring.entries[index];
+        LogStream                stream;
+        std::string             &line = stream.buffer();
+        LogSyslogPrefixTimestamp(log_settings, entry.tv, line);
+        AppendLogPrefix(stream, log_settings, entry.severity, entry.file, entry.func, entry.line,
+            entry.tickcount);
+        line += entry.text;
+        WriteToLogSinksLocked(sinks, LOG_SEVERITY_MASK_ALL, empty, line.data(), line.size(),
+            nullptr);
+        index = (index + 1) % size;
+    }
+    ring.count = 0;
+
+    marker = "----- backtrace end -----\n";
+    WriteToLogSinksLocked(sinks, LOG_SEVERITY_MASK_ALL, empty, marker.data(), marker.size(),
+        nullptr);
+}
+
+// 重复日志合并状态, 记录最近一条输出日志的调用点和内容摘要, 由g_log_mutex保护
+struct LogDedupState {
+    const char *file;           // 调用点文件名, 和行号一起标识调用点
+    int32_t     line;           // 调用点行号
+    uint32_t    repeats;        // 已经合并的重复次数
+    uint32_t    sinks;          // 第一条日志的输出目的地, 合并记录输出到相同的目的地
+    int32_t     tid;            // 第一条日志的线程ID, 不同线程的日志不合并
+    uint64_t    hash;           // 日志内容摘要, 不包含前缀
+    uint64_t    first_us;       // 第一条日志的时间
+    uint64_t    last_us;        // 最近一条重复日志的时间
+    std::string prefix;         // 第一条日志的前缀, 用于输出合并记录
+};
+
+static LogDedupState g_log_dedup;
+
+// 计算日志内容摘要, FNV-1a 64位哈希
+static uint64_t HashLogPayload(const char *data, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast< uint8_t >(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// 输出等待中的合并记录, 并且结束当前的重复序列, 调用者需要持有g_log_mutex
+static void FlushLogDedupLocked()
+{
+    LogDedupState &state = g_log_dedup;
+
+    if (state.repeats != 0) {
+        struct timeval tv;
+        std::string    timestamp;
+        gettimeofday(&tv, nullptr);
+        LogOutputTimestampLocked(tv, timestamp);
+        std::string summary = state.prefix + "last message repeated " +
+            std::to_string(state.repeats) + " times over " +
+            std::to_string((state.last_us - state.first_us) / 1000) + " ms\n";
+        WriteToLogSinksLocked(state.sinks, LOG_SEVERITY_MASK_ALL, timestamp, summary.data(),
+            summary.size(), nullptr);
+    }
+    state.file    = nullptr;
+    state.repeats = 0;
+}
+
+// fork之后在子进程中丢弃父进程的重复序列, 合并记录由父进程输出
+static void ResetLogDedupAfterFork()
+{
+    g_log_dedup.file    = nullptr;
+    g_log_dedup.repeats = 0;
+}
+
+// 等待io_uring写入和压缩写入完成, 之后的fdatasync覆盖所有已经输出的日志,
+// 调用者需要持有g_log_mutex
+static void WaitLogFileWritesLocked()
+{
+    WaitLogUringLocked();
+    WaitLogCompressLocked();
+    NoteLogFileCompleted();
+}
+
+// 进程退出时输出队列中的日志和等待中的合并记录
+static void FlushLogDedupAtExit()
+{
+    std::unique_lock< std::mutex > lock = LockLogOutput();
+    FlushLogDedupLocked();
+    WaitLogFileWritesLocked();
+}
+
+// 判断日志是否和上一条输出日志重复, 重复时只计数, 返回true表示无需输出.
+// 不重复时结束之前的重复序列, 并且把当前日志作为新序列的第一条.
+static bool CoalesceRepeatedLocked(const LogRecord &record, const char *text)
+{
+    static bool g_log_dedup_atexit = false;
+
+    LogDedupState &state  = g_log_dedup;
+    uint64_t       now_us = TickCountUs();
+    uint64_t       window = static_cast< uint64_t >(log_settings.log_dedup_window_ms) * 1000;
+    uint32_t       limit  = log_settings.log_dedup_max_repeats;
+
+    if (state.file == record.file && state.line == record.line && state.tid == record.tid &&
+        state.hash == record.payload_hash && now_us - state.first_us < window &&
+        (limit == 0 || state.repeats < limit)) {
+        state.repeats++;
+        state.last_us = now_us;
+        return true;
+    }
+
+    FlushLogDedupLocked();
+    if (!g_log_dedup_atexit) {
+        atexit(FlushLogDedupAtExit);
+        g_log_dedup_atexit = true;
+    }
+    state.file     = record.file;
+    state.line     = record.line;
+    state.sinks    = record.sinks;
+    state.tid      = record.tid;
+    state.hash     = record.payload_hash;
+    state.first_us = now_us;
+    state.last_us  = now_us;
+    state.prefix.assign(text, record.message_start);
+    return false;
+}
+
+// 当前线程登记名字时的线程ID, fork之后线程ID改变, 需要重新登记
+static thread_local int32_t g_log_thread_registered = 0;
+
+#if defined(EASELOG_TEST_HOOKS)
+// 测试注入的等待函数, 只在测试程序中编译, 用于构造并发时序
+static std::atomic< void (*)(uint32_t) > g_log_test_delay(nullptr);
+
+// export: 设置测试注入的等待函数, 为空时不等待
+void SetLogTestDelay(void (*delay)(uint32_t point))
+{
+    g_log_test_delay.store(delay, std::memory_order_relaxed);
+}
+
+// export: 执行测试注入的等待函数, 没有设置时直接返回
+void RunLogTestDelay(uint32_t point)
+{
+    void (*delay)(uint32_t) = g_log_test_delay.load(std::memory_order_relaxed);
+    if (delay != nullptr) {
+        delay(point);
+    }
+}
+#endif    // EASELOG_TEST_HOOKS
+
+// 输出一条日志记录, 调用者需要持有g_log_mutex. 记录带有线程名字时先登记名字,
+// 二进制日志文件的线程字典使用, 生产者不需要为登记获取日志锁
+static void WriteLogRecordLocked(const LogRecord &record, const char *text, const char *name)
+{
+    if (UNLIKELY(record.thread_name != 0)) {
+        RegisterLogThreadLocked(record.tid, name);
+    }
+    // 重复日志只计数, 在重复序列结束时输出一条合并记录
+    if (record.coalesce) {
+        if (CoalesceRepeatedLocked(record, text)) {
+            return;
+        }
+    } else if (UNLIKELY(g_log_dedup.file != nullptr)) {
+        FlushLogDedupLocked();
+    }
+    std::string timestamp;
+    LogOutputTimestampLocked(record.tv, timestamp);
+    LogTestDelay(LOG_TEST_POINT_WRITE);
+    // 写入日志信息
+    WriteToLogSinksLocked(record.sinks, LogSeverityMask(record.severity), timestamp, text,
+        record.length, &record);
+}
+
+// 日志记录入队, 成功时返回队列位置, 队列满或者内存超过上限时返回false.
+// 槽位放不下的日志复制到slab内存中, 由输出日志的线程释放. 线程名字保存在日志内容之后.
+static bool EnqueueLogRecord(LogRecord &record, const char *text, const char *name,
+    uint64_t *pos)
+{
+    uint32_t size        = record.length + record.thread_name;
+    bool     inline_text = sizeof(LogRecord) + size <= g_log_queue->data_size;
+
+    if (!inline_text) {
+        record.external = static_cast< char * >(LogSlabAlloc(size));
+        if (record.external == nullptr) {
+            return false;
+        }
+    }
+    if (ringqueue_reserve(g_log_queue, 1, pos) == 0) {
+        if (record.external != nullptr) {
+            LogSlabFree(record.external);
+            record.external = nullptr;
+        }
+        return false;
+    }
+
+    struct ringqueue_slot *slot = ringqueue_slot_at(g_log_queue, *pos);
+    char                  *data = reinterpret_cast< char * >(ringqueue_slot_data(slot));
+    char                  *copy = inline_text ? data + sizeof(LogRecord) : record.external;
+    memcpy(copy, text, record.length);
+    memcpy(copy + record.length, name, record.thread_name);
+    memcpy(data, &record, sizeof(LogRecord));
+    slot->len = static_cast< uint32_t >(sizeof(LogRecord)) + (inline_text ? size : 0);
+    ringqueue_publish(g_log_queue, *pos);
+    return true;
+}
+
+// 自适应模式的统计窗口, 由g_log_mutex保护
+#define LOG_ADAPTIVE_WINDOW_US     100000
+#define LOG_ADAPTIVE_ENTER_WINDOWS 2
+#define LOG_ADAPTIVE_EXIT_WINDOWS  10
+#define LOG_ADAPTIVE_DEFAULT_RATE  20000
+
+struct LogAdaptiveState {
+    uint64_t window_start_us;    // 当前窗口的起始时间
+    uint64_t records;            // 窗口内输出的日志数量
+    uint64_t locks;              // 窗口内生产者上锁的次数
+    uint32_t hot_windows;        // 连续高负载的窗口数量
+    uint32_t idle_windows;       // 连续低负载的窗口数量
+};
+
+static LogAdaptiveState g_log_adaptive;
+
+// 生产者上锁时的竞争统计, 在锁外累加
+static std::atomic< uint64_t > g_log_lock_contended(0);
+static std::atomic< uint64_t > g_log_lock_wait_us(0);
+
+// 生产者获取日志锁, 先尝试加锁, 失败时记录等待时间
+static void LockLogMutex()
+{
+    if (LIKELY(g_log_mutex.try_lock())) {
+        return;
+    }
+
+    uint64_t start_us = TickCountUs();
+    g_log_mutex.lock();
+    g_log_lock_contended.fetch_add(1, std::memory_order_relaxed);
+    g_log_lock_wait_us.fetch_add(TickCountUs() - start_us, std::memory_order_relaxed);
+}
+
+// 每个统计窗口结束时判断是否切换模式, 调用者需要持有g_log_mutex.
+// 同步模式下, 日志速率超过阈值, 或者四分之一的上锁需要等待且等待时间超过窗口的十分之一,
+// 连续两个窗口后启动后台线程. 后台线程模式下, 速率低于阈值的四分之一连续十个窗口后回到
+// 同步模式, 两个方向的阈值和窗口数量不同, 避免在临界负载附近来回切换.
+static void UpdateLogModeLocked(uint32_t records)
+{
+    LogAdaptiveState &state = g_log_adaptive;
+
+    state.records += records;
+    uint64_t now_us  = TickCountUs();
+    uint64_t elapsed = now_us - state.window_start_us;
+    if (elapsed < LOG_ADAPTIVE_WINDOW_US) {
+        return;
+    }
+
+    uint64_t contended = g_log_lock_contended.exchange(0, std::memory_order_relaxed);
+    uint64_t wait_us   = g_log_lock_wait_us.exchange(0, std::memory_order_relaxed);
+    uint64_t rate      = state.records * 1000000 / elapsed;
+    uint64_t threshold = log_settings.log_async_rate != 0 ? log_settings.log_async_rate
+                                                          : LOG_ADAPTIVE_DEFAULT_RATE;
+    uint64_t locks     = state.locks;
+
+    state.window_start_us = now_us;
+    state.records         = 0;
+    state.locks           = 0;
+
+    if (!g_log_async.load(std::memory_order_relaxed)) {
+        bool hot = rate >= threshold || (contended * 4 >= locks && wait_us * 10 >= elapsed);
+        state.hot_windows = hot ? state.hot_windows + 1 : 0;
+        if (state.hot_windows >= LOG_ADAPTIVE_ENTER_WINDOWS) {
+            state.hot_windows = 0;
+            StartLogBackend();
+        }
+    } else {
+        bool idle          = rate < threshold / 4;
+        state.idle_windows = idle ? state.idle_windows + 1 : 0;
+        if (state.idle_windows >= LOG_ADAPTIVE_EXIT_WINDOWS) {
+            // 后台线程在下一次循环中停放
+            state.idle_windows = 0;
+            g_log_async.store(false, std::memory_order_relaxed);
+        }
+    }
+}
+
+// 批量取出队列中的日志记录并输出, 调用者需要持有g_log_mutex.
+// 入队的线程随后都会上锁清空队列, 持有锁的线程顺带输出其他线程的日志(flat combining).
+// end之前的记录必须全部输出, 其他线程已经占用但是还没有发布的槽位需要等待.
+static void DrainLogQueueLocked(uint64_t end)
+{
+    uint64_t pos;
+    uint32_t count;
+    uint32_t records = 0;
+
+    for (;;) {
+        count = ringqueue_acquire(g_log_queue, 32, &pos);
+        if (count == 0) {
+            if (g_log_queue->tail.load(std::memory_order_relaxed) >= end) {
+                SubmitLogUringLocked();
+                LogSlabFlushFrees();
+                if (log_settings.log_mode == LOG_MODE_ADAPTIVE) {
+                    UpdateLogModeLocked(records);
+                }
+                return;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            struct ringqueue_slot *slot = ringqueue_slot_at(g_log_queue, pos + i);
+            const char            *data = reinterpret_cast< char * >(ringqueue_slot_data(slot));
+            LogRecord              record;
+            memcpy(&record, data, sizeof(LogRecord));
+            // 槽位中的数据在释放槽位之前输出, slab内存在释放槽位之后归还
+            const char *text = record.external ? record.external : data + sizeof(LogRecord);
+            WriteLogRecordLocked(record, text, text + record.length);
+            ringqueue_release(g_log_queue, pos + i);
+            if (record.external != nullptr) {
+                LogSlabFree(record.external);
+            }
+        }
+        records += count;
+    }
+}
+
+// 唤醒链表中的等待者, 唤醒函数可能释放等待者, 先取出下一个节点
+static void WakeLogWaiters(LogWaiter *waiter)
+{
+    while (waiter != nullptr) {
+        LogWaiter *next = waiter->next;
+        waiter->wake(waiter);
+        waiter = next;
+    }
+}
+
+// 清空队列并唤醒等待者. 等待刷新的协程需要等待登记之前入队的日志全部输出,
+// 等待队列空间的协程在队列清空之后全部唤醒, 之后登记的等待者会再次请求后台线程.
+static void ServeLogBackend()
+{
+    LogWaiter *flush;
+    LogWaiter *space;
+    uint64_t   end = 0;
+
+    {
+        std::lock_guard< std::mutex > lock(g_log_waiter_mutex);
+        flush               = g_log_flush_waiters;
+        space               = g_log_space_waiters;
+        g_log_flush_waiters = nullptr;
+        g_log_space_waiters = nullptr;
+    }
+    for (LogWaiter *waiter = flush; waiter != nullptr; waiter = waiter->next) {
+        end = std::max(end, waiter->end);
+    }
+
+    {
+        std::lock_guard< std::mutex > log_lock(g_log_mutex);
+        DrainLogQueueLocked(end);
+        if (flush != nullptr) {
+            WaitLogFileWritesLocked();
+        }
+    }
+    WakeLogWaiters(flush);
+    WakeLogWaiters(space);
+}
+
+// 后台线程, 后台线程模式下循环清空队列, 队列空时等待唤醒, 最多等待一个统计窗口,
+// 保证自适应模式在没有日志时也能切换回同步模式. 同步模式下停放, 等待再次启用,
+// 停放期间只处理协程生产者的请求.
+static void LogBackendMain()
+{
+    std::unique_lock< std::mutex > lock(g_log_backend_mutex);
+
+    while (!g_log_backend_stop) {
+        bool request = g_log_backend_request.exchange(false, std::memory_order_acquire);
+        if (!request && !g_log_async.load(std::memory_order_relaxed)) {
+            // 只使用带超时的等待, 停放期间每秒醒来检查一次
+            g_log_backend_cond.wait_for(lock, std::chrono::seconds(1));
+            continue;
+        }
+
+        lock.unlock();
+        ServeLogBackend();
+        lock.lock();
+        if (!g_log_async.load(std::memory_order_relaxed)) {
+            continue;
+        }
+
+        // 先设置等待标记再检查队列, 和生产者入队后检查标记配对, 不会丢失唤醒
+        g_log_backend_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ringqueue_count(g_log_queue) == 0 && !g_log_backend_stop &&
+            !g_log_backend_request.load(std::memory_order_relaxed)) {
+            g_log_backend_cond.wait_for(lock, std::chrono::microseconds(LOG_ADAPTIVE_WINDOW_US));
+        }
+        g_log_backend_sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+// 生产者入队后唤醒等待中的后台线程
+static inline void WakeLogBackend()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (g_log_backend_sleeping.load(std::memory_order_relaxed)) {
+        // 获取一次锁, 保证后台线程已经进入等待或者还没有检查队列
+        { std::lock_guard< std::mutex > lock(g_log_backend_mutex); }
+        g_log_backend_cond.notify_one();
+    }
+}
+
+// 进程退出时停止后台线程, 并且输出队列中剩余的日志
+static void StopLogBackend()
+{
+    std::thread *backend;
+
+    {
+        std::lock_guard< std::mutex > lock(g_log_backend_mutex);
+        g_log_backend_stop = true;
+        g_log_async.store(false, std::memory_order_relaxed);
+        backend       = g_log_backend;
+        g_log_backend = nullptr;
+    }
+    g_log_backend_cond.notify_all();
+    if (backend != nullptr) {
+        backend->join();
+        delete backend;
+    }
+
+    {
+        std::lock_guard< std::mutex > lock(g_log_mutex);
+        DrainLogQueueLocked(0);
+        FlushLogDedupLocked();
+        WaitLogFileWritesLocked();
+    }
+    // 停止之后不再登记等待者, 唤醒剩余的等待者
+    ServeLogBackend();
+}
+
+// 创建后台线程, 调用者需要持有g_log_backend_mutex
+static void CreateLogBackendLocked()
+{
+    if (g_log_backend == nullptr) {
+        // 日志队列可能还没有初始化
+        InitLoggingQueue();
+        g_log_backend = new std::thread(LogBackendMain);
+        atexit(StopLogBackend);
+    }
+}
+
+// 启动或者唤醒后台线程, 切换到后台线程模式
+static void StartLogBackend()
+{
+    std::lock_guard< std::mutex > lock(g_log_backend_mutex);
+
+    if (g_log_backend_stop) {
+        return;
+    }
+    CreateLogBackendLocked();
+    g_log_async.store(true, std::memory_order_relaxed);
+    g_log_backend_cond.notify_one();
+}
+
+// 请求后台线程清空队列并处理等待者, 不切换模式. 等待者在持有g_log_backend_mutex时登记,
+// 后台线程停止之后返回false, 不登记等待者.
+static bool RequestLogBackend(LogWaiter **list, LogWaiter *waiter)
+{
+    std::lock_guard< std::mutex > lock(g_log_backend_mutex);
+
+    if (g_log_backend_stop) {
+        return false;
+    }
+    if (waiter != nullptr) {
+        std::lock_guard< std::mutex > waiter_lock(g_log_waiter_mutex);
+        waiter->next = *list;
+        *list        = waiter;
+    }
+    CreateLogBackendLocked();
+    g_log_backend_request.store(true, std::memory_order_release);
+    g_log_backend_cond.notify_one();
+    return true;
+}
+
+// export: 设置日志输出模式
+void SetLogMode(LogMode mode, uint32_t async_rate)
+{
+    std::lock_guard< std::mutex > lock(g_log_mutex);
+
+    log_settings.log_mode       = mode;
+    log_settings.log_async_rate = async_rate;
+    g_log_adaptive              = LogAdaptiveState();
+    if (mode == LOG_MODE_ASYNC) {
+        StartLogBackend();
+    } else {
+        // 自适应模式从同步模式开始, 后台线程在下一次循环中停放
+        g_log_async.store(false, std::memory_order_relaxed);
+    }
+}
+
+// export: 获取日志输出模式
+LogMode GetLogMode()
+{
+    return log_settings.log_mode;
+}
+
+// export: 判断日志是否由后台线程输出
+bool IsLogBackendActive()
+{
+    return g_log_async.load(std::memory_order_relaxed);
+}
+
+// export: 等待调用之前入队的日志全部输出
+void FlushLog()
+{
+    if (g_log_queue == nullptr) {
+        return;
+    }
+
+    uint64_t end = g_log_queue->head.load(std::memory_order_acquire);
+    std::lock_guard< std::mutex > lock(g_log_mutex);
+    DrainLogQueueLocked(end);
+    // 结束当前的重复序列, 输出等待中的合并记录
+    FlushLogDedupLocked();
+    // io_uring写入和压缩写入的日志也要等待写入完成
+    WaitLogFileWritesLocked();
+}
+
+// export: 不阻塞的FlushLog(), 返回false时登记等待者, 由后台线程在日志输出之后唤醒
+bool FlushLogAsync(LogWaiter *waiter)
+{
+    if (g_log_queue == nullptr) {
+        return true;
+    }
+
+    waiter->end = g_log_queue->head.load(std::memory_order_acquire);
+    if (!RequestLogBackend(&g_log_flush_waiters, waiter)) {
+        // 进程退出时后台线程已经停止, 直接输出
+        FlushLog();
+        return true;
+    }
+    return false;
+}
+
+// export: 判断日志队列是否有空闲槽位
+bool HasLogQueueSpace()
+{
+    return g_log_queue == nullptr || ringqueue_count(g_log_queue) < g_log_queue->entries_sz;
+}
+
+// export: 队列满时登记等待者, 由后台线程在清空队列之后唤醒
+bool WaitLogQueueSpaceAsync(LogWaiter *waiter)
+{
+    InitLoggingQueue();
+    return !RequestLogBackend(&g_log_space_waiters, waiter);
+}
+
+// export: 重新入队CO_LOG()保存的日志记录, 队列仍然满并且不需要等待时返回false
+bool SubmitLogPendingRecord(LogPendingRecord *pending, bool wait)
+{
+    if (pending->data.empty()) {
+        return true;
+    }
+
+    LogRecord record;
+    memcpy(&record, pending->data.data(), sizeof(LogRecord));
+    const char *text = pending->data.data() + sizeof(LogRecord);
+    uint64_t    pos;
+    if (EnqueueLogRecord(record, text, text + record.length, &pos)) {
+        if (!RequestLogBackend(nullptr, nullptr)) {
+            std::lock_guard< std::mutex > lock(g_log_mutex);
+            DrainLogQueueLocked(pos + 1);
+        }
+    } else if (wait || HasLogQueueSpace()) {
+        // 不能挂起或者超过队列内存上限时直接写入, 先清空队列保证顺序
+        std::lock_guard< std::mutex > lock(g_log_mutex);
+        g_log_adaptive.locks++;
+        DrainLogQueueLocked(0);
+        WriteLogRecordLocked(record, text, text + record.length);
+        SubmitLogUringLocked();
+    } else {
+        return false;
+    }
+    pending->data.clear();
+    return true;
+}
+
+// export: 获取日志锁, 并且输出当前进程队列中的日志, 用于输出其他进程收集的日志
+std::unique_lock< std::mutex > LockLogOutput()
+{
+    InitLoggingQueue();
+
+    std::unique_lock< std::mutex > lock(g_log_mutex);
+    DrainLogQueueLocked(0);
+    return lock;
+}
+
+// export: 尝试获取日志锁, 获取失败时返回的锁不持有日志锁, 不输出队列中的日志
+std::unique_lock< std::mutex > TryLockLogOutput()
+{
+    return std::unique_lock< std::mutex >(g_log_mutex, std::try_to_lock);
+}
+
+// export: 输出一条其他进程收集的日志, 按照当前进程的配置选择输出目的地,
+// 调用者需要通过LockLogOutput()持有日志锁
+void WriteCollectedLogRecordLocked(LogSeverity severity, const struct timeval &tv,
+    const char *text, size_t length)
+{
+    uint32_t sinks = GetLogSinks(severity);
+
+    if (sinks == LOG_NONE) {
+        return;
+    }
+    if (UNLIKELY(g_log_dedup.file != nullptr)) {
+        FlushLogDedupLocked();
+    }
+    std::string timestamp;
+    LogOutputTimestampLocked(tv, timestamp);
+    WriteToLogSinksLocked(sinks, LogSeverityMask(severity), timestamp, text, length, nullptr);
+}
+
+// 崩溃时写入日志文件, 使用io_uring时先写入还没有提交的缓冲区, 再按偏移同步写入,
+// 压缩写入时写入不压缩的帧
+static void EmergencyWriteLogFile(int text_fd, const char *data, size_t length)
+{
+    if (text_fd < 0) {
+        return;
+    }
+    if (IsLogFileCompressed()) {
+        LogCompressEmergencyWriteLocked(data, length);
+    } else if (IsLogFileUringActive()) {
+        LogUringEmergencyWriteLocked(data, length);
+    } else {
+        WriteToFd(text_fd, data, length);
+    }
+}
+
+// export: 崩溃时尽力输出日志管道中缓存的内容, 可能在信号处理函数中调用.
+// 只在能够拿到日志锁时输出等待中的重复日志合并记录和队列中还没有输出的日志(没有时间戳),
+// 不分配内存, 也不归还slab内存, 最后同步日志文件. 二进制格式的日志文件不写入文本.
+void LogEmergencyFlush()
+{
+    int fd      = GetLogFileFd();
+    int text_fd = IsLogFileBinary() ? -1 : fd;
+
+    if (g_log_mutex.try_lock()) {
+        if (IsLogFileUringActive()) {
+            LogUringEmergencyWriteLocked(nullptr, 0);
+        }
+        if (IsLogFileCompressed()) {
+            LogCompressEmergencyWriteLocked(nullptr, 0);
+        }
+
+        LogDedupState &state = g_log_dedup;
+        if (state.repeats != 0) {
+            char   summary[512];
+            size_t length = RawLogFormat(summary, sizeof(summary),
+                "%slast message repeated %u times\n", state.prefix.c_str(), state.repeats);
+            if (state.sinks & LOG_TO_STDERR) {
+                WriteToFd(STDERR_FILENO, summary, length);
+            }
+            if (state.sinks & LOG_TO_FILE) {
+                EmergencyWriteLogFile(text_fd, summary, length);
+            }
+            state.repeats = 0;
+        }
+
+        uint64_t pos;
+        while (g_log_queue != nullptr && ringqueue_acquire(g_log_queue, 1, &pos) != 0) {
+            struct ringqueue_slot *slot = ringqueue_slot_at(g_log_queue, pos);
+            const char            *data = reinterpret_cast< char * >(ringqueue_slot_data(slot));
+            LogRecord              record;
+            memcpy(&record, data, sizeof(LogRecord));
+            const char *text = record.external ? record.external : data + sizeof(LogRecord);
+            if (record.sinks & LOG_TO_STDERR) {
+                WriteToFd(STDERR_FILENO, text, record.length);
+            }
+            if (record.sinks & LOG_TO_FILE) {
+                EmergencyWriteLogFile(text_fd, text, record.length);
+            }
+            ringqueue_release(g_log_queue, pos);
+        }
+        g_log_mutex.unlock();
+    }
+
+    if (fd >= 0) {
+        fdatasync(fd);
+    }
+}
+
 // 构造函数: 从文件名和行号构造日志消息, 需要指定日志等级
 LogMessage::LogMessage(const char *file, const char *func, int line, LogSeverity severity)
-    : file_(file), func_(func), line_(line), severity_(severity)
+    : file_(file), func_(func), line_(line), severity_(severity),
+      min_level_(log_settings.log_min_level), pending_(nullptr)
 {
     Init(file, func, line);
 }
 
 // 构造函数: 从文件名和行号构造日志消息, 默认日志等级Fatal, 需要指定判断条件, 用于CHECK宏.
 LogMessage::LogMessage(const char *file, const char *func, int line, const char *condition)
-    : file_(file), func_(func), line_(line), severity_(LOGGING_FATAL)
+    : file_(file), func_(func), line_(line), severity_(LOGGING_FATAL),
+      min_level_(log_settings.log_min_level), pending_(nullptr)
 {
     Init(file, func, line);
     stream_ << "Check failed: " << condition << ". ";
 }
 
+// 构造函数: 从静态调用点描述构造日志消息, 调用点只需传递一个指针
+LogMessage::LogMessage(const LogCallSite &site, LogSeverity severity)
+    : file_(site.file), func_(site.func), line_(site.line), severity_(severity),
+      min_level_(log_settings.log_min_level), pending_(nullptr)
+{
+    Init(site.file, site.func, site.line);
+}
+
+// 构造函数: 通过命名日志对象输出, 使用日志对象的最小日志等级
+LogMessage::LogMessage(const LogCallSite &site, LogSeverity severity, const Logger &logger)
+    : file_(site.file), func_(site.func), line_(site.line), severity_(severity),
+      min_level_(logger.min_level()), pending_(nullptr)
+{
+    Init(site.file, site.func, site.line);
+}
+
+// 构造函数: 协程中输出日志, 只入队, 不等待日志锁, 队列满时保存到pending中
+LogMessage::LogMessage(const LogCallSite &site, LogSeverity severity, LogPendingRecord &pending)
+    : file_(site.file), func_(site.func), line_(site.line), severity_(severity),
+      min_level_(log_settings.log_min_level), pending_(&pending)
+{
+    Init(site.file, site.func, site.line);
+}
+
+// 构造函数: 从静态调用点描述构造CHECK失败消息
+LogMessage::LogMessage(const LogCallSite &site, const char *condition)
+    : file_(site.file), func_(site.func), line_(site.line), severity_(LOGGING_FATAL),
+      min_level_(log_settings.log_min_level), pending_(nullptr)
+{
+    Init(site.file, site.func, site.line);
+    stream_ << "Check failed: " << condition << ". ";
+}
+
 // 析构函数: 用于刷新日志消息, 释放资源
 LogMessage::~LogMessage()
 {
@@ -211,16 +1322,37 @@ void LogMessage::Flush()
     // Don't let actions from this method affect the system error after returning.
     ScopedClearLastError scoped_clear_last_error;
 
-    size_t stack_start = stream_.str().length();
+    size_t stack_start = stream_.buffer().size();
 
     // Include a stack trace on a fatal, unless a debugger is attached.
     if (severity_ == LOGGING_FATAL) {
         /* bug: Fatal时输出关键的debug信息 */
     }
 
-    // note: 默认尾部填充换行符'\n'
-    stream_ << std::endl;
-    std::string str_newline(stream_.str());
+    // note: 默认尾部填充换行符'\n', 之后不再写入日志流, 直接取走缓冲区
+    stream_ << '\n';
+    std::string str_newline(std::move(stream_.buffer()));
+
+    // 转义日志内容中的换行符和控制字符, 前缀和尾部换行符不变, 所有输出目的地都使用转义后的内容
+    uint32_t sanitize = g_log_sanitize.load(std::memory_order_relaxed);
+    if (UNLIKELY(sanitize != LOG_SANITIZE_NONE)) {
+        SanitizeLogText(str_newline, message_start_, str_newline.size() - 1, sanitize);
+    }
+
+    // 有实时订阅者时先发送给订阅者, 只为订阅者构造的日志不再输出
+    if (UNLIKELY(IsLogTailActive()) && !backtrace_only_) {
+        LogTailPublish(severity_, file_, func_, str_newline);
+    }
+
+    // backtrace模式下, 低等级日志只捕获, 不输出, 前缀在输出backtrace缓存时生成
+    if (UNLIKELY(backtrace_only_ || ShouldCaptureBacktrace(severity_, min_level_))) {
+        CaptureLogBacktrace(file_, func_, line_, severity_, str_newline.data() + message_start_,
+            str_newline.size() - message_start_);
+        return;
+    }
+    if (UNLIKELY(tail_only_)) {
+        return;
+    }
 
     // 定义自动清理资源的对象, 用于释放资源
     ScopedCleanUp cleanup([&] {
@@ -230,88 +1362,165 @@ void LogMessage::Flush()
         }
     });
 
-    // // 移动到无锁队列中
-    // uint32_t entry_idx = llqueue_dequeue(&g_log_free_queue);
-    // if (entry_idx == LLQUEUE_NULL_IDX) {
-    //     // 如果队列满了, 则直接输出到标准错误
-    //     WriteToFd(STDERR_FILENO, str_newline.data(), str_newline.size());
-    //     return;
-    // }
-
-    // // 将日志信息写入到队列中
-    // g_log_queue_entries[entry_idx].data = new std::string(str_newline);
-    // llqueue_enqueue(&g_log_wait_queue, entry_idx);
-
-    // // 上锁开始准备写日志
-    // {
-    //     std::lock_guard< std::mutex > lock(g_log_mutex);
-    //     // 从队列中取出日志信息
-    //     entry_idx = llqueue_dequeue_all(&g_log_wait_queue);
-    //     while (entry_idx != LLQUEUE_NULL_IDX) {
-    //         // 生成时间戳
-    //         std::string timestamp;
-    //         LogSyslogPrefixTimestamp(log_settings, timestamp);
-    //         // 引入随机延迟
-    //         RandomSleep();
-    //         // 写入日志信息
-    //         WriteToFd(STDERR_FILENO, timestamp.data(), timestamp.size());
-    //         // 写入后续的日志信息
-    //         std::string *log_str = static_cast<std::string
-    //         *>(g_log_queue_entries[entry_idx].data); WriteToFd(STDERR_FILENO, log_str->data(),
-    //         log_str->size());
-    //         // 释放资源
-    //         delete log_str;
-    //         llqueue_enqueue(&g_log_free_queue, entry_idx);
-    //         entry_idx = llqueue_dequeue_all(&g_log_wait_queue);
-    //     }
-    // }
-
-    if (ShouldLogToStderr(severity_)) {
-        std::lock_guard< std::mutex > lock(g_log_mutex);
-        // 生成时间戳
-        std::string timestamp;
-        LogSyslogPrefixTimestamp(log_settings, timestamp);
-        RandomSleep();
-        // 写入日志信息
-        WriteToFd(STDERR_FILENO, timestamp.data(), timestamp.size());
-        WriteToFd(STDERR_FILENO, str_newline.data(), str_newline.size());
-    }
-
-    // if ((log_settings.log_dest & LOG_TO_FILE) != 0) {
-    //     // If the client app did not call InitLogging() and the lock has not
-    //     // been created it will be done now on calling GetLoggingLock(). We do this
-    //     // on demand, but if two threads try to do this at the same time, there will
-    //     // be a race condition to create the lock. This is why InitLogging should be
-    //     // called from the main thread at the beginning of execution.
-
-    //     // base::AutoLock guard(GetLoggingLock());
-    //     // if (InitializeLogFileHandle()) {
-    //     //     fwrite(str_newline.data(), str_newline.size(), 1, log_settings.log_file);
-    //     //     fflush(log_settings.log_file);
-    //     // }
-    // }
+    uint32_t sinks = GetLogSinks(severity_);
+    if (sinks == LOG_NONE) {
+        return;
+    }
+
+    // 重复日志合并只比较日志内容, 不包含前缀和尾部换行符, 在锁外计算摘要
+    LogRecord record;
+    record.file          = file_;
+    record.func          = func_;
+    record.line          = line_;
+    record.severity      = severity_;
+    record.sinks         = sinks;
+    record.message_start = static_cast< uint32_t >(message_start_);
+    record.length        = static_cast< uint32_t >(str_newline.size());
+    record.coalesce      = log_settings.log_dedup_window_ms != 0 && severity_ != LOGGING_FATAL;
+    record.payload_hash  = 0;
+    record.external      = nullptr;
+    record.tid           = GetLogThreadId();
+    record.thread_name   = 0;
+    gettimeofday(&record.tv, nullptr);
+    if (record.coalesce) {
+        record.payload_hash = HashLogPayload(str_newline.data() + message_start_,
+            str_newline.size() - message_start_ - 1);
+    }
+
+    // 触发backtrace时, 需要先输出当前线程之前被抑制的日志, 不经过队列
+    bool dump_backtrace = log_settings.log_backtrace_size != 0 &&
+        severity_ >= log_settings.log_backtrace_trigger && g_log_backtrace.count != 0;
+
+    // 高等级日志写入文件时需要等待落盘
+    bool durable =
+        (sinks & LOG_TO_FILE) && severity_ >= g_log_sync_severity.load(std::memory_order_relaxed);
+
+    // 共享内存模式下交给收集进程统一输出. 触发backtrace时仍然在本进程输出, 收集进程不会
+    // 为生产者执行fdatasync, 需要落盘的日志和FATAL日志也在本进程直接写入
+    if (!dump_backtrace && !durable && severity_ != LOGGING_FATAL &&
+        LogShmEnqueue(severity_, record.tv, str_newline.data(), record.length)) {
+        return;
+    }
+
+    // 二进制日志文件在线程第一次写日志时登记线程名字, 线程字典使用.
+    // 名字跟随日志记录, 由输出日志的线程登记, 生产者不获取日志锁
+    char thread_name[16] = {0};
+    if (UNLIKELY((sinks & LOG_TO_FILE) && GetLogFileFormat() == LOG_FILE_FORMAT_BINARY &&
+                 g_log_thread_registered != record.tid)) {
+        pthread_getname_np(pthread_self(), thread_name, sizeof(thread_name));
+        record.thread_name      = static_cast< uint32_t >(strlen(thread_name)) + 1;
+        g_log_thread_registered = record.tid;
+    }
+
+    // 先入队, 再上锁清空队列, 返回时当前日志一定已经输出.
+    // 后台线程模式下只入队, FATAL日志和需要落盘的日志仍然同步输出.
+    LogTestDelay(LOG_TEST_POINT_ENQUEUE);
+    uint64_t pos;
+    bool     queued =
+        !dump_backtrace && EnqueueLogRecord(record, str_newline.data(), thread_name, &pos);
+    if (LIKELY(queued) && g_log_async.load(std::memory_order_relaxed) &&
+        severity_ != LOGGING_FATAL && !durable) {
+        WakeLogBackend();
+        return;
+    }
+    // 协程生产者不等待日志锁, 其他线程持有锁时交给后台线程输出
+    if (pending_ != nullptr && severity_ != LOGGING_FATAL && !durable && !dump_backtrace) {
+        std::unique_lock< std::mutex > lock(g_log_mutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            g_log_adaptive.locks++;
+            if (LIKELY(queued)) {
+                DrainLogQueueLocked(pos + 1);
+            } else {
+                DrainLogQueueLocked(0);
+                WriteLogRecordLocked(record, str_newline.data(), thread_name);
+                SubmitLogUringLocked();
+            }
+            return;
+        }
+        if (LIKELY(queued) && RequestLogBackend(nullptr, nullptr)) {
+            return;
+        }
+        // 协程检查队列空间之后队列被其他生产者写满, 保存日志记录, 协程挂起到队列有空间后
+        // 重新入队, 见SubmitLogPendingRecord(). 名字在重新入队之前不算登记
+        if (!queued && !HasLogQueueSpace() && RequestLogBackend(nullptr, nullptr)) {
+            std::string &data = pending_->data;
+            data.reserve(sizeof(LogRecord) + record.length + record.thread_name);
+            data.assign(reinterpret_cast< const char * >(&record), sizeof(LogRecord));
+            data.append(str_newline.data(), record.length);
+            data.append(thread_name, record.thread_name);
+            if (record.thread_name != 0) {
+                g_log_thread_registered = 0;
+            }
+            return;
+        }
+    }
+
+    uint64_t file_seq;
+    {
+        LockLogMutex();
+        std::lock_guard< std::mutex > lock(g_log_mutex, std::adopt_lock);
+        g_log_adaptive.locks++;
+        if (LIKELY(queued)) {
+            DrainLogQueueLocked(pos + 1);
+        } else {
+            // 日志太长或者队列满时直接写入, 先清空队列保证顺序
+            DrainLogQueueLocked(0);
+            // 打断重复序列, 再输出backtrace缓存
+            if (dump_backtrace) {
+                FlushLogDedupLocked();
+                DumpLogBacktraceLocked(sinks);
+            }
+            WriteLogRecordLocked(record, str_newline.data(), thread_name);
+            SubmitLogUringLocked();
+        }
+        // 需要落盘的日志先等待io_uring写入和压缩写入完成, 再由fdatasync覆盖
+        if (UNLIKELY(durable)) {
+            WaitLogFileWritesLocked();
+        }
+        file_seq = GetLogFileWriteSeq();
+    }
+
+    // 在锁外等待, 同时等待的线程共享一次fdatasync
+    if (UNLIKELY(durable)) {
+        WaitLogFileSynced(file_seq);
+    }
+}
+
+// 判断日志在没有实时订阅者时是否也会构造
+static bool IsLogEnabledWithoutTail(LogSeverity severity, int32_t min_level, const char *file)
+{
+    if (severity < 0) {
+        return -severity <= GetVlogLevel(file);
+    }
+    return severity >= min_level || ShouldCaptureBacktrace(severity, min_level);
 }
 
 // writes the common header info to the stream
 void LogMessage::Init(const char *file, const char *func, int line)
 {
-    static bool g_log_init = false;
-
-    // 初始化日志队列
-    if (UNLIKELY(!g_log_init)) {
-        g_log_init = true;
-        InitLoggingQueue();
-    }
+    // 初始化日志队列, 局部静态变量保证多线程下只初始化一次
+    static bool g_log_init = (InitLoggingQueue(), true);
+    (void)g_log_init;
 
     // Don't let actions from this method affect the system error after returning.
     ScopedClearLastError scoped_clear_last_error;
 
-    // 强制只打印文件名字, 不包含路径, 这样信息比较简洁
-    file_ = strrchr(file, '/') + 1;
-    // 生成日志前缀
-    InitWithSyslogPrefix(log_settings);
+    // 强制只打印文件名字, 不包含路径, 这样信息比较简洁. 相对路径编译时文件名可能不包含'/'
+    const char *slash = strrchr(file, '/');
+    file_             = slash != nullptr ? slash + 1 : file;
+    // 没有订阅者时不会构造的日志只发送给订阅者, VLOG需要用完整路径匹配vmodule规则
+    tail_only_ =
+        UNLIKELY(IsLogTailActive()) && !IsLogEnabledWithoutTail(severity_, min_level_, file);
+    // 生成日志前缀, 只捕获到backtrace缓存的日志在输出缓存时再生成
+    backtrace_only_ =
+        UNLIKELY(ShouldCaptureBacktrace(severity_, min_level_)) && !IsLogTailActive();
+    if (LIKELY(!backtrace_only_)) {
+        InitWithSyslogPrefix(log_settings);
+    }
     // 记录日志信息起始位置
-    message_start_ = stream_.str().length();
+    message_start_ = stream_.buffer().size();
+    // 线程的日志上下文属于日志内容, 二进制日志和重复日志合并都包含上下文
+    AppendLogContext(stream_);
 }
 
 void LogMessage::HandleFatal(size_t stack_start, const std::string &str_newline) const
@@ -17,7 +17,10 @@
 #define EASELOG_LOGGING_H_
 
 #include <stdint.h>
+#include <sys/time.h>
 
+#include <atomic>
+#include <functional>
 #include <sstream>
 
 namespace logging {
@@ -43,6 +46,21 @@ enum : uint32_t {
     LOG_DEFAULT = LOG_TO_SYSTEM_DEBUG_LOG | LOG_TO_STDERR,
 };
 
+// How log records are written, see SetLogMode().
+using LogMode = uint32_t;
+
+enum : uint32_t {
+    // The logging thread writes its own record, and any record queued by other
+    // threads, under the logging lock before returning.
+    LOG_MODE_SYNC = 0,
+    // Records are only queued, a backend thread writes them out. FATAL
+    // records are still written before returning.
+    LOG_MODE_ASYNC = 1,
+    // Starts in LOG_MODE_SYNC, switches to LOG_MODE_ASYNC while the logging
+    // lock is contended or the message rate is high, and back when idle.
+    LOG_MODE_ADAPTIVE = 2,
+};
+
 using LogSeverity = int32_t;
 // This is level 1 verbosity
 // Note: the log severities are used to index into the array of names,
@@ -66,16 +84,38 @@ struct LoggingSettings {
     int32_t     log_min_level;
     // For LOGGING_ERROR and above, always print to stderr.
     int32_t     log_always_print;
+    // Backtrace-on-error: records below log_min_level are kept in a per-thread
+    // ring of log_backtrace_size entries, and dumped before the first record
+    // at or above log_backtrace_trigger logged by the same thread. A size of 0
+    // disables the backtrace.
+    int32_t     log_backtrace_trigger;
+    uint32_t    log_backtrace_size;
+    // Coalescing of repeated messages: consecutive records from the same
+    // callsite with the same payload within log_dedup_window_ms are written
+    // once, followed by a "last message repeated N times over T ms" record.
+    // At most log_dedup_max_repeats records are folded into one summary
+    // (0 means unlimited). A window of 0 disables coalescing. There is no
+    // timer: the summary is written, to the repeated record's sinks, when a
+    // different record is written, on FlushLog() or at exit.
+    uint32_t    log_dedup_window_ms;
+    uint32_t    log_dedup_max_repeats;
     // Specifies the process' logging sink(s), represented as a combination of
     // LoggingDestination values joined by bitwise OR.
     // The destination for the log messages.
     uint32_t    log_dest;
+    // The LogMode used to write records, and for LOG_MODE_ADAPTIVE the rate
+    // in records per second above which the backend thread takes over (0
+    // selects the default of 20000).
+    uint32_t    log_mode;
+    uint32_t    log_async_rate;
     // What should be prepended to each message?
     bool        log_process_id;
     bool        log_thread_id;
     bool        log_timestamp;
     bool        log_tickcount;
     const char *log_prefix;
+    // Per-module verbose levels, eg. "storage*=2,net/rpc/*=1", see SetVmodule().
+    const char *log_vmodule;
     // The names of the log severities.
     const char *log_severity_names[LOGGING_NUM_SEVERITIES];
 };
@@ -124,9 +164,324 @@ void SetMinLogLevel(int32_t level);
 // Gets the current log level.
 int32_t GetMinLogLevel();
 
+// Sets the default verbose level, VLOG(x) with x <= |verbose_level| will be
+// written. This is the same as SetMinLogLevel(-verbose_level).
+void SetVlogLevel(int32_t verbose_level);
+
+// Sets per-module verbose levels which take precedence over the default one.
+// |vmodule| is a comma-separated list of "pattern=N" rules, the first matching
+// rule wins. A pattern without a path separator is matched against the module
+// name, which is the file name without directory and extension (so "foo*"
+// matches foo_bar.cpp), otherwise it is matched against the full __FILE__
+// path. '*' and '?' are supported as wildcards.
+void SetVmodule(const char *vmodule);
+
+// Gets the verbose level for |file|, applying the vmodule rules.
+int32_t GetVlogLevel(const char *file);
+
 // Used by LOG_IS_ON to lazy-evaluate stream arguments.
 bool ShouldCreateLogMessage(int32_t severity);
 
+// Enables the backtrace-on-error mode, see LoggingSettings. Records with a
+// severity in [LOGGING_DEBUG, min log level) are then still formatted, but
+// only captured into a per-thread ring of |ring_size| entries, which is
+// written out (with the original timestamps) right before the first record
+// at or above |trigger_severity| from the same thread. Pass 0 to disable.
+void SetLogBacktrace(uint32_t ring_size, LogSeverity trigger_severity);
+
+// Enables coalescing of repeated messages in the output path, see
+// LoggingSettings. Pass a |window_ms| of 0 to disable.
+void SetLogDedup(uint32_t window_ms, uint32_t max_repeats);
+
+// Makes records at or above |severity| durable: when such a record goes to
+// the log file, the caller blocks until it is covered by an fdatasync().
+// Concurrent callers share one sync (group commit), records below |severity|
+// are not affected. Pass LOGGING_NUM_SEVERITIES to disable, the default.
+void SetLogFileSync(LogSeverity severity);
+
+// Flags of SetLogSanitize().
+enum : uint32_t {
+    LOG_SANITIZE_NONE = 0,
+    // Escapes newlines and other control characters except tab as "\n",
+    // "\r" or "\xNN", so that every record stays on one line.
+    LOG_SANITIZE_CONTROL = 1u << 0,
+    // Also escapes bytes which are not part of valid UTF-8 as "\xNN".
+    LOG_SANITIZE_UTF8 = 1u << 1,
+};
+
+// Sanitizes the message text of every record before it's written, the
+// prefix is never touched. The text is scanned 16 or 32 bytes at a time
+// with SSE2 or AVX2, picked at runtime, and isn't copied unless something
+// needs escaping. LOG_SANITIZE_NONE, the default, keeps messages as is.
+void SetLogSanitize(uint32_t flags);
+
+// Gets the flags set by SetLogSanitize().
+uint32_t GetLogSanitize();
+
+// Severity masks select a set of severities, VLOG records count as
+// LOGGING_DEBUG.
+constexpr uint32_t LOG_SEVERITY_MASK_ALL = (1u << LOGGING_NUM_SEVERITIES) - 1;
+
+inline uint32_t LogSeverityMask(LogSeverity severity)
+{
+    return 1u << (severity < LOGGING_DEBUG ? LOGGING_DEBUG : severity);
+}
+
+// Enables the sidecar time index of the log file, written next to it with an
+// ".idx" suffix. A new index entry, holding the time of its first line, the
+// file offset and length, and the mask of severities it contains, is added
+// every |interval_kb| KB or |interval_ms| ms of log output, whichever comes
+// first (0 disables that limit). Only files opened from log_file_path are
+// indexed, and the setting applies the next time the file is opened. Pass
+// 0, 0 to disable, the default.
+void SetLogFileIndex(uint32_t interval_kb, uint32_t interval_ms);
+
+// Statistics of ReadLogFileRange().
+struct LogRangeStats {
+    uint64_t lines;            // Lines passed to the callback.
+    uint64_t scanned_bytes;    // Bytes of the log file actually read.
+    uint64_t file_bytes;       // Size of the log file.
+    uint64_t index_entries;    // Entries in the index, 0 without an index.
+};
+
+// Calls |callback| with every line of the log file |path| timestamped in
+// [begin_us, end_us) (microseconds since the epoch) whose severity is in
+// |severity_mask|. The index is used to skip blocks outside the range or
+// without a wanted severity, parts of the file not covered by the index are
+// scanned. Lines without a timestamp belong to the record before them.
+// Returns false if |path| can't be read or is a binary or compressed log file
+// (see DecodeLogFile()), |stats| may be null.
+bool ReadLogFileRange(const char *path, uint64_t begin_us, uint64_t end_us,
+    uint32_t severity_mask, const std::function< void(const char *, size_t) > &callback,
+    LogRangeStats *stats);
+
+// Format of the log file, see SetLogFileFormat().
+using LogFileFormat = uint32_t;
+
+enum : uint32_t {
+    // One line of text per record, with the prefix configured by SetLogItems().
+    LOG_FILE_FORMAT_TEXT = 0,
+    // Compact binary records, the callsite (file, function, line, severity)
+    // and the thread (pid, tid, names) are stored once in a dictionary and
+    // records only refer to them, see DecodeLogFile().
+    LOG_FILE_FORMAT_BINARY = 1,
+};
+
+// Selects the format of the log file, the setting applies the next time the
+// file is opened. Records collected from other processes (see
+// StartLogCollector()) are kept as text lines inside a binary file, RAW_LOG
+// and the crash time flush skip it. The time index is only written for text
+// files.
+void SetLogFileFormat(LogFileFormat format);
+
+// Gets the format set by SetLogFileFormat().
+LogFileFormat GetLogFileFormat();
+
+// Writes the log file through Linux io_uring, so that the thread writing
+// records keeps formatting while the disk catches up. Records are copied
+// into |buffers| registered buffers of |buffer_kb| each; a buffer is
+// submitted when it is full or when a batch of records has been written, and
+// completions are reaped without blocking. The writer only waits when every
+// buffer is in flight. FlushLog() and durable records (SetLogFileSync())
+// wait for the submitted writes.
+//
+// Applies the next time a file is opened from |log_file_path|, 0 disables.
+// When io_uring is unavailable the file is written with write() as before.
+// Writes use explicit offsets. The offset is re-read from the end of the file
+// whenever no write is in flight, but other writers appending while writes
+// are in flight can still be overwritten. fork() therefore returns the parent
+// to write() until the file is reopened, and RAW_LOG skips the file while
+// io_uring is active.
+void SetLogFileUring(uint32_t buffer_kb, uint32_t buffers);
+
+// Returns true while the log file is written through io_uring.
+bool IsLogFileUringActive();
+
+// Writes the log file as a sequence of independently compressed frames.
+// Records are copied into blocks of |block_kb| by the thread writing them;
+// full blocks are compressed by |workers| background threads with a built-in
+// LZ77 codec (the LZ4 block format) and written in order, so producers never
+// compress. When the workers fall behind, which means the machine is short
+// on CPU, blocks are written uncompressed instead of queueing up. A partial
+// block is written after about a second, on FlushLog(), for durable records
+// (SetLogFileSync()) and at exit.
+//
+// Every frame header holds its lengths and the time of its first record, so
+// readers can step over frames without inflating them. DecodeLogFile() and
+// easelog-decode read compressed files. Applies the next time a file is
+// opened from |log_file_path|, 0 disables, |block_kb| is capped at 65536.
+// Takes precedence over SetLogFileUring(); the time index and RAW_LOG skip
+// compressed files.
+void SetLogFileCompression(uint32_t block_kb, uint32_t workers);
+
+// Returns true while the log file is written compressed.
+bool IsLogFileCompressed();
+
+// Statistics of the compressed log file since the process started.
+struct LogCompressStats {
+    uint64_t frames;           // Frames written.
+    uint64_t stored_frames;    // Frames written uncompressed.
+    uint64_t raw_bytes;        // Log bytes before compression.
+    uint64_t file_bytes;       // Bytes written to the file, with frame headers.
+};
+
+LogCompressStats GetLogCompressStats();
+
+// Output of DecodeLogFile().
+enum : uint32_t {
+    // Lines in the base text style, with every prefix item.
+    LOG_DECODE_TEXT = 0,
+    // One JSON object per line, bytes which are not valid UTF-8 are replaced
+    // with U+FFFD.
+    LOG_DECODE_JSON = 1,
+};
+
+struct LogDecodeOptions {
+    uint64_t begin_us;         // Keep records in [begin_us, end_us), microseconds
+    uint64_t end_us;           // since the epoch.
+    uint32_t severity_mask;    // Severities to keep, see LogSeverityMask().
+    uint32_t output;           // LOG_DECODE_TEXT or LOG_DECODE_JSON.
+    uint32_t threads;          // Decoding threads, 0 uses one per CPU.
+    uint32_t __pad;
+};
+
+// Statistics of DecodeLogFile(). For compressed files, bytes of frames which
+// can't be inflated are counted as corrupt.
+struct LogDecodeStats {
+    uint64_t records;           // Records passed to the callback.
+    uint64_t blocks;            // Blocks decoded.
+    uint64_t skipped_blocks;    // Blocks skipped by the time range.
+    uint64_t corrupt_bytes;     // Bytes which couldn't be decoded.
+    uint64_t file_bytes;        // Size of the log file.
+    uint64_t skipped_frames;    // Compressed frames skipped without inflating.
+};
+
+// Decodes a binary log file. The file is split into chunks at block
+// boundaries which are decoded in parallel, |callback| is called from the
+// calling thread with the decoded text of each chunk, in file order. The
+// filters are applied while decoding: blocks outside the time range are
+// skipped without being decoded, and records of unwanted severities are
+// skipped before being formatted. Corrupt parts are skipped up to the next
+// block. Compressed files are inflated in bounded windows of frames, frames
+// entirely before |begin_us| are skipped without being inflated; compressed
+// text files are passed through unfiltered. Returns false if |path| can't be
+// read or is not a binary or compressed log file, |stats| may be null.
+bool DecodeLogFile(const char *path, const LogDecodeOptions &options,
+    const std::function< void(const char *, size_t) > &callback, LogDecodeStats *stats);
+
+// Live tail over a local Unix stream socket. A client connects and sends one
+// filter line of space separated "key=value" items, the server replies "OK"
+// or "ERROR <reason>" and then streams every matching record as text:
+//   severity=<name>  lowest severity, eg. "debug" or "verbose2" for VLOG(2),
+//                    default "debug"
+//   file=<glob>      file name without directory, '*' and '?' as in vmodule
+//   func=<glob>      function name
+//   thread=<glob>    thread name, or the thread ID
+// While a subscriber is connected, records it asks for are created even below
+// the minimum level (VLOG only for callsites matching |file|) and only sent to
+// the subscribers. Each subscriber has a bounded buffer, records are dropped
+// and counted instead of blocking the logging threads when a reader is slow.
+// Without subscribers the logging path only checks one flag.
+//
+// Only peers running as the same user as the process, or as root, are
+// accepted. Starts the server thread on |path|, a leading '@' selects the
+// abstract namespace. A socket file is created with mode 0600, a stale socket
+// at |path| is replaced but any other file is left alone. Returns false on
+// failure or when already started.
+bool StartLogTail(const char *path);
+
+// Stops the server thread and disconnects every subscriber.
+void StopLogTail();
+
+// Connects to the server on |path| and subscribes with |filter|. Returns the
+// connected socket to read records from, or -1 when the connection or the
+// filter is refused.
+int ConnectLogTail(const char *path, const char *filter);
+
+// Memory held by queued log records which don't fit inline in a queue slot.
+// Such records are copied into per-thread slabs of power-of-two size classes,
+// blocks freed by another thread are returned to the owning thread in
+// batches, and the total is bounded by SetLogMemoryLimit(). A record that
+// can't be allocated under the limit is written synchronously instead.
+struct LogMemoryStats {
+    uint64_t limit_bytes;          // Limit set by SetLogMemoryLimit().
+    uint64_t reserved_bytes;       // Slabs and large blocks taken from malloc.
+    uint64_t in_use_bytes;         // Allocated and not yet returned to the owner.
+    uint64_t alloc_count;          // Successful allocations.
+    uint64_t remote_free_count;    // Blocks returned by another thread.
+    uint64_t alloc_failures;       // Allocations refused by the limit.
+    uint32_t thread_caches;        // Per-thread caches, including orphaned ones.
+    uint32_t orphan_caches;        // Caches of exited threads, not yet adopted.
+};
+
+// Sets the limit of the memory held by queued log records, 16MB by default.
+void SetLogMemoryLimit(uint64_t limit_bytes);
+
+// Gets a snapshot of the log record memory statistics.
+LogMemoryStats GetLogMemoryStats();
+
+// Selects how records are written, see LogMode. |async_rate| is only used by
+// LOG_MODE_ADAPTIVE. Switching never reorders records: all of them pass
+// through the same queue, only the thread writing them out changes.
+void SetLogMode(LogMode mode, uint32_t async_rate);
+
+// Gets the configured LogMode.
+LogMode GetLogMode();
+
+// Returns true while records are written by the backend thread.
+bool IsLogBackendActive();
+
+// Blocks until every record queued before the call has been written.
+void FlushLog();
+
+// Hooks for coroutine producers, see log/easelog_coro.h. A registered waiter
+// is woken by the backend thread calling |wake|, which must not block and may
+// destroy the waiter. The backend thread is started for waiters in every
+// LogMode, but only serves them unless records are written by it.
+struct LogWaiter {
+    void (*wake)(LogWaiter *waiter);
+    LogWaiter *next;    // Used by the library while registered.
+    uint64_t   end;     // Used by the library while registered.
+};
+
+// Like FlushLog() without blocking: returns true if nothing had to be waited
+// for, otherwise |waiter| is woken once every record queued before the call
+// has been written.
+bool FlushLogAsync(LogWaiter *waiter);
+
+// Returns true if the log queue has a free slot.
+bool HasLogQueueSpace();
+
+// Registers |waiter| to be woken once the backend thread has drained the log
+// queue. Returns true instead if the waiter must not suspend, e.g. at exit.
+bool WaitLogQueueSpaceAsync(LogWaiter *waiter);
+
+// Multi-process logging over shared memory. The collecting process creates
+// the region, with one ring per producer process, and runs a collector
+// thread which merges all rings in timestamp order into its own sinks.
+//
+// Processes forked after CreateLogSharedMemory() inherit the mapping and
+// claim a ring on their first record, unrelated processes call
+// AttachLogSharedMemory() with the same name. Records which don't fit in a
+// ring slot, or find the ring full for too long, are written directly. So are
+// FATAL records and records at or above SetLogFileSync(), the collector does
+// not fdatasync on behalf of producers.
+//
+// A null |name| creates an anonymous memfd region, shared with forked
+// children only. Returns false on failure or when already created/attached.
+bool CreateLogSharedMemory(const char *name, uint32_t max_processes);
+
+// Attaches to a region created by another process and claims a ring.
+bool AttachLogSharedMemory(const char *name);
+
+// Starts the collector thread in the creating process. It is stopped, and
+// the remaining records written, at exit.
+bool StartLogCollector();
+
+// Stops the collector thread after writing the remaining records, and
+// removes the region name.
+void StopLogCollector();
+
 // Sets the common items you want to be prepended to each log message.
 // process and thread IDs default to off, the timestamp defaults to on.
 // If this function is not called, logging defaults to writing the timestamp
@@ -143,6 +498,236 @@ void SetLogPrefix(const char *prefix);
 // Generates a timestamp string for the log message.
 void LogSyslogPrefixTimestamp(const LoggingSettings &log_settings, std::string &timestamp);
 
+// Generates a timestamp string for a log message recorded at |tv|.
+void LogSyslogPrefixTimestamp(const LoggingSettings &log_settings, const struct timeval &tv,
+    std::string &timestamp);
+
+// Async-signal-safe logging, for signal handlers and other places where the
+// heap or the logging locks can't be trusted (see RAW_LOG below). |format|
+// supports a printf subset: flags '-'/'0', width, precision for %s, length
+// modifiers hh/h/l/ll/z/j/t and %d %i %u %x %X %o %c %s %p %%. The record is
+// formatted into a stack buffer (truncated at 2KB) and written with a single
+// write() to stderr and to the log file, if open. RAW_LOG(FATAL) aborts.
+void RawLog(LogSeverity severity, const char *file, int line, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#define RAW_LOG(severity, format, ...) \
+    ::logging::RawLog(::logging::LOGGING_##severity, __FILE__, __LINE__, format, ##__VA_ARGS__)
+
+// Installs handlers for SIGSEGV, SIGILL, SIGFPE, SIGABRT, SIGBUS and SIGTERM
+// which write the signal and a stack trace (symbolized from the dynamic symbol
+// table, link with -rdynamic for better names) through the RAW_LOG path, flush
+// what is still buffered in the logging pipeline, and then re-raise the
+// signal with the default action. The calling thread also gets an alternate
+// signal stack so that stack overflows can be reported.
+bool InstallFailureSignalHandler();
+
+// Static description of a logging callsite. LOG(), VLOG() and CHECK() define
+// one per expansion (see LOG_CALLSITE), so that a callsite passes a single
+// pointer to the out-of-line LogMessage constructor instead of three arguments.
+struct LogCallSite {
+    const char *file;
+    const char *func;
+    int32_t     line;
+    uint32_t    __pad;
+};
+
+// Named logger with its own minimum level, for components which need a
+// different level than the rest of the process. Declare one per component as
+// a static and log through LOG_TO():
+//
+//   static logging::Logger g_wal_logger("storage.wal");
+//   LOG_TO(g_wal_logger, DEBUG) << "segment rolled";
+//
+// Loggers register themselves when constructed. The level is resolved from
+// the longest prefix set by SetLoggerLevel(), or follows SetMinLogLevel(),
+// and cached in the logger. It's recomputed for every logger only when the
+// configuration changes, so LOG_TO() costs one relaxed load like LOG().
+class Logger {
+public:
+    explicit Logger(const char *name);
+    ~Logger();
+
+    Logger(const Logger &)            = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    const char *name() const { return name_; }
+
+    // Same as LOG_IS_ON() for this logger.
+    bool IsOn(LogSeverity severity) const
+    {
+        return severity >= create_level_.load(std::memory_order_relaxed);
+    }
+
+    // Minimum level resolved for this logger.
+    int32_t min_level() const { return min_level_.load(std::memory_order_relaxed); }
+
+private:
+    friend struct LoggerRegistry;
+
+    const char             *name_;
+    Logger                 *next_;
+    std::atomic< int32_t >  create_level_;
+    std::atomic< int32_t >  min_level_;
+};
+
+// Sets the minimum level of the loggers named |prefix| and of those below it,
+// split on '.': "storage" covers "storage" and "storage.wal", but not
+// "storagex". The longest matching prefix wins, an empty prefix covers every
+// logger. Loggers without a matching prefix follow SetMinLogLevel().
+void SetLoggerLevel(const char *prefix, int32_t level);
+
+// Removes the level set for |prefix| by SetLoggerLevel().
+void ClearLoggerLevel(const char *prefix);
+
+class LogStreamAdapter;
+
+// Stream behind LOG() and friends. Built-in types are formatted straight into
+// the record buffer: integers through a two-digit table, floating point values
+// and pointers like std::ostream's defaults ("%g" with precision 6, "0x" and
+// hex), without locale facets, sentries or virtual streambuf calls.
+//
+// Other types and manipulators (std::hex, std::setw(), ...) go through an
+// std::ostream adapter writing to the same buffer, created on first use. Once
+// a manipulator changed the adapter's format state, built-in types are
+// formatted by the adapter too, so the output matches std::ostream. A null C
+// string is written as "(null)" instead of setting badbit.
+class LogStream {
+public:
+    LogStream() : adapter_(nullptr) { buffer_.reserve(kInitialCapacity); }
+
+    LogStream(const LogStream &)            = delete;
+    LogStream &operator=(const LogStream &) = delete;
+    ~LogStream();
+
+    LogStream &operator<<(bool value) { return Put(value, static_cast< uint64_t >(value)); }
+    LogStream &operator<<(short value) { return Put(value, static_cast< int64_t >(value)); }
+    LogStream &operator<<(unsigned short value)
+    {
+        return Put(value, static_cast< uint64_t >(value));
+    }
+    LogStream &operator<<(int value) { return Put(value, static_cast< int64_t >(value)); }
+    LogStream &operator<<(unsigned int value) { return Put(value, static_cast< uint64_t >(value)); }
+    LogStream &operator<<(long value) { return Put(value, static_cast< int64_t >(value)); }
+    LogStream &operator<<(unsigned long value)
+    {
+        return Put(value, static_cast< uint64_t >(value));
+    }
+    LogStream &operator<<(long long value) { return Put(value, static_cast< int64_t >(value)); }
+    LogStream &operator<<(unsigned long long value)
+    {
+        return Put(value, static_cast< uint64_t >(value));
+    }
+    LogStream &operator<<(float value) { return Put(value, static_cast< double >(value)); }
+    LogStream &operator<<(double value) { return Put(value, value); }
+    LogStream &operator<<(long double value) { return Put(value, value); }
+    LogStream &operator<<(const void *value) { return Put(value, value); }
+    LogStream &operator<<(void *value) { return Put(value, static_cast< const void * >(value)); }
+
+    LogStream &operator<<(char value)
+    {
+        if (__builtin_expect(IsNative(), 1)) {
+            buffer_.push_back(value);
+        } else {
+            Fallback(value);
+        }
+        return *this;
+    }
+    LogStream &operator<<(signed char value) { return *this << static_cast< char >(value); }
+    LogStream &operator<<(unsigned char value) { return *this << static_cast< char >(value); }
+
+    LogStream &operator<<(const char *value)
+    {
+        if (__builtin_expect(!IsNative(), 0)) {
+            Fallback(value != nullptr ? value : "(null)");
+        } else {
+            buffer_.append(value != nullptr ? value : "(null)");
+        }
+        return *this;
+    }
+    LogStream &operator<<(char *value) { return *this << static_cast< const char * >(value); }
+
+    LogStream &operator<<(const std::string &value)
+    {
+        if (__builtin_expect(IsNative(), 1)) {
+            buffer_.append(value);
+        } else {
+            Fallback(value);
+        }
+        return *this;
+    }
+
+    // Manipulators are applied to the adapter, e.g. std::endl or std::hex.
+    LogStream &operator<<(std::ostream &(*manipulator)(std::ostream &));
+    LogStream &operator<<(std::ios_base &(*manipulator)(std::ios_base &));
+
+    // Appends |length| bytes as they are.
+    void write(const char *data, size_t length) { buffer_.append(data, length); }
+
+    // The std::ostream adapter, for code which needs an std::ostream.
+    std::ostream &ostream();
+
+    const std::string &buffer() const { return buffer_; }
+    std::string       &buffer() { return buffer_; }
+
+private:
+    static const size_t kInitialCapacity = 256;
+
+    bool IsNative() const { return adapter_ == nullptr || !IsAdapterFormatted(); }
+    bool IsAdapterFormatted() const;
+
+    template < typename T > void Fallback(const T &value) { ostream() << value; }
+
+    template < typename T, typename N > LogStream &Put(T value, N native)
+    {
+        if (__builtin_expect(IsNative(), 1)) {
+            Append(native);
+        } else {
+            Fallback(value);
+        }
+        return *this;
+    }
+
+    void Append(int64_t value);
+    void Append(uint64_t value);
+    void Append(double value);
+    void Append(long double value);
+    void Append(const void *value);
+
+    std::string       buffer_;
+    LogStreamAdapter *adapter_;
+};
+
+// Types without a LogStream overload are written through the std::ostream
+// adapter, so any type with an operator<<(std::ostream &, const T &) works.
+template < typename T > inline LogStream &operator<<(LogStream &stream, const T &value)
+{
+    stream.ostream() << value;
+    return stream;
+}
+
+// Record of a CO_LOG() statement, lives in the coroutine's frame. When the
+// log queue is full and the log mutex is taken, the formatted record is kept
+// here instead of blocking, and queued after the coroutine is resumed.
+struct LogPendingRecord {
+    LogPendingRecord() : started(false) { }
+
+    // Returns true only the first time, the record is created once.
+    bool Start() { return started ? false : (started = true); }
+
+    // Returns true until the record has been created and queued.
+    bool Pending() const { return !started || !data.empty(); }
+
+    std::string data;    // Used by the library while the record is kept.
+    bool        started;
+    bool        __pad_[7];
+};
+
+// Queues a record kept by CO_LOG(). Returns false if the log queue is still
+// full, the caller should then wait with WaitLogQueueSpaceAsync() and retry.
+// With |wait| set the record is written on the calling thread instead.
+bool SubmitLogPendingRecord(LogPendingRecord *pending, bool wait);
+
 // This class more or less represents a particular log message.  You
 // create an instance of LogMessage and then stream stuff to it.
 // When you finish streaming to it, ~LogMessage is called and the
@@ -159,16 +744,29 @@ public:
     // Used for CHECK().  Implied severity = LOGGING_FATAL.
     LogMessage(const char *file, const char *func, int line, const char *condition);
 
+    // Same as above, with the location taken from a static callsite.
+    LogMessage(const LogCallSite &site, LogSeverity severity);
+    LogMessage(const LogCallSite &site, const char *condition);
+
+    // Used for LOG_TO(logger, severity), filtered by the logger's level.
+    LogMessage(const LogCallSite &site, LogSeverity severity, const Logger &logger);
+
+    // Used for CO_LOG(severity): the record is only queued, the producer never
+    // waits for other threads writing records. If the queue is full it is kept
+    // in |pending|. FATAL and durable records, or ones exceeding the queue's
+    // memory limit, are still written before returning.
+    LogMessage(const LogCallSite &site, LogSeverity severity, LogPendingRecord &pending);
+
     // Delete copy constructor and assignment operator.
     LogMessage(const LogMessage &)            = delete;
     LogMessage &operator=(const LogMessage &) = delete;
     virtual ~LogMessage();
 
-    std::ostream &stream() { return stream_; }
+    LogStream &stream() { return stream_; }
 
     LogSeverity severity() const { return severity_; }
 
-    std::string str() const { return stream_.str(); }
+    std::string str() const { return stream_.buffer(); }
 
     const char *file() const { return file_; }
 
@@ -185,7 +783,7 @@ private:
 
     void HandleFatal(size_t stack_start, const std::string &str_newline) const;
 
-    std::ostringstream stream_;
+    LogStream          stream_;
     // Offset of the start of the message (past prefix info).
     size_t             message_start_;
     // The file and line information passed in to the constructor.
@@ -193,8 +791,67 @@ private:
     const char        *func_;
     const int32_t      line_;
     const LogSeverity  severity_;
+    // Minimum level the record is filtered by, global or the logger's one.
+    const int32_t      min_level_;
+    // Set when the record is only created for live tail subscribers.
+    bool               tail_only_;
+    // Set when the record is only captured for the backtrace ring, its prefix
+    // is formatted when the ring is dumped.
+    bool               backtrace_only_;
+    bool               __pad_[2];
+    // Set for CO_LOG(), see LogPendingRecord.
+    LogPendingRecord  *const pending_;
+};
+
+// Context captured by CaptureLogContext(), see ScopedLogContext.
+struct LogContext {
+    std::string rendered;    // "[key=value] " of every scope, outermost first.
+};
+
+// Thread-local log context. Every record logged by the thread while the scope
+// is alive starts with "[key=value] ", scopes nest and are appended in order.
+// The value is formatted once when the scope is pushed, records only copy the
+// cached bytes. The context is part of the message: it is kept in binary log
+// files and records with different contexts are never coalesced.
+//
+//   ScopedLogContext req("req", request_id);
+//   LOG(INFO) << "accepted";    // "[req=42] accepted"
+//
+// To carry the context over a thread-pool hop, capture it when the task is
+// queued and restore it for the duration of the task:
+//
+//   LogContext context = CaptureLogContext();
+//   pool.Post([context] { ScopedLogContext restore(context); ... });
+class ScopedLogContext {
+public:
+    template < typename T >
+    ScopedLogContext(const char *key, const T &value) : length_(0)
+    {
+        LogStream stream;
+        stream << value;
+        Push(key, stream.buffer());
+    }
+
+    // Replaces the context of the thread with |context| until destruction.
+    explicit ScopedLogContext(const LogContext &context);
+
+    ScopedLogContext(const ScopedLogContext &)            = delete;
+    ScopedLogContext &operator=(const ScopedLogContext &) = delete;
+
+    ~ScopedLogContext();
+
+private:
+    void Push(const char *key, const std::string &value);
+
+    // Context replaced by a restoring scope.
+    std::string saved_;
+    // Length of the context before a pushing scope, SIZE_MAX when restoring.
+    size_t      length_;
 };
 
+// Captures the context of the calling thread.
+LogContext CaptureLogContext();
+
 // This class is used to explicitly ignore values in the conditional
 // logging macros.  This avoids compiler warnings like "value computed
 // is not used" and "statement has no effect".
@@ -204,7 +861,7 @@ public:
 
     // This has to be an operator with a precedence lower than << but
     // higher than ?:
-    void operator&(std::ostream &) { }
+    void operator&(LogStream &) { }
 };
 
 // Helper macro which avoids evaluating the arguments to a stream if
@@ -217,7 +874,28 @@ public:
 // always fire if they fail.
 // FATAL is always enabled and required to be resolved in compile time for
 // LOG(FATAL) to be properly understood as [[noreturn]].
-#define LOG_IS_ON(severity) (::logging::ShouldCreateLogMessage(::logging::LOGGING_##severity))
+#define LOG_IS_ON(severity) (::logging::LogIsOn(::logging::LOGGING_##severity))
+
+// Lowest severity for which ShouldCreateLogMessage() holds, maintained by the
+// setters. LOG_IS_ON() is a single relaxed load and compare against it, so a
+// disabled LOG() costs one predicted branch and no call into the library.
+extern std::atomic< int32_t > g_log_create_level;
+
+inline bool LogIsOn(LogSeverity severity)
+{
+    return severity >= g_log_create_level.load(std::memory_order_relaxed);
+}
+
+// Evaluates to a pointer to a static LogCallSite describing the expanding
+// callsite. A statement expression is used instead of a lambda so that
+// __func__ still names the enclosing function, the descriptor is constant
+// initialized and lives in read-only data.
+#define LOG_CALLSITE()                                       \
+    __extension__({                                          \
+        static const ::logging::LogCallSite log_callsite = { \
+            __FILE__, __func__, __LINE__, 0};                \
+        &log_callsite;                                       \
+    })
 
 // We use the preprocessor's merging operator, "##", so that, e.g.,
 // LOG(INFO) becomes the token COMPACT_LOG_INFO.  There's some funny
@@ -228,13 +906,316 @@ public:
 // ostream. We employ a neat hack by calling the stream() member
 // function of LogMessage which seems to avoid the problem.
 #define LOG_STREAM(severity) \
-    ::logging::LogMessage(__FILE__, __func__, __LINE__, ::logging::LOGGING_##severity).stream()
+    ::logging::LogMessage(*LOG_CALLSITE(), ::logging::LOGGING_##severity).stream()
 // 基础日志类型, 直接日志输出.
 #define LOG(severity) LAZY_STREAM(LOG_STREAM(severity), LOG_IS_ON(severity))
 // 拓展日志类型, 简单条件日志输出.
 #define LOG_IF(severity, condition) \
     LAZY_STREAM(LOG_STREAM(severity), LOG_IS_ON(severity) && (condition))
 
+// Logs through a named logger, see Logger.
+#define LOG_TO_STREAM(logger, severity)                                             \
+    ::logging::LogMessage(*LOG_CALLSITE(), ::logging::LOGGING_##severity, (logger)) \
+        .stream()
+#define LOG_TO(logger, severity) \
+    LAZY_STREAM(LOG_TO_STREAM(logger, severity), (logger).IsOn(::logging::LOGGING_##severity))
+#define LOG_TO_IF(logger, severity, condition)   \
+    LAZY_STREAM(LOG_TO_STREAM(logger, severity), \
+        (logger).IsOn(::logging::LOGGING_##severity) && (condition))
+
+// Per-callsite VLOG state. The verbose level for the callsite's file is
+// resolved once and cached here together with the configuration generation
+// it was resolved against, SetVmodule() and SetMinLogLevel() bump the
+// generation so that callsites re-resolve lazily on their next call.
+struct VlogCallSite {
+    constexpr explicit VlogCallSite(const char *file_name) : state(0), file(file_name) { }
+
+    // 高32位为配置代数, 低32位为解析得到的详细日志等级
+    std::atomic< uint64_t > state;
+    const char             *file;
+};
+
+// Current VLOG configuration generation, defined in easelog_vlog.cpp.
+extern std::atomic< uint32_t > g_vlog_generation;
+
+// Resolves the callsite's verbose level and caches it, used when the cached
+// generation is stale.
+bool VlogIsOnSlow(VlogCallSite &site, int32_t verbose_level);
+
+// Used by VLOG_IS_ON, the fast path is two relaxed loads and a compare.
+// Always inlined, so large translation units built with -Winline don't fail
+// once GCC's unit growth limit is reached.
+[[gnu::always_inline]] inline bool VlogIsOn(VlogCallSite &site, int32_t verbose_level)
+{
+    uint32_t generation = g_vlog_generation.load(std::memory_order_relaxed);
+    uint64_t state      = site.state.load(std::memory_order_relaxed);
+
+    if (__builtin_expect(static_cast< uint32_t >(state >> 32) != generation, 0)) {
+        return VlogIsOnSlow(site, verbose_level);
+    }
+    return verbose_level <= static_cast< int32_t >(static_cast< uint32_t >(state));
+}
+
+// Helpers used by the rate-limited and sampled logging macros below. Each
+// macro owns a static per-callsite counter (or timestamp), so a suppressed
+// call only touches the cache line of its own callsite and never constructs
+// a LogMessage.
+
+// Returns true for the 1st, (n+1)th, (2n+1)th... call.
+inline bool LogEveryNShouldLog(std::atomic< uint32_t > &counter, uint32_t n)
+{
+    uint32_t count = counter.fetch_add(1, std::memory_order_relaxed);
+    return n <= 1 || count % n == 0;
+}
+
+// Returns true for the first |n| calls only. Once saturated the counter is
+// only read, so the callsite's cache line stays shared between CPUs.
+inline bool LogFirstNShouldLog(std::atomic< uint32_t > &counter, uint32_t n)
+{
+    if (counter.load(std::memory_order_relaxed) >= n) {
+        return false;
+    }
+    return counter.fetch_add(1, std::memory_order_relaxed) < n;
+}
+
+// Returns true at most once every |seconds|, |next_us| holds the next
+// deadline in TickCountUs() units.
+bool LogEveryTShouldLog(std::atomic< uint64_t > &next_us, double seconds);
+
+// Seeds the thread-local random state used by LOG_SAMPLED, never returns 0.
+uint64_t LogSampleSeed();
+
+// Returns true with probability |probability|, using a thread-local
+// xorshift64* generator, so there is no shared state at all.
+inline bool LogSampledShouldLog(double probability)
+{
+    static thread_local uint64_t g_sample_state = 0;
+
+    if (probability >= 1.0) {
+        return true;
+    }
+    if (!(probability > 0.0)) {
+        return false;
+    }
+    if (g_sample_state == 0) {
+        g_sample_state = LogSampleSeed();
+    }
+    g_sample_state ^= g_sample_state >> 12;
+    g_sample_state ^= g_sample_state << 25;
+    g_sample_state ^= g_sample_state >> 27;
+    uint64_t random = g_sample_state * 0x2545F4914F6CDD1DULL;
+    // 取高53位映射到[0, 1)区间
+    return static_cast< double >(random >> 11) * (1.0 / 9007199254740992.0) < probability;
+}
+
+// Declares a static object private to the expanding callsite and evaluates
+// to a reference to it. std::atomic has a constexpr constructor, so the
+// object is constant-initialized and there is no guard variable on the path.
+#define LOG_CALLSITE_STATIC(type)      \
+    ([]() -> type & {                  \
+        static type callsite_state(0); \
+        return callsite_state;         \
+    }())
+
+// 限流日志类型, 每n次输出一次, 第一次总是输出.
+#define LOG_IF_EVERY_N(severity, condition, n) \
+    LAZY_STREAM(LOG_STREAM(severity),          \
+        LOG_IS_ON(severity) && (condition) &&  \
+            ::logging::LogEveryNShouldLog(     \
+                LOG_CALLSITE_STATIC(std::atomic< uint32_t >), static_cast< uint32_t >(n)))
+#define LOG_EVERY_N(severity, n) LOG_IF_EVERY_N(severity, true, n)
+
+// 限流日志类型, 只输出前n次.
+#define LOG_IF_FIRST_N(severity, condition, n) \
+    LAZY_STREAM(LOG_STREAM(severity),          \
+        LOG_IS_ON(severity) && (condition) &&  \
+            ::logging::LogFirstNShouldLog(     \
+                LOG_CALLSITE_STATIC(std::atomic< uint32_t >), static_cast< uint32_t >(n)))
+#define LOG_FIRST_N(severity, n) LOG_IF_FIRST_N(severity, true, n)
+
+// 限流日志类型, 每seconds秒最多输出一次, 支持小数.
+#define LOG_IF_EVERY_T(severity, condition, seconds) \
+    LAZY_STREAM(LOG_STREAM(severity),                \
+        LOG_IS_ON(severity) && (condition) &&        \
+            ::logging::LogEveryTShouldLog(           \
+                LOG_CALLSITE_STATIC(std::atomic< uint64_t >), static_cast< double >(seconds)))
+#define LOG_EVERY_T(severity, seconds) LOG_IF_EVERY_T(severity, true, seconds)
+
+// 采样日志类型, 按照概率p(0.0-1.0)输出.
+#define LOG_IF_SAMPLED(severity, condition, p) \
+    LAZY_STREAM(LOG_STREAM(severity),          \
+        LOG_IS_ON(severity) && (condition) &&  \
+            ::logging::LogSampledShouldLog(static_cast< double >(p)))
+#define LOG_SAMPLED(severity, p) LOG_IF_SAMPLED(severity, true, p)
+
+// Verbose logging, VLOG(n) is logged at severity -n when the verbose level of
+// the current file (see SetVmodule()) is at least n.
+#define VLOG_IS_ON(verbose_level)                                    \
+    ::logging::VlogIsOn(                                             \
+        ([]() -> ::logging::VlogCallSite & {                         \
+            static ::logging::VlogCallSite callsite_state(__FILE__); \
+            return callsite_state;                                   \
+        }()),                                                        \
+        (verbose_level))
+#define VLOG_STREAM(verbose_level) \
+    ::logging::LogMessage(*LOG_CALLSITE(), -(verbose_level)).stream()
+#define VLOG(verbose_level) LAZY_STREAM(VLOG_STREAM(verbose_level), VLOG_IS_ON(verbose_level))
+#define VLOG_IF(verbose_level, condition) \
+    LAZY_STREAM(VLOG_STREAM(verbose_level), VLOG_IS_ON(verbose_level) && (condition))
+
+// Holds the message of a failed CHECK. CheckError is a single pointer and all
+// of its non-trivial members are outlined into cold functions, so the inline
+// part of a CHECK is the condition, one not-taken branch and a jump to a cold
+// block. The destructor flushes the message and terminates the process.
+class CheckError {
+public:
+    // Used by CHECK() and PCHECK(), PCHECK() appends the errno description.
+    [[gnu::cold, gnu::noinline]] static CheckError Check(const LogCallSite &site,
+        const char *condition);
+    [[gnu::cold, gnu::noinline]] static CheckError PCheck(const LogCallSite &site,
+        const char *condition);
+
+    // Used by CHECK_EQ() and friends, takes ownership of the message built by
+    // MakeCheckOpString().
+    [[gnu::cold, gnu::noinline]] static CheckError CheckOp(const LogCallSite &site,
+        std::string *message);
+
+    CheckError(CheckError &&other) : log_message_(other.log_message_)
+    {
+        other.log_message_ = nullptr;
+    }
+    CheckError(const CheckError &)            = delete;
+    CheckError &operator=(const CheckError &) = delete;
+    [[gnu::cold, gnu::noinline]] ~CheckError();
+
+    LogStream &stream() { return log_message_->stream(); }
+
+private:
+    explicit CheckError(LogMessage *log_message) : log_message_(log_message) { }
+
+    LogMessage *log_message_;
+};
+
+// Result of a CHECK_op comparison, converts to true when the check passed and
+// otherwise holds the "a == b (1 vs. 2)" message.
+class CheckOpResult {
+public:
+    explicit CheckOpResult(std::string *message = nullptr) : message_(message) { }
+
+    explicit operator bool() const { return message_ == nullptr; }
+
+    std::string *message() const { return message_; }
+
+private:
+    std::string *message_;
+};
+
+// Builds the CHECK_op failure message. Only reached on failure, and kept out of
+// line so that the operand formatting is not inlined into the callsite.
+template < typename T1, typename T2 >
+[[gnu::cold, gnu::noinline]] std::string *MakeCheckOpString(const T1 &v1, const T2 &v2,
+    const char *names)
+{
+    std::ostringstream ss;
+    ss << names << " (" << v1 << " vs. " << v2 << ")";
+    return new std::string(ss.str());
+}
+
+// Common instantiations are emitted once in the library.
+extern template std::string *MakeCheckOpString< int, int >(const int &, const int &,
+    const char *);
+extern template std::string *MakeCheckOpString< long, long >(const long &, const long &,
+    const char *);
+extern template std::string *MakeCheckOpString< unsigned int, unsigned int >(
+    const unsigned int &, const unsigned int &, const char *);
+extern template std::string *MakeCheckOpString< unsigned long, unsigned long >(
+    const unsigned long &, const unsigned long &, const char *);
+extern template std::string *MakeCheckOpString< std::string, std::string >(
+    const std::string &, const std::string &, const char *);
+
+#define DEFINE_CHECK_OP_IMPL(name, op)                                                    \
+    template < typename T1, typename T2 >                                                 \
+    inline CheckOpResult Check##name##Impl(const T1 &v1, const T2 &v2, const char *names) \
+    {                                                                                     \
+        if (__builtin_expect(!!(v1 op v2), 1)) {                                          \
+            return CheckOpResult();                                                       \
+        }                                                                                 \
+        return CheckOpResult(MakeCheckOpString(v1, v2, names));                           \
+    }
+DEFINE_CHECK_OP_IMPL(EQ, ==)
+DEFINE_CHECK_OP_IMPL(NE, !=)
+DEFINE_CHECK_OP_IMPL(LE, <=)
+DEFINE_CHECK_OP_IMPL(LT, <)
+DEFINE_CHECK_OP_IMPL(GE, >=)
+DEFINE_CHECK_OP_IMPL(GT, >)
+#undef DEFINE_CHECK_OP_IMPL
+
+// CHECK dies with a fatal error if condition is not true. It is not controlled
+// by NDEBUG, so the check will be executed regardless of compilation mode.
+#define CHECK(condition)                                                            \
+    LAZY_STREAM(::logging::CheckError::Check(*LOG_CALLSITE(), #condition).stream(), \
+        __builtin_expect(!(condition), 0))
+
+// PCHECK is like CHECK, but appends the errno description to the message.
+#define PCHECK(condition)                                                            \
+    LAZY_STREAM(::logging::CheckError::PCheck(*LOG_CALLSITE(), #condition).stream(), \
+        __builtin_expect(!(condition), 0))
+
+// CHECK_EQ(a, b) and friends, the message includes both operand values. The
+// switch wrapper makes the macro a single statement which can't capture a
+// dangling else, and still accepts a trailing "<< message".
+#define CHECK_OP(name, op, val1, val2)                                                 \
+    switch (0)                                                                         \
+    case 0:                                                                            \
+    default:                                                                           \
+        if (::logging::CheckOpResult check_op_result =                                 \
+                ::logging::Check##name##Impl((val1), (val2), #val1 " " #op " " #val2)) \
+            ;                                                                          \
+        else                                                                           \
+            ::logging::CheckError::CheckOp(*LOG_CALLSITE(), check_op_result.message()) \
+                .stream()
+
+#define CHECK_EQ(val1, val2) CHECK_OP(EQ, ==, val1, val2)
+#define CHECK_NE(val1, val2) CHECK_OP(NE, !=, val1, val2)
+#define CHECK_LE(val1, val2) CHECK_OP(LE, <=, val1, val2)
+#define CHECK_LT(val1, val2) CHECK_OP(LT, <, val1, val2)
+#define CHECK_GE(val1, val2) CHECK_OP(GE, >=, val1, val2)
+#define CHECK_GT(val1, val2) CHECK_OP(GT, >, val1, val2)
+
+// Never instantiated, it gives EAT_STREAM_PARAMETERS a stream on the left
+// hand side of the unused part of the ternary operator.
+extern LogStream *g_swallow_stream;
+#define EAT_STREAM_PARAMETERS \
+    true ? (void)0 : ::logging::LogMessageVoidify() & (*::logging::g_swallow_stream)
+
+// DCHECKs are enabled in debug builds, or when DCHECK_ALWAYS_ON is defined.
+// Otherwise the arguments are still type-checked but never evaluated.
+#if defined(NDEBUG) && !defined(DCHECK_ALWAYS_ON)
+#define DCHECK_IS_ON() 0
+#else
+#define DCHECK_IS_ON() 1
+#endif
+
+#if DCHECK_IS_ON()
+#define DCHECK(condition)     CHECK(condition)
+#define DPCHECK(condition)    PCHECK(condition)
+#define DCHECK_EQ(val1, val2) CHECK_EQ(val1, val2)
+#define DCHECK_NE(val1, val2) CHECK_NE(val1, val2)
+#define DCHECK_LE(val1, val2) CHECK_LE(val1, val2)
+#define DCHECK_LT(val1, val2) CHECK_LT(val1, val2)
+#define DCHECK_GE(val1, val2) CHECK_GE(val1, val2)
+#define DCHECK_GT(val1, val2) CHECK_GT(val1, val2)
+#else
+#define DCHECK(condition)     EAT_STREAM_PARAMETERS << !(condition)
+#define DPCHECK(condition)    EAT_STREAM_PARAMETERS << !(condition)
+#define DCHECK_EQ(val1, val2) EAT_STREAM_PARAMETERS << ((val1) == (val2))
+#define DCHECK_NE(val1, val2) EAT_STREAM_PARAMETERS << ((val1) != (val2))
+#define DCHECK_LE(val1, val2) EAT_STREAM_PARAMETERS << ((val1) <= (val2))
+#define DCHECK_LT(val1, val2) EAT_STREAM_PARAMETERS << ((val1) < (val2))
+#define DCHECK_GE(val1, val2) EAT_STREAM_PARAMETERS << ((val1) >= (val2))
+#define DCHECK_GT(val1, val2) EAT_STREAM_PARAMETERS << ((val1) > (val2))
+#endif    // DCHECK_IS_ON()
+
 }    // namespace logging
 
 #endif    // EASELOG_LOGGING_H_
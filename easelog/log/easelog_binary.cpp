@@ -0,0 +1,206 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_binary.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 19:10
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  二进制日志文件的编码, 调用点和线程信息每个块只写入一次, 日志只引用字典id.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+
+namespace logging {
+
+// 调用点字典的键, 调用点的字符串都是常量, 直接比较指针
+struct LogBinaryCallSiteKey {
+    const char *file;
+    const char *func;
+    int32_t     line;
+    LogSeverity severity;
+
+    bool operator==(const LogBinaryCallSiteKey &other) const
+    {
+        return file == other.file && func == other.func && line == other.line &&
+            severity == other.severity;
+    }
+};
+
+struct LogBinaryCallSiteHash {
+    size_t operator()(const LogBinaryCallSiteKey &key) const
+    {
+        size_t hash = std::hash< const void * >()(key.file);
+        hash        = hash * 31 + std::hash< const void * >()(key.func);
+        hash        = hash * 31 + static_cast< size_t >(key.line);
+        return hash * 31 + static_cast< size_t >(key.severity);
+    }
+};
+
+// 二进制日志文件的编码状态, 由日志锁保护. 字典在每个块开始时清空.
+using LogBinaryCallSiteMap =
+    std::unordered_map< LogBinaryCallSiteKey, uint32_t, LogBinaryCallSiteHash >;
+
+struct LogBinaryWriter {
+    LogBinaryCallSiteMap                    callsites;      // 调用点字典
+    std::unordered_map< int32_t, uint32_t > threads;        // 线程字典, 键为线程ID
+    std::string                             buffer;         // 编码缓冲区
+    uint64_t                                block_bytes;    // 当前块已经写入的字节数
+    uint64_t                                last_us;        // 上一行日志的时间, 时间差的基准
+};
+
+static LogBinaryWriter g_log_binary = {{}, {}, {}, LOG_BINARY_BLOCK_SIZE, 0};
+
+// 登记的线程名字, 由日志锁保护, 线程ID被复用时覆盖
+static std::unordered_map< int32_t, std::string > g_log_thread_names;
+
+// export: 计算块头部的校验值, FNV-1a哈希覆盖同步标记之后的字段
+uint32_t LogBinaryBlockCheck(const LogBinaryBlockHeader &header)
+{
+    const uint8_t *data = reinterpret_cast< const uint8_t * >(&header.first_us);
+    uint32_t       hash = 0x811c9dc5;
+
+    for (size_t i = 0; i < offsetof(LogBinaryBlockHeader, check) - sizeof(header.magic); i++) {
+        hash ^= data[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+// export: 登记线程名字, 调用者需要持有日志锁
+void RegisterLogThreadLocked(int32_t tid, const char *name)
+{
+    g_log_thread_names[tid] = name;
+}
+
+// export: 重新开始二进制日志文件, 调用者需要持有日志锁
+void ResetLogBinaryWriter()
+{
+    g_log_binary.block_bytes = LOG_BINARY_BLOCK_SIZE;
+}
+
+static void AppendVarint(std::string &buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back(static_cast< char >((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast< char >(value));
+}
+
+static void AppendSigned(std::string &buffer, int64_t value)
+{
+    // zigzag变换, 绝对值小的负数也编码为短的变长整数
+    uint64_t zigzag = (static_cast< uint64_t >(value) << 1) ^ static_cast< uint64_t >(value >> 63);
+    AppendVarint(buffer, zigzag);
+}
+
+static void AppendString(std::string &buffer, const char *data, size_t length)
+{
+    AppendVarint(buffer, length);
+    buffer.append(data, length);
+}
+
+// 开始一个新的块, 写入块头部并清空字典
+static void StartLogBinaryBlock(std::string &buffer, uint64_t now_us)
+{
+    LogBinaryBlockHeader header;
+
+    memcpy(header.magic, LOG_BINARY_MAGIC, sizeof(header.magic));
+    header.first_us = now_us;
+    header.version  = LOG_BINARY_VERSION;
+    header.check    = LogBinaryBlockCheck(header);
+    buffer.append(reinterpret_cast< const char * >(&header), sizeof(header));
+
+    g_log_binary.callsites.clear();
+    g_log_binary.threads.clear();
+    g_log_binary.last_us = now_us;
+}
+
+// 查找调用点id, 第一次出现时写入调用点字典
+static uint32_t LogBinaryCallSiteId(std::string &buffer, const LogBinaryLine &line)
+{
+    LogBinaryCallSiteKey key    = {line.file, line.func, line.line, line.severity};
+    auto                 result = g_log_binary.callsites.emplace(key,
+        static_cast< uint32_t >(g_log_binary.callsites.size()));
+
+    if (result.second) {
+        buffer.push_back(LOG_BINARY_CALLSITE);
+        AppendVarint(buffer, result.first->second);
+        AppendSigned(buffer, line.severity);
+        AppendSigned(buffer, line.line);
+        AppendString(buffer, line.file, strlen(line.file));
+        AppendString(buffer, line.func, strlen(line.func));
+    }
+    return result.first->second;
+}
+
+// 查找线程id, 第一次出现时写入线程字典, 没有登记的线程名字为空
+static uint32_t LogBinaryThreadId(std::string &buffer, int32_t tid)
+{
+    auto result = g_log_binary.threads.emplace(tid,
+        static_cast< uint32_t >(g_log_binary.threads.size()));
+
+    if (result.second) {
+        auto        name    = g_log_thread_names.find(tid);
+        const char *program = GetLogProgramName();
+        buffer.push_back(LOG_BINARY_THREAD);
+        AppendVarint(buffer, result.first->second);
+        AppendSigned(buffer, GetLogProcessId());
+        AppendSigned(buffer, tid);
+        if (name != g_log_thread_names.end()) {
+            AppendString(buffer, name->second.data(), name->second.size());
+        } else {
+            AppendString(buffer, "", 0);
+        }
+        AppendString(buffer, program, strlen(program));
+    }
+    return result.first->second;
+}
+
+// export: 编码一行日志, 当前块写满时先开始新的块, 调用者需要持有日志锁
+const std::string &EncodeLogBinaryLineLocked(const LogBinaryLine &line)
+{
+    std::string &buffer = g_log_binary.buffer;
+    uint64_t     now_us = static_cast< uint64_t >(line.tv.tv_sec) * 1000000 +
+        static_cast< uint64_t >(line.tv.tv_usec);
+
+    buffer.clear();
+    if (g_log_binary.block_bytes >= LOG_BINARY_BLOCK_SIZE) {
+        StartLogBinaryBlock(buffer, now_us);
+        g_log_binary.block_bytes = 0;
+    }
+
+    int64_t delta        = static_cast< int64_t >(now_us - g_log_binary.last_us);
+    g_log_binary.last_us = now_us;
+    if (line.file != nullptr) {
+        uint32_t callsite = LogBinaryCallSiteId(buffer, line);
+        uint32_t thread   = LogBinaryThreadId(buffer, line.tid);
+        buffer.push_back(LOG_BINARY_RECORD);
+        AppendVarint(buffer, callsite);
+        AppendVarint(buffer, thread);
+        AppendSigned(buffer, delta);
+    } else {
+        buffer.push_back(LOG_BINARY_TEXT);
+        AppendVarint(buffer, line.severity_mask);
+        AppendVarint(buffer, line.timestamp);
+        AppendSigned(buffer, delta);
+    }
+    AppendString(buffer, line.text, line.length);
+
+    g_log_binary.block_bytes += buffer.size();
+    return buffer;
+}
+
+}    // namespace logging
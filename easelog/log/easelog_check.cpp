@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_check.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 14:20
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  实现CHECK/PCHECK/CHECK_op失败时的冷路径, 调用点只保留条件判断和一次跳转.
+ *
+ */
+
+#include "log/easelog.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <string>
+
+namespace logging {
+
+// PCHECK使用的日志消息, 构造时保存errno, 析构输出前追加错误描述.
+class ErrnoLogMessage : public LogMessage {
+public:
+    ErrnoLogMessage(const LogCallSite &site, const char *condition, int err)
+        : LogMessage(site, condition), condition_end_(stream().buffer().size()), err_(err),
+          __pad(0)
+    {
+    }
+
+    ~ErrnoLogMessage() override
+    {
+        char buf[256];
+        // 条件后面已经有". ", 只有追加了消息时才需要分隔符
+        if (stream().buffer().size() != condition_end_) {
+            stream() << ": ";
+        }
+        // GNU版本的strerror_r, 返回值可能不指向buf
+        stream() << strerror_r(err_, buf, sizeof(buf)) << " (" << err_ << ")";
+    }
+
+private:
+    size_t   condition_end_;
+    int      err_;
+    uint32_t __pad;
+};
+
+// export: CHECK失败, 构造致命日志消息
+CheckError CheckError::Check(const LogCallSite &site, const char *condition)
+{
+    return CheckError(new LogMessage(site, condition));
+}
+
+// export: PCHECK失败, 先保存errno, 避免构造日志消息时被修改
+CheckError CheckError::PCheck(const LogCallSite &site, const char *condition)
+{
+    int err = errno;
+    return CheckError(new ErrnoLogMessage(site, condition, err));
+}
+
+// export: CHECK_op失败, 接管比较结果消息的所有权
+CheckError CheckError::CheckOp(const LogCallSite &site, std::string *message)
+{
+    CheckError check_error(new LogMessage(site, LOGGING_FATAL));
+
+    check_error.stream() << "Check failed: " << *message << ". ";
+    delete message;
+    return check_error;
+}
+
+// 析构时输出日志消息, 致命日志会在LogMessage析构中终止进程
+CheckError::~CheckError()
+{
+    delete log_message_;
+}
+
+// 常用类型的CHECK_op消息构造函数在库中实例化一次
+template std::string *MakeCheckOpString< int, int >(const int &, const int &, const char *);
+template std::string *MakeCheckOpString< long, long >(const long &, const long &,
+    const char *);
+template std::string *MakeCheckOpString< unsigned int, unsigned int >(const unsigned int &,
+    const unsigned int &, const char *);
+template std::string *MakeCheckOpString< unsigned long, unsigned long >(const unsigned long &,
+    const unsigned long &, const char *);
+template std::string *MakeCheckOpString< std::string, std::string >(const std::string &,
+    const std::string &, const char *);
+
+}    // namespace logging
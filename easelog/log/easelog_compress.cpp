@@ -0,0 +1,849 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_compress.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 23:30
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  压缩日志文件, 日志在日志锁内拷贝到当前块, 块写满后由压缩线程池压缩, 按照封装顺序写入.
+ *  压缩线程落后时块直接保存, 不再排队. 内置LZ77算法, 不依赖外部压缩库.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+// LZ77压缩参数, 格式和LZ4块格式相同: 标记字节的高4位是字面量长度, 低4位是匹配长度减4,
+// 长度为15时后面跟扩展字节, 匹配偏移为2字节小端序. 最后一段只有字面量.
+#define LOG_LZ_HASH_BITS     14
+#define LOG_LZ_MIN_MATCH     4
+#define LOG_LZ_MAX_OFFSET    65535
+#define LOG_LZ_LAST_LITERALS 5     // 最后至少5个字节是字面量
+#define LOG_LZ_MATCH_LIMIT   12    // 最后12个字节内不再开始匹配
+
+// 每个压缩线程最多对应的排队块数量, 超过时封装块的线程等待写入完成
+#define LOG_COMPRESS_BLOCKS_PER_WORKER 4
+// 没有写满的块最多等待的时间, 之后由空闲的压缩线程封装
+#define LOG_COMPRESS_FLUSH_MS 1000
+// 解码时允许的最大块大小, 用于排除损坏的帧头部
+#define LOG_COMPRESS_MAX_RAW (64 * 1024 * 1024)
+
+// 压缩的设置, 下次打开日志文件时生效, 块大小为0时关闭
+static uint32_t g_log_compress_block_size = 0;
+static uint32_t g_log_compress_workers    = 0;
+
+// 是否正在压缩写入日志文件, 异步信号安全
+static std::atomic< bool > g_log_compress_active(false);
+
+// 压缩写入的统计
+static std::atomic< uint64_t > g_log_compress_frames(0);
+static std::atomic< uint64_t > g_log_compress_stored(0);
+static std::atomic< uint64_t > g_log_compress_raw_bytes(0);
+static std::atomic< uint64_t > g_log_compress_file_bytes(0);
+
+// export: 设置压缩写入, 下次打开日志文件时生效
+void SetLogFileCompression(uint32_t block_kb, uint32_t workers)
+{
+    // 块大小不超过解码时允许的最大值, 否则写入的帧会被当作损坏的内容
+    block_kb                  = std::min< uint32_t >(block_kb, LOG_COMPRESS_MAX_RAW / 1024);
+    g_log_compress_block_size = block_kb * 1024;
+    g_log_compress_workers    = block_kb != 0 ? std::max(workers, 1u) : 0;
+}
+
+// export: 判断日志文件是否正在压缩写入
+bool IsLogFileCompressed()
+{
+    return g_log_compress_active.load(std::memory_order_relaxed);
+}
+
+// export: 获取压缩写入的统计
+LogCompressStats GetLogCompressStats()
+{
+    LogCompressStats stats;
+
+    stats.frames        = g_log_compress_frames.load(std::memory_order_relaxed);
+    stats.stored_frames = g_log_compress_stored.load(std::memory_order_relaxed);
+    stats.raw_bytes     = g_log_compress_raw_bytes.load(std::memory_order_relaxed);
+    stats.file_bytes    = g_log_compress_file_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// export: 计算帧头部的校验值, FNV-1a哈希覆盖同步标记之后的字段
+uint32_t LogCompressFrameCheck(const LogCompressFrameHeader &header)
+{
+    const uint8_t *data = reinterpret_cast< const uint8_t * >(&header.first_us);
+    uint32_t       hash = 0x811c9dc5;
+
+    for (size_t i = 0; i < offsetof(LogCompressFrameHeader, check) - sizeof(header.magic); i++) {
+        hash ^= data[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static inline uint32_t ReadLzWord(const uint8_t *data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline uint32_t LzHash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - LOG_LZ_HASH_BITS);
+}
+
+// 写入长度的扩展字节, 每个255表示继续
+static uint8_t *WriteLzLength(uint8_t *output, size_t length)
+{
+    while (length >= 255) {
+        *output++ = 255;
+        length -= 255;
+    }
+    *output++ = static_cast< uint8_t >(length);
+    return output;
+}
+
+// 写入一个序列: 字面量, 匹配偏移和匹配长度, offset为0时只有字面量.
+// 输出空间不足时返回nullptr.
+static uint8_t *WriteLzSequence(uint8_t *output, const uint8_t *output_end,
+    const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length)
+{
+    size_t need = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+
+    if (static_cast< size_t >(output_end - output) < need) {
+        return nullptr;
+    }
+
+    uint8_t *token = output++;
+    *token = static_cast< uint8_t >(std::min< size_t >(literal_length, 15) << 4);
+    if (literal_length >= 15) {
+        output = WriteLzLength(output, literal_length - 15);
+    }
+    memcpy(output, literals, literal_length);
+    output += literal_length;
+    if (offset == 0) {
+        return output;
+    }
+
+    *output++ = static_cast< uint8_t >(offset & 0xff);
+    *output++ = static_cast< uint8_t >(offset >> 8);
+    *token    = static_cast< uint8_t >(*token | std::min< size_t >(match_length, 15));
+    if (match_length >= 15) {
+        output = WriteLzLength(output, match_length - 15);
+    }
+    return output;
+}
+
+// export: 压缩一块数据, 压缩后不小于原始长度或者输出空间不足时返回0.
+// 哈希表是线程私有的, 只在压缩线程中调用.
+size_t LogLzCompress(const char *data, size_t length, char *output, size_t capacity)
+{
+    static thread_local uint32_t table[1 << LOG_LZ_HASH_BITS];
+
+    const uint8_t *base   = reinterpret_cast< const uint8_t * >(data);
+    uint8_t       *start  = reinterpret_cast< uint8_t * >(output);
+    uint8_t       *end    = start + std::min(capacity, length);
+    uint8_t       *cursor = start;
+    size_t         anchor = 0;
+    size_t         pos    = 0;
+
+    memset(table, 0, sizeof(table));
+    while (length >= LOG_LZ_MATCH_LIMIT && pos <= length - LOG_LZ_MATCH_LIMIT) {
+        uint32_t word = ReadLzWord(base + pos);
+        uint32_t hash = LzHash(word);
+        size_t   ref  = table[hash];
+
+        table[hash] = static_cast< uint32_t >(pos);
+        if (ref >= pos || pos - ref > LOG_LZ_MAX_OFFSET || ReadLzWord(base + ref) != word) {
+            // 连续没有匹配时加大步长, 不可压缩的数据很快扫描完
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+
+        size_t match = pos + LOG_LZ_MIN_MATCH;
+        size_t from  = ref + LOG_LZ_MIN_MATCH;
+        while (match < length - LOG_LZ_LAST_LITERALS && base[match] == base[from]) {
+            match++;
+            from++;
+        }
+        while (pos > anchor && ref > 0 && base[pos - 1] == base[ref - 1]) {
+            pos--;
+            ref--;
+        }
+
+        cursor = WriteLzSequence(cursor, end, base + anchor, pos - anchor, pos - ref,
+            match - pos - LOG_LZ_MIN_MATCH);
+        if (cursor == nullptr) {
+            return 0;
+        }
+        pos    = match;
+        anchor = match;
+    }
+
+    cursor = WriteLzSequence(cursor, end, base + anchor, length - anchor, 0, 0);
+    if (cursor == nullptr || cursor >= start + length) {
+        return 0;
+    }
+    return static_cast< size_t >(cursor - start);
+}
+
+// 读取长度的扩展字节
+static bool ReadLzLength(const uint8_t *&input, const uint8_t *end, size_t *length)
+{
+    uint8_t byte;
+
+    do {
+        if (input >= end) {
+            return false;
+        }
+        byte = *input++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// export: 解压一块数据, 输出长度必须正好是raw_length, 格式错误时返回false
+bool LogLzDecompress(const char *data, size_t length, char *output, size_t raw_length)
+{
+    const uint8_t *input      = reinterpret_cast< const uint8_t * >(data);
+    const uint8_t *input_end  = input + length;
+    uint8_t       *start      = reinterpret_cast< uint8_t * >(output);
+    uint8_t       *cursor     = start;
+    uint8_t       *output_end = start + raw_length;
+
+    while (input < input_end) {
+        uint8_t token    = *input++;
+        size_t  literals = token >> 4;
+        if (literals == 15 && !ReadLzLength(input, input_end, &literals)) {
+            return false;
+        }
+        if (literals > static_cast< size_t >(input_end - input) ||
+            literals > static_cast< size_t >(output_end - cursor)) {
+            return false;
+        }
+        memcpy(cursor, input, literals);
+        input += literals;
+        cursor += literals;
+        if (input == input_end) {
+            break;
+        }
+
+        if (input_end - input < 2) {
+            return false;
+        }
+        size_t offset = static_cast< size_t >(input[0]) | static_cast< size_t >(input[1]) << 8;
+        size_t match  = (token & 15u) + LOG_LZ_MIN_MATCH;
+        input += 2;
+        if ((token & 15) == 15 && !ReadLzLength(input, input_end, &match)) {
+            return false;
+        }
+        if (offset == 0 || offset > static_cast< size_t >(cursor - start) ||
+            match > static_cast< size_t >(output_end - cursor)) {
+            return false;
+        }
+        // 匹配可以和输出重叠, 重叠时逐字节复制
+        const uint8_t *from = cursor - offset;
+        if (offset >= match) {
+            memcpy(cursor, from, match);
+        } else {
+            for (size_t i = 0; i < match; i++) {
+                cursor[i] = from[i];
+            }
+        }
+        cursor += match;
+    }
+    return cursor == output_end;
+}
+
+// 压缩块, 封装后交给压缩线程, 按照封装顺序写入
+struct LogCompressBlock {
+    LogCompressFrameHeader header;    // 帧头部, 压缩完成时填写
+    std::string            raw;       // 原始日志内容
+    std::string            data;      // 压缩后的帧数据, 直接保存时为空
+    uint32_t               done;      // 帧是否可以写入
+    uint32_t               __pad;     // 保留字段
+};
+
+// 压缩写入状态. 块队列和压缩线程由mutex保护, 正在填充的块由日志锁保护.
+// 在堆上分配并且不会释放, 进程退出时压缩线程可能还在等待.
+struct LogCompress {
+    std::mutex                        mutex;
+    std::condition_variable           work_cond;      // 有新的块需要压缩
+    std::condition_variable           done_cond;      // 有块写入完成
+    std::deque< LogCompressBlock * >  blocks;         // 封装之后还没有写入的块, 按照封装顺序
+    std::vector< LogCompressBlock * > free_blocks;    // 写入完成可以复用的块
+    std::vector< std::thread * >      workers;        // 压缩线程
+    size_t                            next;           // blocks中下一个需要压缩的块
+    LogCompressBlock                 *current;        // 正在填充的块, 由日志锁保护
+    int                               fd;             // 日志文件描述符
+    uint32_t                          size;           // 块大小
+    uint32_t                          threads;        // 压缩线程数量
+    uint32_t                          limit;          // 排队块数量上限
+    uint32_t                          writing;        // 是否有线程正在写入
+    uint32_t                          stop;           // 压缩线程是否需要退出
+    uint32_t                          exiting;        // 进程正在退出, 日志锁保护, 块立即写入
+    uint32_t                          emergency;      // 崩溃时已经直接写入, 不再写入文件
+};
+
+static LogCompress *g_log_compress = nullptr;
+
+// 获取当前时间, 单位us, 异步信号安全
+static uint64_t LogCompressNowUs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast< uint64_t >(ts.tv_sec) * 1000000 +
+        static_cast< uint64_t >(ts.tv_nsec) / 1000;
+}
+
+// 写入一个帧, 部分写入时补齐剩余部分, 异步信号安全
+static void WriteLogCompressFrame(int fd, const LogCompressFrameHeader &header, const char *data)
+{
+    struct iovec iov[2];
+    size_t       total   = sizeof(header) + header.length;
+    size_t       written = 0;
+    long         rv;
+
+    iov[0].iov_base = const_cast< LogCompressFrameHeader * >(&header);
+    iov[0].iov_len  = sizeof(header);
+    iov[1].iov_base = const_cast< char * >(data);
+    iov[1].iov_len  = header.length;
+    HANDLE_EINTR(rv, writev(fd, iov, 2));
+    if (rv < 0) {
+        return;
+    }
+    written = static_cast< size_t >(rv);
+    while (written < total) {
+        if (written < sizeof(header)) {
+            const char *bytes = reinterpret_cast< const char * >(&header);
+            HANDLE_EINTR(rv, write(fd, bytes + written, sizeof(header) - written));
+        } else {
+            size_t offset = written - sizeof(header);
+            HANDLE_EINTR(rv, write(fd, data + offset, header.length - offset));
+        }
+        // Give up, nothing we can do now.
+        if (rv <= 0) {
+            return;
+        }
+        written += static_cast< size_t >(rv);
+    }
+}
+
+// 填写帧头部, codec为LOG_COMPRESS_STORED时帧数据就是原始日志内容
+static void FillLogCompressFrame(LogCompressFrameHeader &header, uint64_t first_us,
+    size_t raw_length, uint32_t codec, size_t length)
+{
+    memcpy(header.magic, LOG_COMPRESS_MAGIC, sizeof(header.magic));
+    header.first_us   = first_us;
+    header.raw_length = static_cast< uint32_t >(raw_length);
+    header.length     = static_cast< uint32_t >(length);
+    header.codec      = codec;
+    header.check      = LogCompressFrameCheck(header);
+}
+
+// 写入队列头部已经完成的块, 同一时间只有一个线程写入, 保证帧的顺序.
+// 调用者需要持有队列锁, 写入时释放.
+static void WriteLogCompressBlocks(std::unique_lock< std::mutex > &lock)
+{
+    LogCompress &state = *g_log_compress;
+
+    if (state.writing) {
+        return;
+    }
+    state.writing = 1;
+    while (!state.blocks.empty() && state.blocks.front()->done) {
+        LogCompressBlock *block = state.blocks.front();
+        state.blocks.pop_front();
+        if (state.next > 0) {
+            state.next--;
+        }
+        bool emergency = state.emergency != 0;
+        lock.unlock();
+
+        const LogCompressFrameHeader &header = block->header;
+        if (!emergency) {
+            bool        stored  = header.codec == LOG_COMPRESS_STORED;
+            const char *payload = stored ? block->raw.data() : block->data.data();
+            WriteLogCompressFrame(state.fd, header, payload);
+            g_log_compress_frames.fetch_add(1, std::memory_order_relaxed);
+            g_log_compress_stored.fetch_add(stored ? 1u : 0u, std::memory_order_relaxed);
+            g_log_compress_raw_bytes.fetch_add(header.raw_length, std::memory_order_relaxed);
+            g_log_compress_file_bytes.fetch_add(sizeof(header) + header.length,
+                std::memory_order_relaxed);
+        }
+        block->raw.clear();
+        block->data.clear();
+
+        lock.lock();
+        state.free_blocks.push_back(block);
+    }
+    state.writing = 0;
+    state.done_cond.notify_all();
+}
+
+// 压缩一个块, 压缩后没有变小时直接保存
+static void CompressLogBlock(LogCompressBlock *block)
+{
+    const std::string &raw = block->raw;
+
+    block->data.resize(raw.size());
+    size_t length = LogLzCompress(raw.data(), raw.size(), &block->data[0], block->data.size());
+    if (length != 0) {
+        block->data.resize(length);
+        FillLogCompressFrame(block->header, block->header.first_us, raw.size(), LOG_COMPRESS_LZ,
+            length);
+    } else {
+        block->data.clear();
+        FillLogCompressFrame(block->header, block->header.first_us, raw.size(),
+            LOG_COMPRESS_STORED, raw.size());
+    }
+}
+
+static bool SealLogCompressBlockLocked(bool wait);
+
+// 空闲的压缩线程封装等待太久的块, 只在能够拿到日志锁时封装, 不等待队列空间
+static void SealIdleLogCompressBlock()
+{
+    std::unique_lock< std::mutex > lock = TryLockLogOutput();
+    LogCompressBlock              *block;
+
+    if (!lock.owns_lock() || !IsLogFileCompressed()) {
+        return;
+    }
+    block = g_log_compress->current;
+    if (block != nullptr && !block->raw.empty() &&
+        LogCompressNowUs() - block->header.first_us >= LOG_COMPRESS_FLUSH_MS * 1000) {
+        SealLogCompressBlockLocked(false);
+    }
+}
+
+// 压缩线程, 按照封装顺序领取块并压缩, 完成后写入队列头部已经完成的块
+static void LogCompressWorkerMain()
+{
+    LogCompress                   &state = *g_log_compress;
+    std::unique_lock< std::mutex > lock(state.mutex);
+
+    while (!state.stop) {
+        if (state.next < state.blocks.size()) {
+            LogCompressBlock *block = state.blocks[state.next++];
+            if (block->done) {
+                continue;
+            }
+            lock.unlock();
+            CompressLogBlock(block);
+            lock.lock();
+            block->done = 1;
+            WriteLogCompressBlocks(lock);
+            continue;
+        }
+
+        std::cv_status status =
+            state.work_cond.wait_for(lock, std::chrono::milliseconds(LOG_COMPRESS_FLUSH_MS));
+        if (status == std::cv_status::timeout && !state.stop) {
+            // 日志锁在队列锁之前获取
+            lock.unlock();
+            SealIdleLogCompressBlock();
+            lock.lock();
+        }
+    }
+}
+
+// 启动压缩线程, 调用者需要持有队列锁
+static void StartLogCompressWorkers()
+{
+    LogCompress &state = *g_log_compress;
+
+    for (uint32_t i = 0; i < state.threads; i++) {
+        state.workers.push_back(new std::thread(LogCompressWorkerMain));
+    }
+}
+
+// 停止压缩线程, 调用者需要持有日志锁, 压缩线程不会等待日志锁
+static void StopLogCompressWorkers()
+{
+    LogCompress                 &state = *g_log_compress;
+    std::vector< std::thread * > workers;
+
+    {
+        std::lock_guard< std::mutex > lock(state.mutex);
+        state.stop = 1;
+        workers.swap(state.workers);
+    }
+    state.work_cond.notify_all();
+    for (std::thread *worker : workers) {
+        worker->join();
+        delete worker;
+    }
+}
+
+// 封装当前块, 交给压缩线程. 压缩线程落后时说明CPU不足, 块直接保存, 不再排队等待压缩.
+// 队列满时wait为true则等待写入完成, 否则放弃封装并返回false. 调用者需要持有日志锁.
+static bool SealLogCompressBlockLocked(bool wait)
+{
+    LogCompress      &state = *g_log_compress;
+    LogCompressBlock *block = state.current;
+
+    if (block == nullptr || block->raw.empty()) {
+        return true;
+    }
+
+    std::unique_lock< std::mutex > lock(state.mutex);
+    // fork之后的子进程中没有压缩线程, 按需重新启动
+    if (state.workers.empty() && !state.stop) {
+        StartLogCompressWorkers();
+    }
+    while (state.blocks.size() >= state.limit && !state.workers.empty()) {
+        if (!wait) {
+            return false;
+        }
+        state.done_cond.wait_for(lock, std::chrono::milliseconds(100));
+    }
+
+    state.current = nullptr;
+    block->done   = 0;
+    if (state.workers.empty() || state.blocks.size() - state.next >= state.threads) {
+        FillLogCompressFrame(block->header, block->header.first_us, block->raw.size(),
+            LOG_COMPRESS_STORED, block->raw.size());
+        block->done = 1;
+    }
+    state.blocks.push_back(block);
+    if (block->done) {
+        WriteLogCompressBlocks(lock);
+    } else {
+        state.work_cond.notify_one();
+    }
+    return true;
+}
+
+// export: 写入一段日志到当前块, 块写满时封装, 调用者需要持有日志锁
+void LogCompressWriteLocked(const char *data, size_t length)
+{
+    LogCompress      &state = *g_log_compress;
+    LogCompressBlock *block = state.current;
+
+    if (block != nullptr && !block->raw.empty() && block->raw.size() + length > state.size) {
+        SealLogCompressBlockLocked(true);
+        block = nullptr;
+    }
+    if (block == nullptr) {
+        {
+            std::lock_guard< std::mutex > lock(state.mutex);
+            if (!state.free_blocks.empty()) {
+                block = state.free_blocks.back();
+                state.free_blocks.pop_back();
+            }
+        }
+        if (block == nullptr) {
+            block = new LogCompressBlock();
+            block->raw.reserve(state.size);
+        }
+        block->header.first_us = LogCompressNowUs();
+        state.current          = block;
+    }
+
+    block->raw.append(data, length);
+    if (block->raw.size() >= state.size || state.exiting) {
+        SealLogCompressBlockLocked(true);
+    }
+}
+
+// export: 封装当前块并等待所有块写入完成, 没有压缩写入时直接返回, 调用者需要持有日志锁
+void WaitLogCompressLocked()
+{
+    if (!IsLogFileCompressed()) {
+        return;
+    }
+
+    LogCompress &state = *g_log_compress;
+    SealLogCompressBlockLocked(true);
+
+    std::unique_lock< std::mutex > lock(state.mutex);
+    while ((!state.blocks.empty() || state.writing) && !state.workers.empty()) {
+        state.done_cond.wait_for(lock, std::chrono::milliseconds(100));
+    }
+}
+
+// 进程退出时写入所有块并停止压缩线程, 之后的日志立即写入, 不再压缩
+static void StopLogCompressAtExit()
+{
+    std::unique_lock< std::mutex > lock = LockLogOutput();
+
+    if (IsLogFileCompressed()) {
+        WaitLogCompressLocked();
+        StopLogCompressWorkers();
+        g_log_compress->exiting = 1;
+    }
+}
+
+// export: 为新打开的日志文件开始压缩写入, 没有开启时返回false, 调用者需要持有日志锁
+bool OpenLogCompress(int log_fd)
+{
+    if (g_log_compress_block_size == 0) {
+        return false;
+    }
+    if (g_log_compress == nullptr) {
+        g_log_compress = new LogCompress();
+        atexit(StopLogCompressAtExit);
+    }
+
+    LogCompress &state = *g_log_compress;
+    state.next         = 0;
+    state.current      = nullptr;
+    state.fd           = log_fd;
+    state.size         = g_log_compress_block_size;
+    state.threads      = g_log_compress_workers;
+    state.limit        = g_log_compress_workers * LOG_COMPRESS_BLOCKS_PER_WORKER;
+    state.writing      = 0;
+    state.stop         = 0;
+    state.exiting      = 0;
+    state.emergency    = 0;
+    {
+        std::lock_guard< std::mutex > lock(state.mutex);
+        StartLogCompressWorkers();
+    }
+    g_log_compress_active.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// export: 写入所有块并停止压缩线程, 调用者需要持有日志锁
+void CloseLogCompress()
+{
+    if (!IsLogFileCompressed()) {
+        return;
+    }
+
+    LogCompress &state = *g_log_compress;
+    WaitLogCompressLocked();
+    StopLogCompressWorkers();
+    g_log_compress_active.store(false, std::memory_order_relaxed);
+    for (LogCompressBlock *block : state.free_blocks) {
+        delete block;
+    }
+    state.free_blocks.clear();
+}
+
+// export: 崩溃时直接写入日志, 异步信号安全, 调用者需要持有日志锁.
+// data为空时先按顺序写入还没有写入的块和当前块, 之后压缩线程不再写入.
+void LogCompressEmergencyWriteLocked(const char *data, size_t length)
+{
+    LogCompress           &state = *g_log_compress;
+    LogCompressFrameHeader header;
+
+    if (data != nullptr) {
+        FillLogCompressFrame(header, LogCompressNowUs(), length, LOG_COMPRESS_STORED, length);
+        WriteLogCompressFrame(state.fd, header, data);
+        return;
+    }
+
+    if (state.mutex.try_lock()) {
+        state.emergency = 1;
+        for (LogCompressBlock *block : state.blocks) {
+            FillLogCompressFrame(header, block->header.first_us, block->raw.size(),
+                LOG_COMPRESS_STORED, block->raw.size());
+            WriteLogCompressFrame(state.fd, header, block->raw.data());
+        }
+        state.mutex.unlock();
+    }
+    LogCompressBlock *block = state.current;
+    if (block != nullptr && !block->raw.empty()) {
+        FillLogCompressFrame(header, block->header.first_us, block->raw.size(),
+            LOG_COMPRESS_STORED, block->raw.size());
+        WriteLogCompressFrame(state.fd, header, block->raw.data());
+        block->raw.clear();
+    }
+}
+
+// export: fork之后在子进程中调用, 压缩线程不会被复制到子进程. 已经封装和正在填充的块
+// 由父进程写入, 子进程放弃, 下次封装时重新启动压缩线程.
+void ResetLogCompressAfterFork()
+{
+    if (g_log_compress == nullptr) {
+        return;
+    }
+
+    LogCompress &state = *g_log_compress;
+    new (&state.mutex) std::mutex();
+    new (&state.work_cond) std::condition_variable();
+    new (&state.done_cond) std::condition_variable();
+    new (&state.blocks) std::deque< LogCompressBlock * >();
+    new (&state.free_blocks) std::vector< LogCompressBlock * >();
+    new (&state.workers) std::vector< std::thread * >();
+    state.next    = 0;
+    state.writing = 0;
+    if (state.current != nullptr) {
+        state.current->raw.clear();
+    }
+}
+
+// 判断pos位置是否是有效的帧头部
+static bool IsLogCompressFrame(const uint8_t *data, uint64_t size, uint64_t pos,
+    LogCompressFrameHeader *header)
+{
+    if (size < sizeof(LogCompressFrameHeader) || pos > size - sizeof(LogCompressFrameHeader) ||
+        memcmp(data + pos, LOG_COMPRESS_MAGIC, sizeof(header->magic)) != 0) {
+        return false;
+    }
+    memcpy(header, data + pos, sizeof(LogCompressFrameHeader));
+    return header->check == LogCompressFrameCheck(*header) &&
+        header->codec <= LOG_COMPRESS_LZ && header->raw_length <= LOG_COMPRESS_MAX_RAW;
+}
+
+// export: 从pos开始查找下一个有效的帧头部, 没有时返回文件大小
+uint64_t FindLogCompressFrame(const uint8_t *data, uint64_t size, uint64_t pos)
+{
+    LogCompressFrameHeader header;
+
+    while (pos < size) {
+        const void *found = memchr(data + pos, LOG_COMPRESS_MAGIC[0], size - pos);
+        if (found == nullptr) {
+            break;
+        }
+        pos = static_cast< uint64_t >(static_cast< const uint8_t * >(found) - data);
+        if (IsLogCompressFrame(data, size, pos, &header)) {
+            return pos;
+        }
+        pos++;
+    }
+    return size;
+}
+
+// export: 查找文件中所有完整的帧, 只读取帧头部, 不解压.
+// 第一个帧之前, 帧之间和截断的内容计入损坏字节数.
+void ScanLogCompressFrames(const uint8_t *data, uint64_t size,
+    std::vector< LogCompressFrame > *frames, uint64_t *corrupt_bytes)
+{
+    uint64_t pos = FindLogCompressFrame(data, size, 0);
+
+    *corrupt_bytes += pos;
+    while (pos < size) {
+        LogCompressFrame frame;
+        IsLogCompressFrame(data, size, pos, &frame.header);
+        uint64_t end = pos + sizeof(LogCompressFrameHeader) + frame.header.length;
+        if (end > size) {
+            // 最后一个帧没有写完整
+            *corrupt_bytes += size - pos;
+            break;
+        }
+        frame.pos = pos;
+        frames->push_back(frame);
+        pos = FindLogCompressFrame(data, size, end);
+        *corrupt_bytes += pos - end;
+    }
+}
+
+// 解压的帧, 解压结果写入输出缓冲区的output位置
+struct LogInflateFrame {
+    const LogCompressFrame *frame;
+    uint64_t                output;    // 在输出缓冲区中的位置
+    uint32_t                ok;        // 是否解压成功
+    uint32_t                __pad;     // 保留字段
+};
+
+// 解压任务的共享状态, 解压线程按顺序领取帧
+struct LogInflateJob {
+    const uint8_t                 *data;
+    std::vector< LogInflateFrame > frames;
+    std::string                   *output;
+    std::atomic< size_t >          next;
+};
+
+// 解压线程, 每个帧写入输出缓冲区中各自的位置, 不需要加锁
+static void InflateLogWorker(LogInflateJob &job)
+{
+    size_t index;
+
+    while ((index = job.next.fetch_add(1, std::memory_order_relaxed)) < job.frames.size()) {
+        LogInflateFrame              &frame   = job.frames[index];
+        const LogCompressFrameHeader &header  = frame.frame->header;
+        const char                   *payload = reinterpret_cast< const char * >(job.data) +
+            frame.frame->pos + sizeof(LogCompressFrameHeader);
+        char                         *output  = &(*job.output)[0] + frame.output;
+
+        if (header.codec == LOG_COMPRESS_STORED) {
+            frame.ok = header.length == header.raw_length;
+            if (frame.ok) {
+                memcpy(output, payload, header.raw_length);
+            }
+        } else {
+            frame.ok = LogLzDecompress(payload, header.length, output, header.raw_length);
+        }
+    }
+}
+
+// export: 并行解压连续的count个帧, 按照文件顺序追加到output末尾.
+// 解压失败的帧计入损坏字节数, 不输出内容.
+void InflateLogFrames(const uint8_t *data, const LogCompressFrame *frames, size_t count,
+    uint32_t threads, std::string *output, uint64_t *corrupt_bytes)
+{
+    LogInflateJob job;
+    uint64_t      base  = output->size();
+    uint64_t      total = base;
+
+    if (count == 0) {
+        return;
+    }
+    job.frames.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        job.frames[i].frame  = &frames[i];
+        job.frames[i].output = total;
+        job.frames[i].ok     = 0;
+        job.frames[i].__pad  = 0;
+        total += frames[i].header.raw_length;
+    }
+    job.data   = data;
+    job.output = output;
+    job.next.store(0, std::memory_order_relaxed);
+    output->resize(total);
+
+    std::vector< std::thread > workers;
+    threads = std::min(std::max(threads, 1u), static_cast< uint32_t >(count));
+    for (uint32_t i = 1; i < threads; i++) {
+        workers.emplace_back(InflateLogWorker, std::ref(job));
+    }
+    InflateLogWorker(job);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // 去掉解压失败的帧, 其他帧的内容向前移动
+    uint64_t length = base;
+    for (const LogInflateFrame &frame : job.frames) {
+        const LogCompressFrameHeader &header = frame.frame->header;
+        if (!frame.ok) {
+            *corrupt_bytes += sizeof(LogCompressFrameHeader) + header.length;
+            continue;
+        }
+        if (length != frame.output) {
+            memmove(&(*output)[length], &(*output)[frame.output], header.raw_length);
+        }
+        length += header.raw_length;
+    }
+    output->resize(length);
+}
+
+}    // namespace logging
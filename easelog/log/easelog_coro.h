@@ -0,0 +1,168 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_coro.h
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-19 01:10
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  C++20协程中输出日志, 刷新日志和队列满时挂起协程, 由后台线程唤醒, 不阻塞线程.
+ *  日志库本身仍然使用C++11编译, 只有包含本文件的代码需要C++20.
+ *
+ */
+
+#ifndef EASELOG_CORO_H_
+#define EASELOG_CORO_H_
+
+#include "log/easelog.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <atomic>
+#include <coroutine>
+
+namespace logging {
+
+// Resumes a coroutine woken by the log backend. By default it is resumed
+// inline on the backend thread, executors should install a function posting
+// the handle to their own threads instead.
+using LogCoroutineResume = void (*)(std::coroutine_handle<> handle);
+
+inline std::atomic< LogCoroutineResume > g_log_coroutine_resume{nullptr};
+
+inline void SetLogCoroutineResume(LogCoroutineResume resume)
+{
+    g_log_coroutine_resume.store(resume, std::memory_order_release);
+}
+
+inline void ResumeLogCoroutine(std::coroutine_handle<> handle)
+{
+    LogCoroutineResume resume = g_log_coroutine_resume.load(std::memory_order_acquire);
+    if (resume != nullptr) {
+        resume(handle);
+    } else {
+        handle.resume();
+    }
+}
+
+// Awaitable returned by Flush(), lives in the awaiting coroutine's frame.
+class LogFlushAwaiter : private LogWaiter {
+public:
+    LogFlushAwaiter() : LogWaiter{&LogFlushAwaiter::Wake, nullptr, 0} { }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        return !FlushLogAsync(this);
+    }
+
+    void await_resume() const noexcept { }
+
+private:
+    static void Wake(LogWaiter *waiter)
+    {
+        ResumeLogCoroutine(static_cast< LogFlushAwaiter * >(waiter)->handle_);
+    }
+
+    std::coroutine_handle<> handle_;
+};
+
+// co_await logging::Flush() suspends until every record queued before it has
+// been written, like FlushLog() without blocking the thread.
+inline LogFlushAwaiter Flush()
+{
+    return LogFlushAwaiter();
+}
+
+// Awaitable used by CO_LOG(), suspends while the log queue is full.
+class LogQueueSpaceAwaiter : private LogWaiter {
+public:
+    explicit LogQueueSpaceAwaiter(bool enabled)
+        : LogWaiter{&LogQueueSpaceAwaiter::Wake, nullptr, 0}, enabled_(enabled)
+    {
+    }
+
+    bool await_ready() const noexcept { return !enabled_ || HasLogQueueSpace(); }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        return !WaitLogQueueSpaceAsync(this);
+    }
+
+    void await_resume() const noexcept { }
+
+private:
+    static void Wake(LogWaiter *waiter)
+    {
+        ResumeLogCoroutine(static_cast< LogQueueSpaceAwaiter * >(waiter)->handle_);
+    }
+
+    std::coroutine_handle<> handle_;
+    bool                    enabled_;
+    bool                    __pad_[7];
+};
+
+// Awaitable used by CO_LOG() for a record kept while the log queue was full,
+// suspends until the backend thread has drained the queue and queues it.
+class LogPendingAwaiter : private LogWaiter {
+public:
+    explicit LogPendingAwaiter(LogPendingRecord &pending)
+        : LogWaiter{&LogPendingAwaiter::Wake, nullptr, 0}, pending_(pending)
+    {
+    }
+
+    bool await_ready() { return SubmitLogPendingRecord(&pending_, false); }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        if (WaitLogQueueSpaceAsync(this)) {
+            SubmitLogPendingRecord(&pending_, true);
+            return false;
+        }
+        return true;
+    }
+
+    void await_resume() const noexcept { }
+
+private:
+    static void Wake(LogWaiter *waiter)
+    {
+        ResumeLogCoroutine(static_cast< LogPendingAwaiter * >(waiter)->handle_);
+    }
+
+    std::coroutine_handle<> handle_;
+    LogPendingRecord       &pending_;
+};
+
+}    // namespace logging
+
+// LOG(severity) for coroutines. When the log queue is full the coroutine is
+// suspended until the backend thread has drained it, instead of writing the
+// record on the calling thread. The streamed expressions must not co_await.
+//
+// Other producers can fill the queue again between the check and the
+// enqueue. The record is then written directly if the log mutex is free,
+// otherwise it is kept in the coroutine's frame and the coroutine suspends
+// again until it could be queued. Only a record exceeding the queue's memory
+// limit makes the calling thread wait for the log mutex.
+#define CO_LOG_STREAM(severity, pending)                                                \
+    ::logging::LogMessage(*LOG_CALLSITE(), ::logging::LOGGING_##severity, pending)      \
+        .stream()
+#define CO_LOG(severity)                                                                \
+    if (co_await ::logging::LogQueueSpaceAwaiter(LOG_IS_ON(severity)); false) {         \
+    } else                                                                              \
+        for (::logging::LogPendingRecord co_log_pending; co_log_pending.Pending();      \
+             co_await ::logging::LogPendingAwaiter(co_log_pending))                     \
+            LAZY_STREAM(CO_LOG_STREAM(severity, co_log_pending),                        \
+                co_log_pending.Start() && LOG_IS_ON(severity))
+
+#endif    // __cpp_impl_coroutine
+
+#endif    // EASELOG_CORO_H_
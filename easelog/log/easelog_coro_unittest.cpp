@@ -0,0 +1,275 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_coro_unittest.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-19 01:30
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  协程日志接口的单元测试, 使用C++20编译. 测试刷新等待, 队列满时挂起协程,
+ *  以及同步模式下其他线程持有日志锁时协程不被阻塞.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_coro.h"
+#include "log/easelog_private.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace logging;
+
+#define CORO_QUEUE_RECORDS 3000u
+#define CORO_WAIT_MS       10000
+
+// 创建之后立即运行, 结束时自动释放的协程
+struct CoroTask {
+    struct promise_type {
+        CoroTask            get_return_object() { return CoroTask(); }
+        std::suspend_never  initial_suspend() noexcept { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void                return_void() { }
+        void                unhandled_exception() { std::terminate(); }
+    };
+};
+
+// 在测试线程中恢复被后台线程唤醒的协程
+static std::mutex                            g_coro_mutex;
+static std::deque< std::coroutine_handle<> > g_coro_ready;
+
+static void PostCoroutine(std::coroutine_handle<> handle)
+{
+    std::lock_guard< std::mutex > lock(g_coro_mutex);
+    g_coro_ready.push_back(handle);
+}
+
+// 恢复就绪的协程, 直到|done|被设置或者超时
+static bool RunCoroutines(const std::atomic< bool > &done)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CORO_WAIT_MS);
+
+    while (!done.load() && std::chrono::steady_clock::now() < deadline) {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard< std::mutex > lock(g_coro_mutex);
+            if (!g_coro_ready.empty()) {
+                handle = g_coro_ready.front();
+                g_coro_ready.pop_front();
+            }
+        }
+        if (handle) {
+            handle.resume();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return done.load();
+}
+
+// 在另一个线程中持有日志锁, 阻止日志输出
+class LogOutputBlocker {
+public:
+    LogOutputBlocker()
+        : thread_([this]() {
+              std::unique_lock< std::mutex > lock = LockLogOutput();
+              held_.store(true);
+              while (!release_.load()) {
+                  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+              }
+          })
+    {
+        while (!held_.load()) {
+            std::this_thread::yield();
+        }
+    }
+
+    ~LogOutputBlocker() { Release(); }
+
+    void Release()
+    {
+        release_.store(true);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    std::atomic< bool > held_{false};
+    std::atomic< bool > release_{false};
+    bool                __pad_[6];
+    std::thread         thread_;
+};
+
+static std::string ReadLogFile(const FilePath &path)
+{
+    FILE       *file = fopen(path.c_str(), "r");
+    std::string content;
+    char        buffer[4096];
+    size_t      length;
+
+    if (file == nullptr) {
+        return content;
+    }
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, length);
+    }
+    fclose(file);
+    return content;
+}
+
+static size_t CountSubstring(const std::string &text, const std::string &pattern)
+{
+    size_t count = 0;
+
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + pattern.size())) {
+        count++;
+    }
+    return count;
+}
+
+static CoroTask LogAndFlush(uint32_t records, std::atomic< uint32_t > &logged,
+    std::atomic< bool > &done)
+{
+    for (uint32_t i = 0; i < records; i++) {
+        CO_LOG(INFO) << "coro record " << i << " " << std::string(32, 'c');
+        logged.store(i + 1);
+    }
+    co_await Flush();
+    done.store(true);
+}
+
+class CoroLoggingTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        saved_             = GetLoggingSettings();
+        settings_          = saved_;
+        path_              = "easelog_coro_unittest.log";
+        settings_.log_dest = LOG_TO_FILE;
+        settings_.log_file_path = &path_;
+        settings_.log_min_level = LOGGING_INFO;
+        unlink(path_.c_str());
+        ASSERT_TRUE(InitLogging(settings_));
+        SetLogCoroutineResume(PostCoroutine);
+    }
+
+    void TearDown() override
+    {
+        SetLogCoroutineResume(nullptr);
+        SetLogMode(saved_.log_mode, saved_.log_async_rate);
+        ASSERT_TRUE(InitLogging(saved_));
+        unlink(path_.c_str());
+    }
+
+    LoggingSettings saved_;
+    LoggingSettings settings_;
+    FilePath        path_;
+};
+
+// 同步模式下co_await Flush()由后台线程完成, 其他线程持有日志锁时协程不阻塞
+TEST_F(CoroLoggingTest, FlushWithoutBlocking)
+{
+    std::atomic< uint32_t > logged{0};
+    std::atomic< bool >     done{false};
+    LogOutputBlocker        blocker;
+
+    LogAndFlush(100, logged, done);
+    EXPECT_EQ(logged.load(), 100u);
+    EXPECT_FALSE(done.load());
+    EXPECT_FALSE(IsLogBackendActive());
+
+    blocker.Release();
+    ASSERT_TRUE(RunCoroutines(done));
+    std::string content = ReadLogFile(path_);
+    EXPECT_EQ(CountSubstring(content, "coro record"), 100u);
+    EXPECT_NE(content.find("coro record 99 "), std::string::npos);
+
+    /* 普通线程仍然同步输出 */
+    LOG(INFO) << "plain record after coroutine";
+    EXPECT_EQ(CountSubstring(ReadLogFile(path_), "plain record after coroutine"), 1u);
+}
+
+// 队列满时协程挂起, 后台线程清空队列之后恢复, 日志不丢失也不乱序
+TEST_F(CoroLoggingTest, SuspendOnFullQueue)
+{
+    std::atomic< uint32_t > logged{0};
+    std::atomic< bool >     done{false};
+
+    SetLogMode(LOG_MODE_ASYNC, 0);
+    LogOutputBlocker blocker;
+    LogAndFlush(CORO_QUEUE_RECORDS, logged, done);
+    uint32_t suspended_at = logged.load();
+    EXPECT_GT(suspended_at, 0u);
+    EXPECT_LT(suspended_at, CORO_QUEUE_RECORDS);
+    EXPECT_FALSE(HasLogQueueSpace());
+
+    blocker.Release();
+    ASSERT_TRUE(RunCoroutines(done));
+    EXPECT_EQ(logged.load(), CORO_QUEUE_RECORDS);
+
+    std::string content = ReadLogFile(path_);
+    EXPECT_EQ(CountSubstring(content, "coro record"), CORO_QUEUE_RECORDS);
+    size_t last = 0;
+    for (uint32_t i = 0; i < CORO_QUEUE_RECORDS; i += 100) {
+        size_t pos = content.find("coro record " + std::to_string(i) + " ");
+        ASSERT_NE(pos, std::string::npos);
+        EXPECT_GE(pos, last);
+        last = pos;
+    }
+}
+
+// 普通线程写满队列, 直到队列没有空间, 用于在CO_LOG()检查队列空间之后写满队列
+static uint32_t FillLogQueue()
+{
+    uint32_t records = 0;
+
+    while (HasLogQueueSpace()) {
+        LOG(INFO) << "filler record " << records++;
+    }
+    return records;
+}
+
+static CoroTask LogWhileQueueFills(uint32_t &fillers, std::atomic< bool > &done)
+{
+    CO_LOG(INFO) << "filled " << (fillers = FillLogQueue()) << ", pending record";
+    done.store(true);
+    co_return;
+}
+
+// 检查队列空间之后队列被写满并且日志锁被占用时, 日志保存在协程中, 协程挂起而不是阻塞线程
+TEST_F(CoroLoggingTest, KeepRecordWhileQueueFull)
+{
+    uint32_t            fillers = 0;
+    std::atomic< bool > done{false};
+
+    SetLogMode(LOG_MODE_ASYNC, 0);
+    LogOutputBlocker blocker;
+    LogWhileQueueFills(fillers, done);
+    EXPECT_GT(fillers, 0u);
+    EXPECT_FALSE(done.load());
+    EXPECT_FALSE(HasLogQueueSpace());
+
+    blocker.Release();
+    ASSERT_TRUE(RunCoroutines(done));
+    FlushLog();
+
+    std::string content = ReadLogFile(path_);
+    EXPECT_EQ(CountSubstring(content, "filler record"), fillers);
+    EXPECT_EQ(CountSubstring(content, "pending record"), 1u);
+    EXPECT_GT(content.find("pending record"),
+        content.find("filler record " + std::to_string(fillers - 1)));
+}
@@ -0,0 +1,676 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_decode.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 19:40
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  二进制日志文件的解码, 文件按块边界切分, 多个线程并行解码, 按文件顺序输出.
+ *  压缩的日志文件先并行解压所有帧, 再解码拼接后的内容.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+#define LOG_DECODE_MIN_CHUNK (LOG_BINARY_BLOCK_SIZE)
+#define LOG_DECODE_MAX_CHUNK (4 * 1024 * 1024)
+// 每个解码线程最多领先输出的块数量, 限制缓存的解码结果
+#define LOG_DECODE_WINDOW    4
+// 压缩文件每次解压的内容大小, 按窗口解压解码, 内存占用和文件大小无关
+#define LOG_DECODE_INFLATE_BYTES (16 * 1024 * 1024)
+
+// 指向文件映射内存的字符串
+struct LogDecodeString {
+    const char *data;
+    size_t      length;
+};
+
+struct LogDecodeCallSite {
+    LogDecodeString file;
+    LogDecodeString func;
+    int64_t         line;
+    LogSeverity     severity;
+    uint32_t        keep;    // 是否符合等级过滤条件
+};
+
+struct LogDecodeThread {
+    LogDecodeString name;
+    LogDecodeString program;
+    int64_t         pid;
+    int64_t         tid;
+};
+
+// 一个解码区间的结果, 由解码线程填写, 输出线程按顺序取走
+struct LogDecodeChunk {
+    std::string    output;
+    LogDecodeStats stats;
+    uint32_t       done;     // 是否已经解码完成
+    uint32_t       __pad;    // 保留字段
+};
+
+// 解码任务的共享状态, 区间的分配和完成由mutex保护
+struct LogDecodeJob {
+    const uint8_t                *data;           // 文件映射内存
+    uint64_t                      size;           // 文件大小
+    uint64_t                      chunk_bytes;    // 每个区间的大小
+    const LogDecodeOptions       *options;        // 过滤条件和输出格式
+    LoggingSettings               settings;       // 用于格式化时间戳
+    std::vector< LogDecodeChunk > chunks;         // 每个区间的解码结果
+    std::atomic< uint64_t >       stop;           // 起始时间不早于结束时间的第一个块的位置
+    std::mutex                    mutex;
+    std::condition_variable       cond;
+    uint32_t                      next;           // 下一个待解码的区间
+    uint32_t                      emitted;        // 已经输出的区间数量
+    uint32_t                      window;         // 允许领先输出的区间数量
+    uint32_t                      __pad;          // 保留字段
+};
+
+// 单个解码线程的解码状态, 字典在每个块开始时清空, 时间戳按秒缓存
+struct LogDecodeContext {
+    std::vector< LogDecodeCallSite > callsites;
+    std::vector< LogDecodeThread >   threads;
+    std::string                      time_prefix;    // "YYYY-MM-DDTHH:MM:SS."
+    std::string                      time_suffix;    // 时区和空格
+    int64_t                          time_sec;       // 缓存的秒
+    uint64_t                         time_us;        // 当前记录的时间
+};
+
+// 判断pos位置是否是有效的块头部
+static bool IsLogBinaryBlock(const uint8_t *data, uint64_t size, uint64_t pos,
+    LogBinaryBlockHeader *header)
+{
+    if (size < sizeof(LogBinaryBlockHeader) || pos > size - sizeof(LogBinaryBlockHeader) ||
+        memcmp(data + pos, LOG_BINARY_MAGIC, sizeof(header->magic)) != 0) {
+        return false;
+    }
+    memcpy(header, data + pos, sizeof(LogBinaryBlockHeader));
+    return header->version == LOG_BINARY_VERSION && header->check == LogBinaryBlockCheck(*header);
+}
+
+// export: 从pos开始查找下一个有效的块头部, 没有时返回文件大小
+uint64_t FindLogBinaryBlock(const uint8_t *data, uint64_t size, uint64_t pos)
+{
+    LogBinaryBlockHeader header;
+
+    while (pos < size) {
+        const void *found = memchr(data + pos, LOG_BINARY_MAGIC[0], size - pos);
+        if (found == nullptr) {
+            break;
+        }
+        pos = static_cast< uint64_t >(static_cast< const uint8_t * >(found) - data);
+        if (IsLogBinaryBlock(data, size, pos, &header)) {
+            return pos;
+        }
+        pos++;
+    }
+    return size;
+}
+
+static bool ReadVarint(const uint8_t *&pos, const uint8_t *end, uint64_t *value)
+{
+    uint64_t result = 0;
+
+    for (uint32_t shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        result |= static_cast< uint64_t >(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ReadSigned(const uint8_t *&pos, const uint8_t *end, int64_t *value)
+{
+    uint64_t zigzag;
+
+    if (!ReadVarint(pos, end, &zigzag)) {
+        return false;
+    }
+    *value = static_cast< int64_t >(zigzag >> 1) ^ -static_cast< int64_t >(zigzag & 1);
+    return true;
+}
+
+static bool ReadString(const uint8_t *&pos, const uint8_t *end, LogDecodeString *value)
+{
+    uint64_t length;
+
+    if (!ReadVarint(pos, end, &length) || length > static_cast< uint64_t >(end - pos)) {
+        return false;
+    }
+    value->data   = reinterpret_cast< const char * >(pos);
+    value->length = static_cast< size_t >(length);
+    pos += length;
+    return true;
+}
+
+static void AppendString(std::string &output, const LogDecodeString &value)
+{
+    output.append(value.data, value.length);
+}
+
+static void AppendDecimal(std::string &output, int64_t value)
+{
+    char     digits[24];
+    size_t   count    = 0;
+    uint64_t absolute = value < 0 ? 0 - static_cast< uint64_t >(value)
+                                  : static_cast< uint64_t >(value);
+
+    do {
+        digits[count++] = static_cast< char >('0' + absolute % 10);
+        absolute /= 10;
+    } while (absolute != 0);
+    if (value < 0) {
+        output.push_back('-');
+    }
+    while (count != 0) {
+        output.push_back(digits[--count]);
+    }
+}
+
+// 输出和LogSyslogPrefixTimestamp()相同格式的时间戳, 包括尾部空格.
+// 时区等部分按秒缓存, 同一秒内的记录只格式化微秒.
+static void AppendTimestamp(LogDecodeJob &job, LogDecodeContext &context, std::string &output)
+{
+    int64_t sec  = static_cast< int64_t >(context.time_us / 1000000);
+    int64_t usec = static_cast< int64_t >(context.time_us % 1000000);
+
+    if (sec != context.time_sec) {
+        struct timeval tv = {static_cast< time_t >(sec), 0};
+        std::string    timestamp;
+        LogSyslogPrefixTimestamp(job.settings, tv, timestamp);
+        context.time_prefix.assign(timestamp, 0, 20);
+        context.time_suffix.assign(timestamp, std::min< size_t >(26, timestamp.size()),
+            std::string::npos);
+        context.time_sec = sec;
+    }
+    output += context.time_prefix;
+    for (int64_t scale = 100000; scale != 0; scale /= 10) {
+        output.push_back(static_cast< char >('0' + usec / scale % 10));
+    }
+    output += context.time_suffix;
+}
+
+// 输出JSON字符串, 转义引号, 反斜杠和控制字符
+static void AppendJsonString(std::string &output, const char *data, size_t length)
+{
+    output.push_back('"');
+    AppendLogJsonEscaped(output, data, length);
+    output.push_back('"');
+}
+
+static void AppendSeverityName(LogDecodeJob &job, std::string &output, LogSeverity severity)
+{
+    if (severity >= 0 && severity < LOGGING_NUM_SEVERITIES) {
+        output += job.settings.log_severity_names[severity];
+    } else if (severity < 0) {
+        output += "VERBOSE";
+        AppendDecimal(output, -severity);
+    } else {
+        output += "Unknown";
+    }
+}
+
+// 输出一条日志记录, 文本格式和开启所有前缀信息时的基础格式相同
+static void FormatLogRecord(LogDecodeJob &job, LogDecodeContext &context, std::string &output,
+    const LogDecodeCallSite &callsite, const LogDecodeThread &thread,
+    const LogDecodeString &message)
+{
+    if (job.options->output == LOG_DECODE_JSON) {
+        output += "{\"time\":\"";
+        AppendTimestamp(job, context, output);
+        output.pop_back();
+        output += "\",\"time_us\":";
+        AppendDecimal(output, static_cast< int64_t >(context.time_us));
+        output += ",\"severity\":\"";
+        AppendSeverityName(job, output, callsite.severity);
+        output += "\",\"program\":";
+        AppendJsonString(output, thread.program.data, thread.program.length);
+        output += ",\"pid\":";
+        AppendDecimal(output, thread.pid);
+        output += ",\"thread\":";
+        AppendJsonString(output, thread.name.data, thread.name.length);
+        output += ",\"tid\":";
+        AppendDecimal(output, thread.tid);
+        output += ",\"file\":";
+        AppendJsonString(output, callsite.file.data, callsite.file.length);
+        output += ",\"func\":";
+        AppendJsonString(output, callsite.func.data, callsite.func.length);
+        output += ",\"line\":";
+        AppendDecimal(output, callsite.line);
+        output += ",\"message\":";
+        AppendJsonString(output, message.data, message.length);
+        output += "}\n";
+        return;
+    }
+
+    AppendTimestamp(job, context, output);
+    output.push_back('<');
+    AppendSeverityName(job, output, callsite.severity);
+    output += "> ";
+    AppendString(output, thread.program);
+    output.push_back('[');
+    AppendDecimal(output, thread.pid);
+    output += "]: [";
+    AppendString(output, thread.name);
+    output.push_back('(');
+    AppendDecimal(output, thread.tid);
+    output += ") - ";
+    AppendString(output, callsite.file);
+    output.push_back('(');
+    AppendString(output, callsite.func);
+    output.push_back('-');
+    AppendDecimal(output, callsite.line);
+    output += ")] ";
+    AppendString(output, message);
+    output.push_back('\n');
+}
+
+// 输出一行保存为整行文本的日志
+static void FormatLogText(LogDecodeJob &job, LogDecodeContext &context, std::string &output,
+    bool timestamp, const LogDecodeString &text)
+{
+    if (job.options->output == LOG_DECODE_JSON) {
+        output += "{\"time\":\"";
+        AppendTimestamp(job, context, output);
+        output.pop_back();
+        output += "\",\"time_us\":";
+        AppendDecimal(output, static_cast< int64_t >(context.time_us));
+        output += ",\"text\":";
+        AppendJsonString(output, text.data, text.length);
+        output += "}\n";
+        return;
+    }
+
+    if (timestamp) {
+        AppendTimestamp(job, context, output);
+    }
+    AppendString(output, text);
+    output.push_back('\n');
+}
+
+// 解码一条块内记录, 格式错误时返回false
+static bool DecodeLogFrame(LogDecodeJob &job, LogDecodeContext &context, const uint8_t *&pos,
+    const uint8_t *end, LogDecodeChunk &chunk)
+{
+    const LogDecodeOptions &options = *job.options;
+    uint8_t                 type    = *pos++;
+    uint64_t                id, thread, mask, timestamp;
+    int64_t                 delta;
+    LogDecodeString         text;
+
+    switch (type) {
+    case LOG_BINARY_CALLSITE: {
+        LogDecodeCallSite callsite;
+        int64_t           severity;
+        if (!ReadVarint(pos, end, &id) || id != context.callsites.size() ||
+            !ReadSigned(pos, end, &severity) || !ReadSigned(pos, end, &callsite.line) ||
+            !ReadString(pos, end, &callsite.file) || !ReadString(pos, end, &callsite.func)) {
+            return false;
+        }
+        // 等级用于计算掩码和查找等级名字, 超出范围按照格式错误处理, 负数是详细日志等级
+        if (severity < INT32_MIN || severity >= LOGGING_NUM_SEVERITIES) {
+            return false;
+        }
+        callsite.severity = static_cast< LogSeverity >(severity);
+        callsite.keep     = LogSeverityMask(callsite.severity) & options.severity_mask;
+        context.callsites.push_back(callsite);
+        return true;
+    }
+    case LOG_BINARY_THREAD: {
+        LogDecodeThread info;
+        if (!ReadVarint(pos, end, &id) || id != context.threads.size() ||
+            !ReadSigned(pos, end, &info.pid) || !ReadSigned(pos, end, &info.tid) ||
+            !ReadString(pos, end, &info.name) || !ReadString(pos, end, &info.program)) {
+            return false;
+        }
+        context.threads.push_back(info);
+        return true;
+    }
+    case LOG_BINARY_RECORD:
+        if (!ReadVarint(pos, end, &id) || id >= context.callsites.size() ||
+            !ReadVarint(pos, end, &thread) || thread >= context.threads.size() ||
+            !ReadSigned(pos, end, &delta) || !ReadString(pos, end, &text)) {
+            return false;
+        }
+        context.time_us += static_cast< uint64_t >(delta);
+        if (context.callsites[id].keep && context.time_us >= options.begin_us &&
+            context.time_us < options.end_us) {
+            FormatLogRecord(job, context, chunk.output, context.callsites[id],
+                context.threads[thread], text);
+            chunk.stats.records++;
+        }
+        return true;
+    case LOG_BINARY_TEXT:
+        if (!ReadVarint(pos, end, &mask) || !ReadVarint(pos, end, &timestamp) ||
+            !ReadSigned(pos, end, &delta) || !ReadString(pos, end, &text)) {
+            return false;
+        }
+        context.time_us += static_cast< uint64_t >(delta);
+        if ((mask & options.severity_mask) && context.time_us >= options.begin_us &&
+            context.time_us < options.end_us) {
+            FormatLogText(job, context, chunk.output, timestamp != 0, text);
+            chunk.stats.records++;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 解码pos位置开始的一个块, 返回下一个块的位置. 格式错误时跳过剩余部分, 计入损坏字节数.
+static uint64_t DecodeLogBlock(LogDecodeJob &job, LogDecodeContext &context, uint64_t pos,
+    const LogBinaryBlockHeader &header, LogDecodeChunk &chunk)
+{
+    const uint8_t       *end = job.data + job.size;
+    const uint8_t       *cur = job.data + pos + sizeof(LogBinaryBlockHeader);
+    LogBinaryBlockHeader next;
+
+    context.callsites.clear();
+    context.threads.clear();
+    context.time_us = header.first_us;
+    chunk.stats.blocks++;
+
+    while (cur < end) {
+        uint64_t offset = static_cast< uint64_t >(cur - job.data);
+        if (*cur == static_cast< uint8_t >(LOG_BINARY_MAGIC[0]) &&
+            IsLogBinaryBlock(job.data, job.size, offset, &next)) {
+            return offset;
+        }
+        if (!DecodeLogFrame(job, context, cur, end, chunk)) {
+            uint64_t resume = FindLogBinaryBlock(job.data, job.size, offset + 1);
+            chunk.stats.corrupt_bytes += resume - offset;
+            return resume;
+        }
+    }
+    return job.size;
+}
+
+// 解码一个区间, 只处理起始位置在区间内的块, 最后一个块可以超出区间.
+// 块的起始时间单调递增, 起始时间不早于结束时间的块和之后的块都不需要解码.
+static void DecodeLogChunk(LogDecodeJob &job, LogDecodeContext &context, uint32_t index,
+    LogDecodeChunk &chunk)
+{
+    const LogDecodeOptions &options = *job.options;
+    uint64_t                start   = static_cast< uint64_t >(index) * job.chunk_bytes;
+    uint64_t                limit   = std::min(job.size, start + job.chunk_bytes);
+    uint64_t                pos     = FindLogBinaryBlock(job.data, job.size, start);
+    LogBinaryBlockHeader    header;
+
+    // 第一个块之前的内容不属于任何块
+    if (index == 0) {
+        chunk.stats.corrupt_bytes += pos;
+    }
+    while (pos < limit && pos < job.stop.load(std::memory_order_relaxed)) {
+        IsLogBinaryBlock(job.data, job.size, pos, &header);
+        if (header.first_us >= options.end_us) {
+            uint64_t stop = job.stop.load(std::memory_order_relaxed);
+            while (pos < stop && !job.stop.compare_exchange_weak(stop, pos)) {
+            }
+            break;
+        }
+
+        // 块内的时间不晚于下一个块的起始时间, 下一个块早于开始时间时跳过整个块
+        if (header.first_us < options.begin_us) {
+            LogBinaryBlockHeader next;
+            uint64_t next_pos = FindLogBinaryBlock(job.data, job.size, pos + sizeof(header));
+            if (next_pos < job.size && IsLogBinaryBlock(job.data, job.size, next_pos, &next) &&
+                next.first_us < options.begin_us) {
+                chunk.stats.skipped_blocks++;
+                pos = next_pos;
+                continue;
+            }
+        }
+        pos = DecodeLogBlock(job, context, pos, header, chunk);
+    }
+}
+
+// 解码线程, 按顺序领取区间, 领先输出太多时等待
+static void DecodeLogWorker(LogDecodeJob &job)
+{
+    LogDecodeContext               context = {{}, {}, {}, {}, -1, 0};
+    std::unique_lock< std::mutex > lock(job.mutex);
+
+    for (;;) {
+        while (job.next < job.chunks.size() && job.next >= job.emitted + job.window) {
+            job.cond.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        if (job.next >= job.chunks.size()) {
+            return;
+        }
+        uint32_t index = job.next++;
+        lock.unlock();
+
+        LogDecodeChunk chunk = {{}, {0, 0, 0, 0, 0, 0}, 0, 0};
+        DecodeLogChunk(job, context, index, chunk);
+
+        lock.lock();
+        job.chunks[index]      = std::move(chunk);
+        job.chunks[index].done = 1;
+        job.cond.notify_all();
+    }
+}
+
+// 并行解码一段从块边界开始的二进制日志, 按照顺序调用callback, 统计累加到result.
+// 遇到起始时间不早于结束时间的块时返回true, 之后的内容都不需要解码.
+static bool DecodeLogBinary(const uint8_t *data, uint64_t size, const LogDecodeOptions &options,
+    uint32_t threads, const std::function< void(const char *, size_t) > &callback,
+    LogDecodeStats &result)
+{
+    // 区间大小按照线程数量切分, 每个线程大约分到LOG_DECODE_WINDOW个区间
+    LogDecodeJob job;
+    job.data        = data;
+    job.size        = size;
+    job.chunk_bytes = size / (threads * LOG_DECODE_WINDOW);
+    job.chunk_bytes = std::min< uint64_t >(std::max< uint64_t >(job.chunk_bytes,
+        LOG_DECODE_MIN_CHUNK), LOG_DECODE_MAX_CHUNK);
+    job.options  = &options;
+    job.settings = GetLoggingSettings();
+    job.settings.log_timestamp = true;
+    job.chunks.resize((job.size + job.chunk_bytes - 1) / job.chunk_bytes);
+    job.stop.store(job.size, std::memory_order_relaxed);
+    job.next    = 0;
+    job.emitted = 0;
+    job.window  = threads * LOG_DECODE_WINDOW;
+    job.__pad   = 0;
+
+    std::vector< std::thread > workers;
+    threads = std::min(threads, static_cast< uint32_t >(job.chunks.size()));
+    for (uint32_t i = 0; i < threads; i++) {
+        workers.emplace_back(DecodeLogWorker, std::ref(job));
+    }
+
+    // 按照文件顺序输出, 输出时不持有锁
+    for (uint32_t i = 0; i < job.chunks.size(); i++) {
+        std::string output;
+        {
+            std::unique_lock< std::mutex > lock(job.mutex);
+            while (!job.chunks[i].done) {
+                job.cond.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            const LogDecodeStats &chunk_stats = job.chunks[i].stats;
+            result.records += chunk_stats.records;
+            result.blocks += chunk_stats.blocks;
+            result.skipped_blocks += chunk_stats.skipped_blocks;
+            result.corrupt_bytes += chunk_stats.corrupt_bytes;
+            output.swap(job.chunks[i].output);
+            job.emitted = i + 1;
+            job.cond.notify_all();
+        }
+        if (!output.empty()) {
+            callback(output.data(), output.size());
+        }
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return job.stop.load(std::memory_order_relaxed) < job.size;
+}
+
+// 压缩文件每次解压的内容大小, 测试时可以调小
+static uint64_t g_log_decode_inflate_bytes = LOG_DECODE_INFLATE_BYTES;
+
+#if defined(EASELOG_TEST_HOOKS)
+// export: 设置压缩文件每次解压的内容大小, 用于测试跨窗口的块
+void SetLogDecodeInflateBytes(uint64_t bytes)
+{
+    g_log_decode_inflate_bytes = bytes;
+}
+#endif    // EASELOG_TEST_HOOKS
+
+// 最后一个块头部的位置, 没有块时返回size
+static uint64_t FindLastLogBinaryBlock(const uint8_t *data, uint64_t size)
+{
+    uint64_t last = size;
+
+    for (uint64_t pos = FindLogBinaryBlock(data, size, 0); pos < size;
+         pos          = FindLogBinaryBlock(data, size, pos + sizeof(LogBinaryBlockHeader))) {
+        last = pos;
+    }
+    return last;
+}
+
+// 解码压缩日志文件, 每次解压一个窗口的帧. 二进制日志的块可以跨越帧, 窗口最后一个块
+// 留到下一个窗口解码. 下一个帧的写入时间早于开始时间时, 当前帧的日志都早于开始时间,
+// 不解压直接跳过. 文本日志文件解压后原样输出, 文本行没有保存日志等级和时间, 过滤条件不生效.
+static bool DecodeLogCompressed(const uint8_t *data, uint64_t size,
+    const LogDecodeOptions &options, uint32_t threads,
+    const std::function< void(const char *, size_t) > &callback, LogDecodeStats &result)
+{
+    std::vector< LogCompressFrame > frames;
+    std::string                     window;
+    bool                            binary  = false;
+    bool                            partial = false;    // 窗口从跳过的块中间开始
+
+    ScanLogCompressFrames(data, size, &frames, &result.corrupt_bytes);
+    if (frames.empty()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < frames.size();) {
+        if (binary && i + 1 < frames.size() && frames[i + 1].header.first_us < options.begin_us) {
+            window.clear();
+            partial = true;
+            result.skipped_frames++;
+            i++;
+            continue;
+        }
+
+        size_t   count = 0;
+        uint64_t raw   = 0;
+        while (i + count < frames.size()) {
+            uint64_t length = frames[i + count].header.raw_length;
+            if (count != 0 && raw + length > g_log_decode_inflate_bytes) {
+                break;
+            }
+            raw += length;
+            count++;
+        }
+        bool first = i == 0;
+        InflateLogFrames(data, &frames[i], count, threads, &window, &result.corrupt_bytes);
+        i += count;
+
+        const uint8_t *inflated = reinterpret_cast< const uint8_t * >(window.data());
+        // 压缩帧中直接保存的内容也包含块头部, 按照第一个窗口判断是否是二进制日志
+        if (first) {
+            binary = FindLogBinaryBlock(inflated, window.size(), 0) < window.size();
+        }
+        if (!binary) {
+            if (!window.empty()) {
+                callback(window.data(), window.size());
+            }
+            window.clear();
+            continue;
+        }
+
+        // 跳过的帧之后的内容属于被跳过的块, 从下一个块开始解码
+        if (partial) {
+            uint64_t start = FindLogBinaryBlock(inflated, window.size(), 0);
+            window.erase(0, start);
+            inflated = reinterpret_cast< const uint8_t * >(window.data());
+            partial  = window.empty();
+        }
+        uint64_t keep =
+            i < frames.size() ? FindLastLogBinaryBlock(inflated, window.size()) : window.size();
+        if (keep == 0) {
+            continue;
+        }
+        if (DecodeLogBinary(inflated, keep, options, threads, callback, result)) {
+            break;
+        }
+        window.erase(0, keep);
+    }
+    return true;
+}
+
+// export: 解码二进制日志文件, 并行解码, 按照文件顺序调用callback.
+// 压缩的日志文件按窗口解压, 文本日志文件解压后原样输出.
+bool DecodeLogFile(const char *path, const LogDecodeOptions &options,
+    const std::function< void(const char *, size_t) > &callback, LogDecodeStats *stats)
+{
+    LogDecodeStats result = {0, 0, 0, 0, 0, 0};
+    struct stat    st;
+    int            fd;
+    bool           ok;
+
+    HANDLE_EINTR(fd, open(path, O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    result.file_bytes = static_cast< uint64_t >(st.st_size);
+    void *base = mmap(nullptr, result.file_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    madvise(base, result.file_bytes, MADV_SEQUENTIAL);
+
+    uint32_t threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    threads          = std::max(threads, 1u);
+
+    // 压缩帧中直接保存的内容也包含块头部, 先判断是否是压缩文件
+    const uint8_t *data = static_cast< const uint8_t * >(base);
+    uint64_t       size = result.file_bytes;
+    if (FindLogCompressFrame(data, size, 0) < size) {
+        ok = DecodeLogCompressed(data, size, options, threads, callback, result);
+    } else if (FindLogBinaryBlock(data, size, 0) < size) {
+        DecodeLogBinary(data, size, options, threads, callback, result);
+        ok = true;
+    } else {
+        ok = false;
+    }
+    munmap(base, result.file_bytes);
+    if (ok && stats != nullptr) {
+        *stats = result;
+    }
+    return ok;
+}
+
+}    // namespace logging
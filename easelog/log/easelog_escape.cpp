@@ -0,0 +1,303 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_escape.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-19 00:20
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  日志内容的转义, 包括换行符和控制字符, JSON字符串和UTF-8校验. 使用SSE2/AVX2每次检查
+ *  16/32个字节, 没有需要转义的字节时不复制, 运行时按照CPUID选择实现, 其他平台逐字节检查.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EASELOG_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace logging {
+
+static const char kLogHexDigits[] = "0123456789abcdef";
+
+// 逐字节检查, 也用于SIMD实现的尾部
+static size_t FindLogEscapeScalar(const char *data, size_t length, uint32_t flags)
+{
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = static_cast< uint8_t >(data[i]);
+        if (((flags & LOG_ESCAPE_CONTROL) && (c < 0x20 || c == 0x7f) &&
+                !((flags & LOG_ESCAPE_TAB) && c == '\t')) ||
+            ((flags & LOG_ESCAPE_QUOTE) && (c == '"' || c == '\\')) ||
+            ((flags & LOG_ESCAPE_HIGH) && c >= 0x80)) {
+            return i;
+        }
+    }
+    return length;
+}
+
+#if defined(EASELOG_HAVE_X86_SIMD)
+
+// 16个字节中需要转义的字节位置掩码, 无符号比较通过max实现
+__attribute__((target("sse2"))) static uint32_t LogEscapeMaskSse2(__m128i value, uint32_t flags)
+{
+    __m128i mask = _mm_setzero_si128();
+
+    if (flags & LOG_ESCAPE_CONTROL) {
+        __m128i limit = _mm_set1_epi8(0x1f);
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(_mm_max_epu8(value, limit), limit));
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(value, _mm_set1_epi8(0x7f)));
+        if (flags & LOG_ESCAPE_TAB) {
+            mask = _mm_andnot_si128(_mm_cmpeq_epi8(value, _mm_set1_epi8('\t')), mask);
+        }
+    }
+    if (flags & LOG_ESCAPE_QUOTE) {
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(value, _mm_set1_epi8('"')));
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(value, _mm_set1_epi8('\\')));
+    }
+    uint32_t bits = static_cast< uint32_t >(_mm_movemask_epi8(mask));
+    if (flags & LOG_ESCAPE_HIGH) {
+        bits |= static_cast< uint32_t >(_mm_movemask_epi8(value));
+    }
+    return bits;
+}
+
+__attribute__((target("sse2"))) static size_t FindLogEscapeSse2(const char *data, size_t length,
+    uint32_t flags)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i  value = _mm_loadu_si128(reinterpret_cast< const __m128i * >(data + i));
+        uint32_t bits  = LogEscapeMaskSse2(value, flags);
+        if (bits != 0) {
+            return i + static_cast< size_t >(__builtin_ctz(bits));
+        }
+    }
+    return i + FindLogEscapeScalar(data + i, length - i, flags);
+}
+
+// 32个字节中需要转义的字节位置掩码
+__attribute__((target("avx2"))) static uint32_t LogEscapeMaskAvx2(__m256i value, uint32_t flags)
+{
+    __m256i mask = _mm256_setzero_si256();
+
+    if (flags & LOG_ESCAPE_CONTROL) {
+        __m256i limit = _mm256_set1_epi8(0x1f);
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(_mm256_max_epu8(value, limit), limit));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(value, _mm256_set1_epi8(0x7f)));
+        if (flags & LOG_ESCAPE_TAB) {
+            mask = _mm256_andnot_si256(_mm256_cmpeq_epi8(value, _mm256_set1_epi8('\t')), mask);
+        }
+    }
+    if (flags & LOG_ESCAPE_QUOTE) {
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(value, _mm256_set1_epi8('"')));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(value, _mm256_set1_epi8('\\')));
+    }
+    uint32_t bits = static_cast< uint32_t >(_mm256_movemask_epi8(mask));
+    if (flags & LOG_ESCAPE_HIGH) {
+        bits |= static_cast< uint32_t >(_mm256_movemask_epi8(value));
+    }
+    return bits;
+}
+
+__attribute__((target("avx2"))) static size_t FindLogEscapeAvx2(const char *data, size_t length,
+    uint32_t flags)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i  value = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(data + i));
+        uint32_t bits  = LogEscapeMaskAvx2(value, flags);
+        if (bits != 0) {
+            return i + static_cast< size_t >(__builtin_ctz(bits));
+        }
+    }
+    return i + FindLogEscapeSse2(data + i, length - i, flags);
+}
+
+#endif    // EASELOG_HAVE_X86_SIMD
+
+// 按照CPUID选择当前CPU支持的最快实现
+static uint32_t SelectLogEscapeKernel()
+{
+#if defined(EASELOG_HAVE_X86_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return LOG_ESCAPE_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return LOG_ESCAPE_KERNEL_SSE2;
+    }
+#endif    // EASELOG_HAVE_X86_SIMD
+    return LOG_ESCAPE_KERNEL_SCALAR;
+}
+
+// export: 获取当前CPU支持的最快实现, 第一次调用时选择
+uint32_t GetLogEscapeKernel()
+{
+    static const uint32_t g_log_escape_kernel = SelectLogEscapeKernel();
+    return g_log_escape_kernel;
+}
+
+// export: 使用指定的实现查找第一个需要转义的字节, 没有时返回length.
+// kernel必须是当前CPU支持的实现, 不大于GetLogEscapeKernel().
+size_t FindLogEscape(const char *data, size_t length, uint32_t flags, uint32_t kernel)
+{
+#if defined(EASELOG_HAVE_X86_SIMD)
+    if (kernel == LOG_ESCAPE_KERNEL_AVX2) {
+        return FindLogEscapeAvx2(data, length, flags);
+    }
+    if (kernel == LOG_ESCAPE_KERNEL_SSE2) {
+        return FindLogEscapeSse2(data, length, flags);
+    }
+#endif    // EASELOG_HAVE_X86_SIMD
+    (void)kernel;
+    return FindLogEscapeScalar(data, length, flags);
+}
+
+// export: 合法UTF-8字符的字节数, 不是合法的UTF-8字符时返回0.
+// 排除过长编码, 代理区和超出U+10FFFF的码点.
+size_t LogUtf8SequenceLength(const char *data, size_t length)
+{
+    const uint8_t *bytes = reinterpret_cast< const uint8_t * >(data);
+    uint8_t        lower = 0x80;
+    uint8_t        upper = 0xbf;
+    size_t         count;
+
+    if (length == 0) {
+        return 0;
+    }
+    if (bytes[0] < 0x80) {
+        return 1;
+    } else if (bytes[0] >= 0xc2 && bytes[0] <= 0xdf) {
+        count = 2;
+    } else if (bytes[0] >= 0xe0 && bytes[0] <= 0xef) {
+        count = 3;
+        lower = bytes[0] == 0xe0 ? 0xa0 : 0x80;
+        upper = bytes[0] == 0xed ? 0x9f : 0xbf;
+    } else if (bytes[0] >= 0xf0 && bytes[0] <= 0xf4) {
+        count = 4;
+        lower = bytes[0] == 0xf0 ? 0x90 : 0x80;
+        upper = bytes[0] == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return 0;
+    }
+
+    if (length < count || bytes[1] < lower || bytes[1] > upper) {
+        return 0;
+    }
+    for (size_t i = 2; i < count; i++) {
+        if (bytes[i] < 0x80 || bytes[i] > 0xbf) {
+            return 0;
+        }
+    }
+    return count;
+}
+
+static void AppendHexEscape(std::string &output, uint8_t c)
+{
+    output += "\\x";
+    output.push_back(kLogHexDigits[c >> 4]);
+    output.push_back(kLogHexDigits[c & 0xf]);
+}
+
+// export: 转义text中[start, end)范围内的换行符和控制字符(制表符除外), flags包含
+// LOG_SANITIZE_UTF8时同时转义不是合法UTF-8的字节. 不需要转义时不修改text.
+void SanitizeLogText(std::string &text, size_t start, size_t end, uint32_t flags)
+{
+    // 制表符原样保留, 不进入复制路径
+    uint32_t    scan   = LOG_ESCAPE_CONTROL | LOG_ESCAPE_TAB |
+        ((flags & LOG_SANITIZE_UTF8) ? LOG_ESCAPE_HIGH : 0);
+    uint32_t    kernel = GetLogEscapeKernel();
+    const char *data   = text.data();
+    size_t      pos    = start + FindLogEscape(data + start, end - start, scan, kernel);
+
+    if (pos == end) {
+        return;
+    }
+
+    std::string output;
+    output.reserve(text.size() + 16);
+    output.append(data, pos);
+    while (pos < end) {
+        uint8_t c = static_cast< uint8_t >(data[pos]);
+        if (c >= 0x80) {
+            size_t count = LogUtf8SequenceLength(data + pos, end - pos);
+            if (count != 0) {
+                output.append(data + pos, count);
+                pos += count;
+            } else {
+                AppendHexEscape(output, c);
+                pos++;
+            }
+        } else {
+            if (c == '\n') {
+                output += "\\n";
+            } else if (c == '\r') {
+                output += "\\r";
+            } else {
+                AppendHexEscape(output, c);
+            }
+            pos++;
+        }
+
+        size_t run = FindLogEscape(data + pos, end - pos, scan, kernel);
+        output.append(data + pos, run);
+        pos += run;
+    }
+    output.append(data + end, text.size() - end);
+    text.swap(output);
+}
+
+// export: 追加JSON字符串内容, 不包括两边的引号. 转义引号, 反斜杠和控制字符,
+// 不是合法UTF-8的字节替换为U+FFFD, 输出总是合法的JSON字符串.
+void AppendLogJsonEscaped(std::string &output, const char *data, size_t length)
+{
+    uint32_t scan   = LOG_ESCAPE_CONTROL | LOG_ESCAPE_QUOTE | LOG_ESCAPE_HIGH;
+    uint32_t kernel = GetLogEscapeKernel();
+    size_t   pos    = FindLogEscape(data, length, scan, kernel);
+
+    output.append(data, pos);
+    while (pos < length) {
+        uint8_t c     = static_cast< uint8_t >(data[pos]);
+        size_t  count = 1;
+        if (c >= 0x80) {
+            count = LogUtf8SequenceLength(data + pos, length - pos);
+            if (count != 0) {
+                output.append(data + pos, count);
+            } else {
+                output += "\\ufffd";
+                count = 1;
+            }
+        } else if (c == '"' || c == '\\') {
+            output.push_back('\\');
+            output.push_back(static_cast< char >(c));
+        } else if (c == '\n') {
+            output += "\\n";
+        } else if (c == '\t') {
+            output += "\\t";
+        } else if (c < 0x20) {
+            output += "\\u00";
+            output.push_back(kLogHexDigits[c >> 4]);
+            output.push_back(kLogHexDigits[c & 0xf]);
+        } else {
+            // DEL在JSON字符串中不需要转义
+            output.push_back(static_cast< char >(c));
+        }
+        pos += count;
+
+        size_t run = FindLogEscape(data + pos, length - pos, scan, kernel);
+        output.append(data + pos, run);
+        pos += run;
+    }
+}
+
+}    // namespace logging
@@ -0,0 +1,296 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_file.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 11:05
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  实现日志文件的打开和关闭, 日志写入由easelog.cpp在日志锁内完成.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace logging {
+
+// 日志文件描述符, 使用原子变量, 这样信号处理函数(RAW_LOG)中也可以安全读取.
+static std::atomic< int > g_log_file_fd(-1);
+// 文件描述符是否由日志库打开, 只有日志库打开的文件才由日志库关闭
+static bool               g_log_file_owned = false;
+
+// 日志文件格式, 下次打开日志文件时生效. 已经打开的日志文件是否使用二进制格式单独记录,
+// 信号处理函数中也可以安全读取.
+static std::atomic< LogFileFormat > g_log_file_format(LOG_FILE_FORMAT_TEXT);
+static std::atomic< bool >          g_log_file_binary(false);
+
+// 日志文件写入序号, 每写入一次加一, 只在持有日志锁时修改. io_uring和压缩写入时数据
+// 可能还在缓冲区中, 等待写入完成之后才更新已完成的序号, fdatasync只覆盖已完成的写入
+static std::atomic< uint64_t > g_log_file_written(0);
+static std::atomic< uint64_t > g_log_file_completed(0);
+
+// 日志文件的时间索引, 由日志锁保护. 日志文件每写入interval_bytes字节或者经过interval_us,
+// 在索引文件中追加一个索引项, 记录这一块日志的起始时间, 偏移, 长度和包含的日志等级.
+struct LogIndexWriter {
+    int           fd;                // 索引文件描述符, -1表示不写索引
+    uint32_t      interval_bytes;    // 索引块大小上限, 0表示不按大小切分
+    uint64_t      interval_us;       // 索引块时间跨度上限, 0表示不按时间切分
+    uint64_t      offset;            // 日志文件的当前写入位置
+    LogIndexEntry block;             // 当前正在累积的索引块
+};
+
+static LogIndexWriter g_log_index = {-1, 0, 0, 0, {}};
+
+// 按照日志文件路径打开索引文件, 新的日志文件同时清空旧的索引
+static void OpenLogIndex(const FilePath &path, int log_fd)
+{
+    off_t offset = lseek(log_fd, 0, SEEK_END);
+    int   flags  = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (offset == 0 ? O_TRUNC : 0);
+    int   fd;
+
+    if (offset < 0) {
+        return;
+    }
+    HANDLE_EINTR(fd, open((path + LOG_INDEX_SUFFIX).c_str(), flags, 0644));
+    if (fd < 0) {
+        return;
+    }
+
+    // 空的索引文件先写入头部, 已有的索引文件继续追加
+    if (lseek(fd, 0, SEEK_END) == 0) {
+        LogIndexHeader header = {LOG_INDEX_MAGIC, LOG_INDEX_VERSION};
+        if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+            close(fd);
+            return;
+        }
+    }
+    g_log_index.fd           = fd;
+    g_log_index.offset       = static_cast< uint64_t >(offset);
+    g_log_index.block.length = 0;
+}
+
+// 追加当前索引块, 写入失败时丢弃, 读取时退化为扫描
+static void FlushLogIndexBlock()
+{
+    if (g_log_index.fd >= 0 && g_log_index.block.length != 0) {
+        if (write(g_log_index.fd, &g_log_index.block, sizeof(LogIndexEntry)) < 0) {
+            // Give up, nothing we can do now.
+        }
+    }
+    g_log_index.block.length = 0;
+}
+
+// 关闭索引文件, 先写入没有结束的索引块
+static void CloseLogIndex()
+{
+    if (g_log_index.fd >= 0) {
+        FlushLogIndexBlock();
+        close(g_log_index.fd);
+        g_log_index.fd = -1;
+    }
+}
+
+// export: 设置日志文件时间索引, 两个间隔都为0时关闭, 下次打开日志文件时生效
+void SetLogFileIndex(uint32_t interval_kb, uint32_t interval_ms)
+{
+    g_log_index.interval_bytes = interval_kb * 1024;
+    g_log_index.interval_us    = static_cast< uint64_t >(interval_ms) * 1000;
+}
+
+// export: 设置日志文件格式, 下次打开日志文件时生效
+void SetLogFileFormat(LogFileFormat format)
+{
+    g_log_file_format.store(format, std::memory_order_relaxed);
+}
+
+// export: 获取日志文件格式
+LogFileFormat GetLogFileFormat()
+{
+    return g_log_file_format.load(std::memory_order_relaxed);
+}
+
+// export: 判断已经打开的日志文件是否使用二进制格式, 异步信号安全
+bool IsLogFileBinary()
+{
+    return g_log_file_binary.load(std::memory_order_relaxed);
+}
+
+// 按照当前设置的格式开始写入新打开的日志文件
+static void StartLogFileFormat()
+{
+    bool binary = g_log_file_format.load(std::memory_order_relaxed) == LOG_FILE_FORMAT_BINARY;
+
+    if (binary) {
+        ResetLogBinaryWriter();
+    }
+    g_log_file_binary.store(binary, std::memory_order_relaxed);
+}
+
+// 组提交状态, 由g_log_sync_mutex保护. 同一时间只有一个线程执行fdatasync,
+// 其他等待者在同步完成后检查自己的写入是否已经覆盖, 没有覆盖时再发起下一次同步.
+static std::mutex              g_log_sync_mutex;
+static std::condition_variable g_log_sync_cond;
+static uint64_t                g_log_file_synced  = 0;        // 已经落盘的写入序号
+static bool                    g_log_file_syncing = false;    // 是否有线程正在同步
+static std::atomic< uint64_t > g_log_file_sync_count(0);      // fdatasync调用次数
+
+// export: 打开日志文件, 已经打开时直接返回, 调用者需要保证互斥.
+// 优先使用外部提供的文件句柄, 否则以追加方式打开log_file_path指定的文件.
+bool InitializeLogFileHandle()
+{
+    const LoggingSettings &settings = GetLoggingSettings();
+
+    if (g_log_file_fd.load(std::memory_order_relaxed) >= 0) {
+        return true;
+    }
+
+    if (settings.log_file != nullptr) {
+        StartLogFileFormat();
+        g_log_file_fd.store(fileno(settings.log_file), std::memory_order_release);
+        g_log_file_owned = false;
+        return true;
+    }
+
+    if (settings.log_file_path == nullptr || settings.log_file_path->empty()) {
+        return false;
+    }
+
+    int fd;
+    HANDLE_EINTR(fd, open(settings.log_file_path->c_str(),
+                         O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644));
+    if (fd < 0) {
+        return false;
+    }
+
+    StartLogFileFormat();
+    g_log_file_fd.store(fd, std::memory_order_release);
+    g_log_file_owned = true;
+    // 压缩写入和io_uring同样只用于日志库打开的文件, 压缩写入优先
+    if (!OpenLogCompress(fd)) {
+        OpenLogUring(*settings.log_file_path, fd);
+    }
+    // 只为日志库打开的文本文件写索引, 外部文件句柄的写入位置未知, 压缩文件的偏移没有意义
+    if (!IsLogFileBinary() && !IsLogFileCompressed() &&
+        (g_log_index.interval_bytes != 0 || g_log_index.interval_us != 0)) {
+        OpenLogIndex(*settings.log_file_path, fd);
+    }
+    return true;
+}
+
+// export: 关闭日志文件, 下次写文件时重新打开
+void CloseLogFile()
+{
+    CloseLogCompress();
+    CloseLogUring();
+
+    int fd = g_log_file_fd.exchange(-1, std::memory_order_acq_rel);
+
+    CloseLogIndex();
+    g_log_file_binary.store(false, std::memory_order_relaxed);
+    if (fd >= 0 && g_log_file_owned) {
+        close(fd);
+    }
+    g_log_file_owned = false;
+}
+
+// export: 获取日志文件描述符, 未打开时返回-1, 异步信号安全
+int GetLogFileFd()
+{
+    return g_log_file_fd.load(std::memory_order_acquire);
+}
+
+// export: 记录一次日志文件写入, 更新时间索引, 返回写入序号, 调用者需要持有日志锁.
+// tv是这一行日志的输出时间, 单调递增, 写入在行边界切分索引块.
+uint64_t NoteLogFileWrite(const struct timeval &tv, uint32_t severity_mask, size_t length)
+{
+    uint64_t seq = g_log_file_written.load(std::memory_order_relaxed) + 1;
+
+    g_log_file_written.store(seq, std::memory_order_release);
+    if (g_log_index.fd < 0) {
+        return seq;
+    }
+
+    LogIndexEntry &block = g_log_index.block;
+    uint64_t       now   = static_cast< uint64_t >(tv.tv_sec) * 1000000 +
+        static_cast< uint64_t >(tv.tv_usec);
+    if (block.length == 0) {
+        block.first_us      = now;
+        block.offset        = g_log_index.offset;
+        block.severity_mask = 0;
+    }
+    block.severity_mask |= severity_mask;
+    block.length += length;
+    g_log_index.offset += length;
+
+    if ((g_log_index.interval_bytes != 0 && block.length >= g_log_index.interval_bytes) ||
+        (g_log_index.interval_us != 0 && now - block.first_us >= g_log_index.interval_us)) {
+        FlushLogIndexBlock();
+    }
+    return seq;
+}
+
+// export: 获取最近一次日志文件写入的序号
+uint64_t GetLogFileWriteSeq()
+{
+    return g_log_file_written.load(std::memory_order_acquire);
+}
+
+// export: 记录目前为止的所有写入都已经到达日志文件, 调用者需要持有日志锁, 并且已经
+// 等待io_uring写入和压缩写入完成
+void NoteLogFileCompleted()
+{
+    g_log_file_completed.store(g_log_file_written.load(std::memory_order_relaxed),
+        std::memory_order_release);
+}
+
+// export: 等待写入序号seq之前的日志文件内容落盘, 并发的等待者共享一次fdatasync.
+// 发起同步的线程在开始时读取已完成的序号, 这些写入都已经到达文件, 同步之后全部落盘.
+// 调用者需要先调用NoteLogFileCompleted(), 否则会一直等待.
+void WaitLogFileSynced(uint64_t seq)
+{
+    std::unique_lock< std::mutex > lock(g_log_sync_mutex);
+
+    while (g_log_file_synced < seq) {
+        if (g_log_file_syncing) {
+            g_log_sync_cond.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        g_log_file_syncing = true;
+        uint64_t covered   = g_log_file_completed.load(std::memory_order_acquire);
+        int      fd        = GetLogFileFd();
+        lock.unlock();
+        LogTestDelay(LOG_TEST_POINT_SYNC);
+        if (fd >= 0) {
+            fdatasync(fd);
+            g_log_file_sync_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        lock.lock();
+        g_log_file_syncing = false;
+        g_log_file_synced  = std::max(g_log_file_synced, covered);
+        g_log_sync_cond.notify_all();
+    }
+}
+
+// export: 获取日志文件fdatasync的调用次数
+uint64_t GetLogFileSyncCount()
+{
+    return g_log_file_sync_count.load(std::memory_order_relaxed);
+}
+
+}    // namespace logging
@@ -0,0 +1,289 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_index.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 18:05
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  日志文件时间索引的读取, 按照时间范围和日志等级跳过无关的日志块.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace logging {
+
+#define LOG_RANGE_BUFFER_SIZE (1024 * 1024)
+// 检查文件格式时读取的文件开头长度
+#define LOG_RANGE_HEAD_SIZE   (64 * 1024)
+
+// 读取索引文件, 格式错误或者不存在时返回空索引, 丢弃超出日志文件大小的索引项
+static std::vector< LogIndexEntry > ReadLogIndex(const std::string &path, uint64_t file_bytes)
+{
+    std::vector< LogIndexEntry > entries;
+    LogIndexHeader               header;
+    struct stat                  st;
+    int                          fd;
+
+    HANDLE_EINTR(fd, open((path + LOG_INDEX_SUFFIX).c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return entries;
+    }
+    if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != LOG_INDEX_MAGIC || header.version != LOG_INDEX_VERSION) {
+        close(fd);
+        return entries;
+    }
+
+    size_t count = (static_cast< size_t >(st.st_size) - sizeof(header)) / sizeof(LogIndexEntry);
+    entries.resize(count);
+    ssize_t bytes = pread(fd, entries.data(), count * sizeof(LogIndexEntry), sizeof(header));
+    close(fd);
+    entries.resize(bytes > 0 ? static_cast< size_t >(bytes) / sizeof(LogIndexEntry) : 0);
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].offset + entries[i].length > file_bytes) {
+            entries.resize(i);
+            break;
+        }
+    }
+    return entries;
+}
+
+// 根据索引选出需要读取的文件区间, 相邻区间合并.
+// 索引项按照时间递增, 索引块中最后一行的时间不晚于下一个索引块的起始时间.
+// 没有被索引覆盖的区间(索引写入之前的日志, 最后一个没有结束的索引块)总是需要读取.
+static std::vector< std::pair< uint64_t, uint64_t > > SelectLogRanges(
+    const std::vector< LogIndexEntry > &entries, uint64_t file_bytes, uint64_t begin_us,
+    uint64_t end_us, uint32_t severity_mask)
+{
+    std::vector< std::pair< uint64_t, uint64_t > > ranges;
+    uint64_t                                       covered = 0;
+
+    auto add_range = [&ranges](uint64_t start, uint64_t end) {
+        if (start >= end) {
+            return;
+        }
+        if (!ranges.empty() && ranges.back().second == start) {
+            ranges.back().second = end;
+        } else {
+            ranges.emplace_back(start, end);
+        }
+    };
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const LogIndexEntry &entry = entries[i];
+        add_range(covered, entry.offset);
+        covered = entry.offset + entry.length;
+
+        // 之后的日志都不早于结束时间
+        if (entry.first_us >= end_us) {
+            return ranges;
+        }
+        if (i + 1 < entries.size() && entries[i + 1].first_us < begin_us) {
+            continue;
+        }
+        if (entry.severity_mask & severity_mask) {
+            add_range(entry.offset, covered);
+        }
+    }
+    add_range(covered, file_bytes);
+    return ranges;
+}
+
+// 日志行的解析状态, 没有时间戳的行沿用上一行的时间和等级
+struct LogLineParser {
+    uint64_t time_us;           // 当前行的时间
+    uint32_t severity_mask;     // 当前行的日志等级
+    uint32_t __pad;             // 保留字段
+    uint64_t minute_us;         // 缓存的分钟起始时间, 避免每一行都调用mktime
+    char     minute[17];        // 缓存的分钟, 格式YYYY-MM-DDTHH:MM
+    char     __pad1[7];         // 保留字段
+};
+
+// 解析非负十进制整数
+static bool ParseDigits(const char *data, size_t count, int *value)
+{
+    *value = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (data[i] < '0' || data[i] > '9') {
+            return false;
+        }
+        *value = *value * 10 + (data[i] - '0');
+    }
+    return true;
+}
+
+// 解析日志行的时间戳和等级, 格式为"YYYY-MM-DDTHH:MM:SS.uuuuuu+HH:MM <name> ",
+// 时间戳是本地时间, 和写入日志时的时区一致, 时区部分的长度不固定.
+static void ParseLogLine(LogLineParser &parser, const char *line, size_t length)
+{
+    const size_t kTimeSize = 26;
+    int          second, usec;
+
+    if (length <= kTimeSize || line[4] != '-' || line[10] != 'T' || line[19] != '.' ||
+        !ParseDigits(line + 17, 2, &second) || !ParseDigits(line + 20, 6, &usec)) {
+        return;
+    }
+
+    if (memcmp(parser.minute, line, 16) != 0) {
+        struct tm local_time;
+        int       year, month, day, hour, minute;
+        memset(&local_time, 0, sizeof(local_time));
+        if (!ParseDigits(line, 4, &year) || !ParseDigits(line + 5, 2, &month) ||
+            !ParseDigits(line + 8, 2, &day) || !ParseDigits(line + 11, 2, &hour) ||
+            !ParseDigits(line + 14, 2, &minute)) {
+            return;
+        }
+        local_time.tm_year  = year - 1900;
+        local_time.tm_mon   = month - 1;
+        local_time.tm_mday  = day;
+        local_time.tm_hour  = hour;
+        local_time.tm_min   = minute;
+        local_time.tm_isdst = -1;
+        time_t t            = mktime(&local_time);
+        if (t < 0) {
+            return;
+        }
+        memcpy(parser.minute, line, 16);
+        parser.minute_us = static_cast< uint64_t >(t) * 1000000;
+    }
+    parser.time_us = parser.minute_us + static_cast< uint64_t >(second) * 1000000 +
+        static_cast< uint64_t >(usec);
+
+    // 日志等级名字, VLOG日志的等级名字后面带有详细等级. 时间戳和等级名字之间可能有日志前缀
+    // 和tickcount, 等级名字是第一个'>'之前的'<'
+    const LoggingSettings &settings = GetLoggingSettings();
+    parser.severity_mask            = LOG_SEVERITY_MASK_ALL;
+    const char *end =
+        static_cast< const char * >(memchr(line + kTimeSize, '>', length - kTimeSize));
+    if (end == nullptr) {
+        return;
+    }
+    const char *name = static_cast< const char * >(
+        memrchr(line + kTimeSize, '<', static_cast< size_t >(end - line) - kTimeSize));
+    if (name == nullptr) {
+        return;
+    }
+    name++;
+    size_t name_size = static_cast< size_t >(end - name);
+    for (LogSeverity severity = 0; severity < LOGGING_NUM_SEVERITIES; severity++) {
+        const char *severity_name = settings.log_severity_names[severity];
+        if (strlen(severity_name) == name_size && memcmp(severity_name, name, name_size) == 0) {
+            parser.severity_mask = LogSeverityMask(severity);
+            return;
+        }
+    }
+    if (name_size >= 7 && memcmp(name, "VERBOSE", 7) == 0) {
+        parser.severity_mask = LogSeverityMask(LOGGING_DEBUG);
+    }
+}
+
+// export: 按照时间范围和日志等级读取日志文件, 使用索引跳过无关的日志块
+bool ReadLogFileRange(const char *path, uint64_t begin_us, uint64_t end_us,
+    uint32_t severity_mask, const std::function< void(const char *, size_t) > &callback,
+    LogRangeStats *stats)
+{
+    LogRangeStats result = {0, 0, 0, 0};
+    struct stat   st;
+    int           fd;
+
+    HANDLE_EINTR(fd, open(path, O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // 压缩和二进制格式的日志文件不能按行读取, 需要先解码
+    std::vector< char > buffer(LOG_RANGE_BUFFER_SIZE);
+    ssize_t             head;
+    HANDLE_EINTR(head, pread(fd, buffer.data(), LOG_RANGE_HEAD_SIZE, 0));
+    if (head > 0) {
+        const uint8_t *data = reinterpret_cast< const uint8_t * >(buffer.data());
+        uint64_t       size = static_cast< uint64_t >(head);
+        if (FindLogCompressFrame(data, size, 0) < size ||
+            FindLogBinaryBlock(data, size, 0) < size) {
+            close(fd);
+            return false;
+        }
+    }
+
+    result.file_bytes                    = static_cast< uint64_t >(st.st_size);
+    std::vector< LogIndexEntry > entries = ReadLogIndex(path, result.file_bytes);
+    result.index_entries                 = entries.size();
+
+    for (const std::pair< uint64_t, uint64_t > &range :
+        SelectLogRanges(entries, result.file_bytes, begin_us, end_us, severity_mask)) {
+        LogLineParser parser;
+        memset(&parser, 0, sizeof(parser));
+        parser.severity_mask = LOG_SEVERITY_MASK_ALL;
+
+        // 区间按行对齐, 缓冲区末尾不完整的行移动到开头, 和后面的数据拼接
+        uint64_t offset = range.first;
+        size_t   used   = 0;
+        while (offset < range.second || used != 0) {
+            size_t  want  = static_cast< size_t >(
+                std::min< uint64_t >(buffer.size() - used, range.second - offset));
+            ssize_t bytes = want != 0 ?
+                pread(fd, buffer.data() + used, want, static_cast< off_t >(offset)) : 0;
+            if (bytes < 0) {
+                close(fd);
+                return false;
+            }
+            offset += static_cast< uint64_t >(bytes);
+            used += static_cast< size_t >(bytes);
+            result.scanned_bytes += static_cast< uint64_t >(bytes);
+
+            bool   last  = offset >= range.second || bytes == 0;
+            size_t start = 0;
+            while (start < used) {
+                const char *line = buffer.data() + start;
+                const char *end  = static_cast< const char * >(memchr(line, '\n', used - start));
+                if (end == nullptr && !last && start != 0) {
+                    break;
+                }
+                size_t length = end != nullptr ? static_cast< size_t >(end - line) + 1
+                                               : used - start;
+                ParseLogLine(parser, line, length);
+                if (parser.time_us >= begin_us && parser.time_us < end_us &&
+                    (parser.severity_mask & severity_mask)) {
+                    callback(line, length);
+                    result.lines++;
+                }
+                start += length;
+            }
+            memmove(buffer.data(), buffer.data() + start, used - start);
+            used -= start;
+            if (last) {
+                break;
+            }
+        }
+    }
+
+    close(fd);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    return true;
+}
+
+}    // namespace logging
@@ -0,0 +1,156 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_logger.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 23:05
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  实现命名日志对象, 按照名字前缀分层设置日志等级, 解析结果缓存在日志对象中.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace logging {
+
+// 命名日志对象的注册表, 日志对象构造时加入链表, 等级规则按照名字前缀匹配
+struct LoggerRegistry {
+    std::mutex                                       mutex;    // 保护链表和规则
+    Logger                                          *head;     // 已经注册的日志对象
+    std::vector< std::pair< std::string, int32_t > > rules;    // 前缀和对应的日志等级
+
+    // 函数内的静态对象, 其他编译单元的静态日志对象构造时也可以使用
+    static LoggerRegistry &Get()
+    {
+        static LoggerRegistry registry;
+        return registry;
+    }
+
+    // 判断|prefix|是否覆盖|name|, 只在'.'分隔的边界上匹配
+    static bool MatchPrefix(const char *name, const std::string &prefix)
+    {
+        if (prefix.empty()) {
+            return true;
+        }
+        if (strncmp(name, prefix.data(), prefix.size()) != 0) {
+            return false;
+        }
+        return name[prefix.size()] == '\0' || name[prefix.size()] == '.';
+    }
+
+    // 解析日志对象的最小日志等级, 最长的前缀优先, 没有匹配时使用全局等级.
+    // 调用者需要持有注册表锁.
+    void Resolve(Logger *logger) const
+    {
+        int32_t level  = GetMinLogLevel();
+        size_t  length = 0;
+        bool    found  = false;
+
+        for (const auto &rule : rules) {
+            if ((!found || rule.first.size() > length) && MatchPrefix(logger->name_, rule.first)) {
+                level  = rule.second;
+                length = rule.first.size();
+                found  = true;
+            }
+        }
+        logger->min_level_.store(level, std::memory_order_relaxed);
+        logger->create_level_.store(GetLogCreateLevel(level), std::memory_order_relaxed);
+    }
+
+    void ResolveAll() const
+    {
+        for (Logger *logger = head; logger != nullptr; logger = logger->next_) {
+            Resolve(logger);
+        }
+    }
+};
+
+// export: 构造命名日志对象, 加入注册表并解析日志等级
+Logger::Logger(const char *name)
+    : name_(name), next_(nullptr), create_level_(LOGGING_INFO), min_level_(LOGGING_INFO)
+{
+    LoggerRegistry               &registry = LoggerRegistry::Get();
+    std::lock_guard< std::mutex > lock(registry.mutex);
+
+    next_         = registry.head;
+    registry.head = this;
+    registry.Resolve(this);
+}
+
+// export: 析构命名日志对象, 从注册表中移除
+Logger::~Logger()
+{
+    LoggerRegistry               &registry = LoggerRegistry::Get();
+    std::lock_guard< std::mutex > lock(registry.mutex);
+
+    for (Logger **link = &registry.head; *link != nullptr; link = &(*link)->next_) {
+        if (*link == this) {
+            *link = next_;
+            break;
+        }
+    }
+}
+
+// export: 设置名字前缀对应的日志等级, 重复设置时覆盖
+void SetLoggerLevel(const char *prefix, int32_t level)
+{
+    LoggerRegistry               &registry = LoggerRegistry::Get();
+    std::lock_guard< std::mutex > lock(registry.mutex);
+
+    level = std::min(LOGGING_FATAL, level);
+    for (auto &rule : registry.rules) {
+        if (rule.first == prefix) {
+            rule.second = level;
+            registry.ResolveAll();
+            return;
+        }
+    }
+    registry.rules.emplace_back(prefix, level);
+    registry.ResolveAll();
+}
+
+// export: 移除名字前缀对应的日志等级
+void ClearLoggerLevel(const char *prefix)
+{
+    LoggerRegistry               &registry = LoggerRegistry::Get();
+    std::lock_guard< std::mutex > lock(registry.mutex);
+
+    auto &rules = registry.rules;
+    rules.erase(std::remove_if(rules.begin(), rules.end(),
+                    [prefix](const std::pair< std::string, int32_t > &rule) {
+                        return rule.first == prefix;
+                    }),
+        rules.end());
+    registry.ResolveAll();
+}
+
+// export: 全局配置变化后重新解析所有命名日志对象的日志等级
+void UpdateLoggerLevels()
+{
+    LoggerRegistry               &registry = LoggerRegistry::Get();
+    std::lock_guard< std::mutex > lock(registry.mutex);
+
+    registry.ResolveAll();
+}
+
+// export: fork之后在子进程中调用, 注册表锁可能被fork时的其他线程持有
+void ResetLoggerRegistryAfterFork()
+{
+    new (&LoggerRegistry::Get().mutex) std::mutex();
+}
+
+}    // namespace logging
@@ -36,12 +36,13 @@ namespace logging {
 using ProcessId                    = pid_t;
 constexpr ProcessId kNullProcessId = 0;
 
+// 缓存的进程ID和线程ID, fork之后在子进程中失效, 由ResetLogProcessIds()清除
+static ProcessId              g_process_pid = kNullProcessId;
+static thread_local ProcessId g_thread_tid  = kNullProcessId;
+
 // Get the process ID of the current process.
 static inline ProcessId GetCurrentProcessId()
 {
-    // This is a static function local variable that is used to store the PID of the process.
-    static ProcessId g_process_pid = kNullProcessId;
-
     if (UNLIKELY(g_process_pid == kNullProcessId)) {
         g_process_pid = getpid();
     }
@@ -57,8 +58,7 @@ static inline const char *GetProgramName(void)
 // Get the process ID of the current thread.
 static inline ProcessId GetCurrentThreadId(void)
 {
-    static thread_local ProcessId g_thread_tid = kNullProcessId;
-    decltype(syscall(0))          ret;
+    decltype(syscall(0)) ret;
 
     if (g_thread_tid == kNullProcessId) {
         ret          = syscall(__NR_gettid);
@@ -67,6 +67,71 @@ static inline ProcessId GetCurrentThreadId(void)
     return g_thread_tid;
 }
 
+// export: fork之后在子进程中清除缓存的进程ID和线程ID, 子进程中只剩下调用fork的线程
+void ResetLogProcessIds()
+{
+    g_process_pid = kNullProcessId;
+    g_thread_tid  = kNullProcessId;
+}
+
+// export: 获取当前进程ID, 使用缓存
+pid_t GetLogProcessId()
+{
+    return GetCurrentProcessId();
+}
+
+// export: 获取当前线程ID, 使用缓存
+pid_t GetLogThreadId()
+{
+    return GetCurrentThreadId();
+}
+
+// export: 获取程序名字
+const char *GetLogProgramName()
+{
+    return GetProgramName();
+}
+
+// 线程的日志上下文, 每一层为"[key=value] ", 压入时格式化一次, 日志只拷贝缓存的内容
+static thread_local std::string g_log_context;
+
+// 压入一层日志上下文, 析构时截断到之前的长度
+void ScopedLogContext::Push(const char *key, const std::string &value)
+{
+    length_ = g_log_context.size();
+    g_log_context.append(1, '[').append(key).append(1, '=').append(value).append("] ");
+}
+
+// 替换为捕获的日志上下文, 析构时恢复原来的上下文
+ScopedLogContext::ScopedLogContext(const LogContext &context)
+    : saved_(context.rendered), length_(SIZE_MAX)
+{
+    g_log_context.swap(saved_);
+}
+
+ScopedLogContext::~ScopedLogContext()
+{
+    if (length_ == SIZE_MAX) {
+        g_log_context.swap(saved_);
+    } else {
+        g_log_context.resize(length_);
+    }
+}
+
+// export: 捕获当前线程的日志上下文
+LogContext CaptureLogContext()
+{
+    return LogContext{g_log_context};
+}
+
+// export: 追加当前线程的日志上下文, 没有上下文时只判断一次长度
+void AppendLogContext(LogStream &stream)
+{
+    if (UNLIKELY(!g_log_context.empty())) {
+        stream.write(g_log_context.data(), g_log_context.size());
+    }
+}
+
 // 获取日志服务等级名称, 输出C字符串指针
 static const char *log_severity_name(const LoggingSettings &log_settings, int32_t severity)
 {
@@ -80,11 +145,20 @@ static const char *log_severity_name(const LoggingSettings &log_settings, int32_
 
 void LogSyslogPrefixTimestamp(const LoggingSettings &log_settings, std::string &timestamp)
 {
-    std::ostringstream stream;
+    timeval tv{};
 
     if (log_settings.log_timestamp) {
-        timeval tv{};
         gettimeofday(&tv, nullptr);
+    }
+    LogSyslogPrefixTimestamp(log_settings, tv, timestamp);
+}
+
+void LogSyslogPrefixTimestamp(const LoggingSettings &log_settings, const struct timeval &tv,
+    std::string &timestamp)
+{
+    std::ostringstream stream;
+
+    if (log_settings.log_timestamp) {
         time_t t = tv.tv_sec;
 
         struct tm utc_time { };
@@ -105,44 +179,45 @@ void LogSyslogPrefixTimestamp(const LoggingSettings &log_settings, std::string &
     timestamp = stream.str();
 }
 
+// export: 按照调用点生成日志前缀, |tickcount|只在开启log_tickcount时使用.
 // base style log prefix, eg.
 // [unknown_pid:unknown_tid:0826/145119.098911:19408886280525:info:logging_unittest.cpp(66)]
 // log message
-static void InitSyslogPrefixWithBaseStyle(LogMessage &log, const LoggingSettings &log_settings)
+void AppendLogPrefix(LogStream &stream, const LoggingSettings &log_settings,
+    LogSeverity severity, const char *file, const char *func, int line, uint64_t tickcount)
 {
-    std::ostream &stream_ = log.stream();
-
     if (log_settings.log_prefix) {
-        stream_ << log_settings.log_prefix << ':';
+        stream << log_settings.log_prefix << ':';
     }
     if (log_settings.log_tickcount) {
-        stream_ << TickCountUs() << ' ';
+        stream << tickcount << ' ';
     }
 
     // 日志等级信息
-    stream_ << '<' << log_severity_name(log_settings, log.severity());
-    if (log.severity() < 0) {
-        stream_ << -log.severity();
+    stream << '<' << log_severity_name(log_settings, severity);
+    if (severity < 0) {
+        stream << -severity;
     }
-    stream_ << '>';
+    stream << '>';
 
-    stream_ << ' ' << GetProgramName();
+    stream << ' ' << GetProgramName();
     if (log_settings.log_process_id) {
-        stream_ << '[' << GetCurrentProcessId() << ']';
+        stream << '[' << GetCurrentProcessId() << ']';
     }
-    stream_ << ": [";
+    stream << ": [";
     if (log_settings.log_thread_id) {
         char thread_name[16] = {0};
         // 获取当前线程的名字
         pthread_getname_np(pthread_self(), thread_name, sizeof(thread_name));
-        stream_ << thread_name << '(' << GetCurrentThreadId() << ") - ";
+        stream << thread_name << '(' << GetCurrentThreadId() << ") - ";
     }
-    stream_ << log.file() << '(' << log.func() << '-' << log.line() << ")] ";
+    stream << file << '(' << func << '-' << line << ")] ";
 }
 
 void LogMessage::InitWithSyslogPrefix(const LoggingSettings &settings)
 {
-    InitSyslogPrefixWithBaseStyle(*this, settings);
+    AppendLogPrefix(stream_, settings, severity_, file_, func_, line_,
+        settings.log_tickcount ? TickCountUs() : 0);
 }
 
 }    // namespace logging
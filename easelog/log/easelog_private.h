@@ -17,10 +17,17 @@
 #define EASELOG_PRIVATE_H_
 
 #include <errno.h>
+#include <sys/time.h>
+#include <sys/types.h>
 
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <string>
 #include <utility>
 #include <type_traits>
 #include <functional>
+#include <vector>
 
 namespace logging {
 
@@ -37,7 +44,7 @@ namespace logging {
         do {                                                    \
             eintr_wrapper_result = (func_call);                 \
         } while (eintr_wrapper_result == -1 && errno == EINTR); \
-        eintr_wrapper_result;                                   \
+        ret = eintr_wrapper_result;                             \
     } while (0)
 
 #else
@@ -129,8 +136,332 @@ static inline uint64_t TickCountUs()
     return absolute_us;
 }
 
-// 用于构造并发时序, 随机等待 10-50ms
-void RandomSleep();
+// 通配符匹配, 用于vmodule规则, 支持'*'和'?'
+bool MatchVlogPattern(const char *string, const char *pattern);
+
+// 日志初始化时加载vmodule配置, |vmodule|为空时保持当前配置
+void MaybeInitializeVlogInfo(const char *vmodule);
+
+// 使所有VLOG调用点的缓存失效
+void InvalidateVlogCallSites();
+
+// fork之后在子进程中重新初始化vmodule规则锁, 并使所有VLOG调用点的缓存失效
+void ResetVlogAfterFork();
+
+// 打开日志文件, 已经打开时直接返回, 调用者需要持有日志锁
+bool InitializeLogFileHandle();
+
+// 关闭日志文件, 调用者需要持有日志锁
+void CloseLogFile();
+
+// 获取日志文件描述符, 未打开时返回-1, 异步信号安全
+int GetLogFileFd();
+
+// 为新打开的日志文件创建io_uring实例, 没有开启或者不可用时返回false, 调用者需要持有日志锁
+bool OpenLogUring(const FilePath &path, int log_fd);
+
+// 等待所有写入完成并释放io_uring实例, 调用者需要持有日志锁
+void CloseLogUring();
+
+// 写入一段日志到io_uring提交缓冲区, 缓冲区写满时提交, 调用者需要持有日志锁
+void LogUringWriteLocked(const char *data, size_t length);
+
+// 一批日志输出完时提交io_uring缓冲区, 不等待写入完成, 没有使用io_uring时直接返回.
+// 调用者需要持有日志锁.
+void SubmitLogUringLocked();
+
+// 提交io_uring缓冲区并等待所有写入完成, 调用者需要持有日志锁
+void WaitLogUringLocked();
+
+// 崩溃时同步写入一段日志到io_uring的日志文件, 异步信号安全, 调用者需要持有日志锁
+void LogUringEmergencyWriteLocked(const char *data, size_t length);
+
+// fork之后在子进程中停止使用父进程的io_uring实例
+void ResetLogUringAfterFork();
+
+// 压缩日志文件格式. 文件由连续的帧组成, 每个帧以帧头部开始, 帧数据独立压缩,
+// 按顺序拼接所有帧的原始内容就是未压缩的日志文件. 帧头部使用本机字节序.
+#define LOG_COMPRESS_MAGIC  "\x89" "ELGCMP\n"
+#define LOG_COMPRESS_STORED 0    // 帧数据就是原始内容
+#define LOG_COMPRESS_LZ     1    // 帧数据使用LZ4块格式压缩
+
+struct LogCompressFrameHeader {
+    char     magic[8];      // 同步标记, 解码时用于定位帧的起始位置
+    uint64_t first_us;      // 帧内第一段日志的写入时间, 单位us
+    uint32_t raw_length;    // 原始内容长度
+    uint32_t length;        // 帧数据长度, 不包括帧头部
+    uint32_t codec;         // 帧数据的编码方式
+    uint32_t check;         // 头部校验值, 用于排除日志内容中的同步标记
+};
+
+// 计算帧头部的校验值
+uint32_t LogCompressFrameCheck(const LogCompressFrameHeader &header);
+
+// 压缩一块数据, 压缩后没有变小时返回0
+size_t LogLzCompress(const char *data, size_t length, char *output, size_t capacity);
+
+// 解压一块数据, 输出长度必须正好是raw_length
+bool LogLzDecompress(const char *data, size_t length, char *output, size_t raw_length);
+
+// 为新打开的日志文件开始压缩写入, 没有开启时返回false, 调用者需要持有日志锁
+bool OpenLogCompress(int log_fd);
+
+// 写入所有块并停止压缩线程, 调用者需要持有日志锁
+void CloseLogCompress();
+
+// 写入一段日志到当前块, 块写满时交给压缩线程, 调用者需要持有日志锁
+void LogCompressWriteLocked(const char *data, size_t length);
+
+// 封装当前块并等待所有块写入完成, 没有压缩写入时直接返回, 调用者需要持有日志锁
+void WaitLogCompressLocked();
+
+// 崩溃时不压缩直接写入日志, 异步信号安全, 调用者需要持有日志锁
+void LogCompressEmergencyWriteLocked(const char *data, size_t length);
+
+// fork之后在子进程中放弃父进程的块, 下次封装时重新启动压缩线程
+void ResetLogCompressAfterFork();
+
+// 查找下一个有效的帧头部, 没有时返回size
+uint64_t FindLogCompressFrame(const uint8_t *data, uint64_t size, uint64_t pos);
+
+// 压缩日志文件中的一个完整的帧
+struct LogCompressFrame {
+    LogCompressFrameHeader header;
+    uint64_t               pos;    // 帧头部在文件中的位置
+};
+
+// 查找文件中所有完整的帧, 只读取帧头部, 不解压, 其他内容计入损坏字节数
+void ScanLogCompressFrames(const uint8_t *data, uint64_t size,
+    std::vector< LogCompressFrame > *frames, uint64_t *corrupt_bytes);
+
+// 并行解压连续的count个帧, 按照文件顺序追加到output末尾, 解压失败的帧计入损坏字节数
+void InflateLogFrames(const uint8_t *data, const LogCompressFrame *frames, size_t count,
+    uint32_t threads, std::string *output, uint64_t *corrupt_bytes);
+
+// 日志文件时间索引的文件格式, 索引文件名为日志文件名加上后缀, 由头部和连续的索引项组成
+#define LOG_INDEX_SUFFIX  ".idx"
+#define LOG_INDEX_MAGIC   0x58494c45    // "ELIX"
+#define LOG_INDEX_VERSION 1
+
+struct LogIndexHeader {
+    uint32_t magic;      // 文件标识
+    uint32_t version;    // 文件格式版本
+};
+
+// 索引项, 描述日志文件中按行对齐的一块连续日志
+struct LogIndexEntry {
+    uint64_t first_us;         // 第一行日志的输出时间, 单位us
+    uint64_t offset;           // 在日志文件中的偏移
+    uint64_t length;           // 长度
+    uint32_t severity_mask;    // 包含的日志等级
+    uint32_t __pad;            // 保留字段
+};
+
+// 记录一次日志文件写入, 更新时间索引, 返回写入序号, 调用者需要持有日志锁
+uint64_t NoteLogFileWrite(const struct timeval &tv, uint32_t severity_mask, size_t length);
+
+// 获取最近一次日志文件写入的序号
+uint64_t GetLogFileWriteSeq();
+
+// 记录目前为止的写入都已经到达日志文件, 调用者需要持有日志锁并且已经等待缓冲的写入完成
+void NoteLogFileCompleted();
+
+// 等待写入序号seq之前的日志文件内容落盘, 并发的等待者共享一次fdatasync
+void WaitLogFileSynced(uint64_t seq);
+
+// 获取日志文件fdatasync的调用次数
+uint64_t GetLogFileSyncCount();
+
+// 日志文件是否使用二进制格式, 异步信号安全
+bool IsLogFileBinary();
+
+// 二进制日志文件格式. 文件由连续的块组成, 每个块以块头部开始, 块内的调用点和线程字典只在
+// 本块内有效, 所以每个块都可以独立解码. 整数使用LEB128变长编码, 有符号数先做zigzag变换,
+// 字符串为长度加内容, 块头部使用本机字节序.
+#define LOG_BINARY_MAGIC      "\x89" "ELGBLK\n"
+#define LOG_BINARY_VERSION    1
+#define LOG_BINARY_BLOCK_SIZE (64 * 1024)
+
+struct LogBinaryBlockHeader {
+    char     magic[8];    // 同步标记, 解码时用于定位块的起始位置
+    uint64_t first_us;    // 块内时间差的基准, 单位us
+    uint32_t version;     // 文件格式版本
+    uint32_t check;       // 头部校验值, 用于排除日志内容中的同步标记
+};
+
+// 块内的记录类型, 和同步标记的第一个字节不同
+#define LOG_BINARY_CALLSITE 'C'    // 调用点: id, 等级, 行号, 文件名, 函数名
+#define LOG_BINARY_THREAD   'T'    // 线程: id, 进程ID, 线程ID, 线程名, 程序名
+#define LOG_BINARY_RECORD   'R'    // 日志: 调用点id, 线程id, 时间差, 日志内容
+#define LOG_BINARY_TEXT     'X'    // 文本行: 日志等级掩码, 是否带有时间戳, 时间差, 整行文本
+
+// 计算块头部的校验值
+uint32_t LogBinaryBlockCheck(const LogBinaryBlockHeader &header);
+
+// 查找下一个有效的块头部, 没有时返回size
+uint64_t FindLogBinaryBlock(const uint8_t *data, uint64_t size, uint64_t pos);
+
+// 写入二进制日志文件的一行日志, file为空时保存整行文本(没有调用点信息的日志)
+struct LogBinaryLine {
+    const char    *file;             // 调用点文件名
+    const char    *func;             // 调用点函数名
+    int32_t        line;             // 调用点行号
+    LogSeverity    severity;         // 日志等级
+    int32_t        tid;              // 生成日志的线程ID
+    uint32_t       severity_mask;    // 整行文本包含的日志等级
+    const char    *text;             // 日志内容或者整行文本, 不包含尾部换行符
+    size_t         length;           // 文本长度
+    struct timeval tv;               // 输出时间
+    uint32_t       timestamp;        // 整行文本解码时是否加上时间戳
+    uint32_t       __pad;            // 保留字段
+};
+
+// 登记线程名字, 二进制日志文件的线程字典使用, 调用者需要持有日志锁
+void RegisterLogThreadLocked(int32_t tid, const char *name);
+
+// 重新开始二进制日志文件, 下一行日志写入新的块, 调用者需要持有日志锁
+void ResetLogBinaryWriter();
+
+// 编码一行日志, 需要时先写入块头部和字典, 返回的缓冲区在下次调用前有效,
+// 调用者需要持有日志锁
+const std::string &EncodeLogBinaryLineLocked(const LogBinaryLine &line);
+
+// 获取当前进程ID/线程ID/程序名字, 进程ID和线程ID使用缓存
+pid_t       GetLogProcessId();
+pid_t       GetLogThreadId();
+const char *GetLogProgramName();
+
+// 需要转义的字节类型, 用于FindLogEscape()
+#define LOG_ESCAPE_CONTROL (1u << 0)    // 控制字符和DEL
+#define LOG_ESCAPE_QUOTE   (1u << 1)    // 双引号和反斜杠
+#define LOG_ESCAPE_HIGH    (1u << 2)    // 非ASCII字节, 用于UTF-8校验
+#define LOG_ESCAPE_TAB     (1u << 3)    // 和LOG_ESCAPE_CONTROL一起使用时不包括制表符
+
+// 查找需要转义的字节的实现
+#define LOG_ESCAPE_KERNEL_SCALAR 0
+#define LOG_ESCAPE_KERNEL_SSE2   1
+#define LOG_ESCAPE_KERNEL_AVX2   2
+
+// 获取当前CPU支持的最快实现
+uint32_t GetLogEscapeKernel();
+
+// 使用指定的实现查找第一个需要转义的字节, 没有时返回length
+size_t FindLogEscape(const char *data, size_t length, uint32_t flags, uint32_t kernel);
+
+// 合法UTF-8字符的字节数, 不是合法的UTF-8字符时返回0
+size_t LogUtf8SequenceLength(const char *data, size_t length);
+
+// 转义text中[start, end)范围内的换行符和控制字符, 见SetLogSanitize(), 不需要转义时不修改
+void SanitizeLogText(std::string &text, size_t start, size_t end, uint32_t flags);
+
+// 追加JSON字符串内容, 不包括两边的引号
+void AppendLogJsonEscaped(std::string &output, const char *data, size_t length);
+
+// 追加当前线程的日志上下文, 见ScopedLogContext
+void AppendLogContext(LogStream &stream);
+
+// 追加当前线程在调用点的日志前缀, |tickcount|只在开启log_tickcount时使用
+void AppendLogPrefix(LogStream &stream, const LoggingSettings &log_settings,
+    LogSeverity severity, const char *file, const char *func, int line, uint64_t tickcount);
+
+// 异步信号安全的格式化函数, 支持printf格式的子集, 见RawLog()
+size_t RawLogFormat(char *data, size_t size, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// 分配日志记录内存, 超过内存上限时返回nullptr
+void *LogSlabAlloc(size_t size);
+
+// 释放日志记录内存, 可以在任意线程调用
+void LogSlabFree(void *ptr);
+
+// 归还当前线程攒下的跨线程释放的内存块
+void LogSlabFlushFrees();
+
+// 初始化日志队列和fork处理函数, 重复调用时不会重新初始化
+void InitLoggingQueue();
+
+// fork之后在子进程中清除缓存的进程ID和线程ID
+void ResetLogProcessIds();
+
+// 日志写入当前进程的共享内存环形队列, 没有使用共享内存或者写入失败时返回false
+bool LogShmEnqueue(LogSeverity severity, const struct timeval &tv, const char *text,
+    uint32_t length);
+
+// fork之后在子进程中重置共享内存状态
+void ResetLogSharedMemoryAfterFork();
+
+// 获取收集线程丢弃的长度或者等级不合法的共享内存日志数量
+uint64_t GetLogShmCorruptCount();
+
+// 获取日志锁, 并且输出当前进程队列中的日志
+std::unique_lock< std::mutex > LockLogOutput();
+
+// 尝试获取日志锁, 获取失败时返回的锁不持有日志锁, 不输出队列中的日志
+std::unique_lock< std::mutex > TryLockLogOutput();
+
+// 输出一条其他进程收集的日志, 调用者需要通过LockLogOutput()持有日志锁
+void WriteCollectedLogRecordLocked(LogSeverity severity, const struct timeval &tv,
+    const char *text, size_t length);
+
+// 按照最小日志等级计算允许构造日志的最低等级, 包括backtrace和实时订阅的影响
+int32_t GetLogCreateLevel(int32_t min_level);
+
+// 根据当前配置重新计算LOG_IS_ON和所有命名日志对象允许构造日志的最低等级
+void UpdateLogCreateLevel();
+
+// 重新解析所有命名日志对象的日志等级
+void UpdateLoggerLevels();
+
+// fork之后在子进程中重新初始化命名日志对象的注册表锁
+void ResetLoggerRegistryAfterFork();
+
+// 有实时订阅者时为真, 没有订阅者时日志热路径只多读取这个标记
+extern std::atomic< bool > g_log_tail_active;
+
+static inline bool IsLogTailActive()
+{
+    return g_log_tail_active.load(std::memory_order_relaxed);
+}
+
+// 订阅者要求的最低日志等级, 没有订阅者时返回LOGGING_NUM_SEVERITIES
+LogSeverity GetLogTailMinSeverity();
+
+// 订阅者对文件要求的详细日志等级, 没有要求时返回INT32_MIN
+int32_t GetLogTailVlogLevel(const char *file);
+
+// 发送一行日志给过滤条件匹配的订阅者, |file|不包含路径, |text|包含前缀和尾部换行符
+void LogTailPublish(LogSeverity severity, const char *file, const char *func,
+    const std::string &text);
+
+// fork之后在子进程中放弃继承的订阅者
+void ResetLogTailAfterFork();
+
+// 崩溃时尽力输出日志管道中缓存的内容, 只使用try_lock和异步信号安全的调用
+void LogEmergencyFlush();
+
+#if defined(EASELOG_TEST_HOOKS)
+// 测试注入等待的位置: 生产者入队之前, 持有日志锁输出每条日志之前, 组提交fdatasync之前,
+// 持有vlog锁解析VLOG调用点时
+enum : uint32_t {
+    LOG_TEST_POINT_ENQUEUE = 0,
+    LOG_TEST_POINT_WRITE   = 1,
+    LOG_TEST_POINT_SYNC    = 2,
+    LOG_TEST_POINT_VLOG    = 3,
+};
+
+// 设置测试注入的等待函数, 用于构造并发时序. 只在定义EASELOG_TEST_HOOKS的测试程序中编译,
+// 发布的日志库不包含注入点
+void SetLogTestDelay(void (*delay)(uint32_t point));
+
+// 执行测试注入的等待函数
+void RunLogTestDelay(uint32_t point);
+#define LogTestDelay(point) RunLogTestDelay(point)
+
+// 设置解码压缩文件时每次解压的内容大小, 用于测试按窗口解码
+void SetLogDecodeInflateBytes(uint64_t bytes);
+#else
+#define LogTestDelay(point) ((void)0)
+#endif    // EASELOG_TEST_HOOKS
 
 }    // namespace logging
 
@@ -0,0 +1,489 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_raw.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 11:20
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  实现异步信号安全的RAW_LOG紧急日志路径, 以及崩溃信号处理函数.
+ *
+ *  这里的代码可能运行在信号处理函数中, 或者堆已经损坏的情况下, 所以:
+ *  (1) 不分配内存, 不使用stdio/iostream, 不持有任何锁;
+ *  (2) 只调用异步信号安全的系统调用(write, getpid, clock_gettime等);
+ *  (3) 日志格式化到栈上的缓冲区, 每个输出目的地只调用一次write().
+ *
+ */
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace logging {
+
+// RAW_LOG单条日志的最大长度, 超出部分被截断
+#define RAW_LOG_BUFFER_SIZE 2048
+
+// 崩溃时输出的最大调用栈深度
+#define RAW_LOG_MAX_FRAMES 64
+
+// 格式化输出缓冲区, 总是为尾部换行符预留一个字节
+struct RawBuffer {
+    char  *data;
+    size_t size;
+    size_t length;
+};
+
+static inline void RawAppendChar(RawBuffer &buffer, char c)
+{
+    if (buffer.length + 1 < buffer.size) {
+        buffer.data[buffer.length++] = c;
+    }
+}
+
+static void RawAppendString(RawBuffer &buffer, const char *str, size_t max_length)
+{
+    if (str == nullptr) {
+        str = "(null)";
+    }
+    for (size_t i = 0; i < max_length && str[i] != '\0'; i++) {
+        RawAppendChar(buffer, str[i]);
+    }
+}
+
+// 按照指定进制输出无符号整数, width为最小宽度, 不足时使用pad填充
+static void RawAppendUnsigned(RawBuffer &buffer, uint64_t value, uint32_t base, bool upper,
+    uint32_t width, char pad, bool left_align)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char        temp[24];
+    uint32_t    count = 0;
+
+    do {
+        temp[count++] = digits[value % base];
+        value /= base;
+    } while (value != 0);
+
+    for (uint32_t i = count; !left_align && i < width; i++) {
+        RawAppendChar(buffer, pad);
+    }
+    for (uint32_t i = count; i > 0; i--) {
+        RawAppendChar(buffer, temp[i - 1]);
+    }
+    for (uint32_t i = count; left_align && i < width; i++) {
+        RawAppendChar(buffer, ' ');
+    }
+}
+
+static void RawAppendSigned(RawBuffer &buffer, int64_t value, uint32_t width, char pad,
+    bool left_align)
+{
+    uint64_t magnitude = static_cast< uint64_t >(value);
+    uint32_t digits    = 1;
+
+    if (value >= 0) {
+        RawAppendUnsigned(buffer, magnitude, 10, false, width, pad, left_align);
+        return;
+    }
+
+    // 负数: 空格填充在符号之前, 零填充在符号之后
+    magnitude = ~magnitude + 1;
+    for (uint64_t rest = magnitude / 10; rest != 0; rest /= 10) {
+        digits++;
+    }
+    for (uint32_t i = digits + 1; pad == ' ' && !left_align && i < width; i++) {
+        RawAppendChar(buffer, ' ');
+    }
+    RawAppendChar(buffer, '-');
+    width = width > digits + 1 ? width - 1 : 0;
+    RawAppendUnsigned(buffer, magnitude, 10, false, pad == '0' || left_align ? width : 0, pad,
+        left_align);
+}
+
+// 异步信号安全的格式化函数, 支持printf格式的子集:
+//   标志: '-', '0'; 宽度; 精度(仅用于%s); 长度: hh, h, l, ll, z, j, t;
+//   转换: %d %i %u %x %X %o %c %s %p %%.
+// 不支持的转换原样输出, 这样至少可以看到格式字符串.
+static void RawFormatV(RawBuffer &buffer, const char *format, va_list args)
+{
+    for (const char *p = format; *p != '\0'; p++) {
+        if (*p != '%') {
+            RawAppendChar(buffer, *p);
+            continue;
+        }
+
+        const char *spec       = p++;
+        bool        left_align = false;
+        char        pad        = ' ';
+        uint32_t    width      = 0;
+        size_t      precision  = static_cast< size_t >(-1);
+        uint32_t    long_count = 0;
+        bool        size_type  = false;
+
+        for (; *p == '-' || *p == '0'; p++) {
+            if (*p == '-') {
+                left_align = true;
+            } else {
+                pad = '0';
+            }
+        }
+        for (; *p >= '0' && *p <= '9'; p++) {
+            width = width * 10 + static_cast< uint32_t >(*p - '0');
+        }
+        if (*p == '.') {
+            precision = 0;
+            for (p++; *p >= '0' && *p <= '9'; p++) {
+                precision = precision * 10 + static_cast< size_t >(*p - '0');
+            }
+        }
+        for (;; p++) {
+            if (*p == 'l') {
+                long_count++;
+            } else if (*p == 'z' || *p == 'j' || *p == 't') {
+                size_type = true;
+            } else if (*p != 'h') {
+                break;
+            }
+        }
+
+        switch (*p) {
+        case 'd':
+        case 'i': {
+            int64_t value;
+            if (size_type || long_count >= 2) {
+                value = va_arg(args, long long);
+            } else if (long_count == 1) {
+                value = va_arg(args, long);
+            } else {
+                value = va_arg(args, int);
+            }
+            RawAppendSigned(buffer, value, width, pad, left_align);
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o': {
+            uint64_t value;
+            if (size_type || long_count >= 2) {
+                value = va_arg(args, unsigned long long);
+            } else if (long_count == 1) {
+                value = va_arg(args, unsigned long);
+            } else {
+                value = va_arg(args, unsigned int);
+            }
+            uint32_t base = *p == 'u' ? 10 : (*p == 'o' ? 8 : 16);
+            RawAppendUnsigned(buffer, value, base, *p == 'X', width, pad, left_align);
+            break;
+        }
+        case 'p':
+            RawAppendString(buffer, "0x", 2);
+            RawAppendUnsigned(buffer, reinterpret_cast< uintptr_t >(va_arg(args, void *)), 16,
+                false, 0, '0', false);
+            break;
+        case 'c':
+            RawAppendChar(buffer, static_cast< char >(va_arg(args, int)));
+            break;
+        case 's':
+            RawAppendString(buffer, va_arg(args, const char *), precision);
+            break;
+        case '%':
+            RawAppendChar(buffer, '%');
+            break;
+        case '\0':
+            // 格式字符串以'%'结尾, 原样输出后结束
+            RawAppendString(buffer, spec, static_cast< size_t >(p - spec));
+            return;
+        default:
+            RawAppendString(buffer, spec, static_cast< size_t >(p - spec) + 1);
+            break;
+        }
+    }
+}
+
+// export: 格式化到指定缓冲区, 返回格式化后的长度(不包括结尾的'\0'), 异步信号安全
+size_t RawLogFormat(char *data, size_t size, const char *format, ...)
+{
+    RawBuffer buffer = {data, size, 0};
+    va_list   args;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    va_start(args, format);
+    RawFormatV(buffer, format, args);
+    va_end(args);
+
+    data[buffer.length] = '\0';
+    return buffer.length;
+}
+
+// 输出UTC时间戳, 例如"2024-10-18T10:11:12.123456Z ".
+// localtime_r()会读取时区文件, 不是异步信号安全的, 这里手动计算UTC日期.
+static void RawAppendTimestamp(RawBuffer &buffer)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        return;
+    }
+
+    // civil_from_days算法, 由1970-01-01以来的天数计算公历日期
+    int64_t  days = static_cast< int64_t >(ts.tv_sec) / 86400;
+    uint64_t secs = static_cast< uint64_t >(ts.tv_sec) % 86400;
+    days += 719468;
+    int64_t  era   = (days >= 0 ? days : days - 146096) / 146097;
+    uint64_t doe   = static_cast< uint64_t >(days - era * 146097);
+    uint64_t yoe   = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint64_t doy   = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint64_t mp    = (5 * doy + 2) / 153;
+    uint64_t day   = doy - (153 * mp + 2) / 5 + 1;
+    uint64_t month = mp < 10 ? mp + 3 : mp - 9;
+    int64_t  year  = static_cast< int64_t >(yoe) + era * 400 + (month <= 2 ? 1 : 0);
+
+    RawAppendSigned(buffer, year, 4, '0', false);
+    RawAppendChar(buffer, '-');
+    RawAppendUnsigned(buffer, month, 10, false, 2, '0', false);
+    RawAppendChar(buffer, '-');
+    RawAppendUnsigned(buffer, day, 10, false, 2, '0', false);
+    RawAppendChar(buffer, 'T');
+    RawAppendUnsigned(buffer, secs / 3600, 10, false, 2, '0', false);
+    RawAppendChar(buffer, ':');
+    RawAppendUnsigned(buffer, secs / 60 % 60, 10, false, 2, '0', false);
+    RawAppendChar(buffer, ':');
+    RawAppendUnsigned(buffer, secs % 60, 10, false, 2, '0', false);
+    RawAppendChar(buffer, '.');
+    RawAppendUnsigned(buffer, static_cast< uint64_t >(ts.tv_nsec) / 1000, 10, false, 6, '0',
+        false);
+    RawAppendString(buffer, "Z ", 2);
+}
+
+// 原始日志写入的日志文件描述符, 二进制格式和压缩的日志文件不写入文本
+static int RawLogFileFd()
+{
+    if (IsLogFileBinary() || IsLogFileUringActive() || IsLogFileCompressed()) {
+        return -1;
+    }
+    return GetLogFileFd();
+}
+
+// 写入所有输出目的地, 每个目的地一次write(), 只在被信号中断或者部分写入时重试
+static void RawWriteAll(const char *data, size_t length)
+{
+    int fds[2] = {STDERR_FILENO, RawLogFileFd()};
+
+    for (int fd : fds) {
+        size_t written = 0;
+        while (fd >= 0 && written < length) {
+            ssize_t ret = write(fd, data + written, length - written);
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ret <= 0) {
+                break;
+            }
+            written += static_cast< size_t >(ret);
+        }
+    }
+}
+
+// 格式化并且输出一条RAW日志, 格式类似于基础日志风格:
+// 2024-10-18T10:11:12.123456Z <error> program[pid]: [(tid) - file(line)] RAW: message
+static void RawLogV(LogSeverity severity, const char *file, int line, const char *format,
+    va_list args)
+{
+    ScopedClearLastError   scoped_clear_last_error;
+    const LoggingSettings &settings = GetLoggingSettings();
+    char                   data[RAW_LOG_BUFFER_SIZE];
+    RawBuffer              buffer = {data, sizeof(data), 0};
+    const char            *base   = strrchr(file, '/');
+
+    if (settings.log_timestamp) {
+        RawAppendTimestamp(buffer);
+    }
+    RawAppendChar(buffer, '<');
+    if (severity >= 0 && severity < LOGGING_NUM_SEVERITIES) {
+        RawAppendString(buffer, settings.log_severity_names[severity], RAW_LOG_BUFFER_SIZE);
+    } else {
+        RawAppendString(buffer, "VERBOSE", 7);
+    }
+    RawAppendString(buffer, "> ", 2);
+    RawAppendString(buffer, program_invocation_short_name, RAW_LOG_BUFFER_SIZE);
+    RawAppendChar(buffer, '[');
+    RawAppendUnsigned(buffer, static_cast< uint64_t >(getpid()), 10, false, 0, ' ', false);
+    RawAppendString(buffer, "]: [(", 5);
+    RawAppendUnsigned(buffer, static_cast< uint64_t >(syscall(__NR_gettid)), 10, false, 0, ' ',
+        false);
+    RawAppendString(buffer, ") - ", 4);
+    RawAppendString(buffer, base ? base + 1 : file, RAW_LOG_BUFFER_SIZE);
+    RawAppendChar(buffer, '(');
+    RawAppendSigned(buffer, line, 0, ' ', false);
+    RawAppendString(buffer, ")] RAW: ", 8);
+    RawFormatV(buffer, format, args);
+
+    // 缓冲区总是为换行符预留了一个字节
+    buffer.data[buffer.length++] = '\n';
+    RawWriteAll(buffer.data, buffer.length);
+}
+
+// 内部使用的RAW日志输出, 不会因为FATAL等级退出进程
+static void RawLogNoExit(LogSeverity severity, const char *file, int line, const char *format,
+    ...) __attribute__((format(printf, 4, 5)));
+
+static void RawLogNoExit(LogSeverity severity, const char *file, int line, const char *format,
+    ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    RawLogV(severity, file, line, format, args);
+    va_end(args);
+}
+
+// export: 异步信号安全的日志输出, 可以在信号处理函数中使用
+void RawLog(LogSeverity severity, const char *file, int line, const char *format, ...)
+{
+    va_list args;
+
+    if (severity < GetLoggingSettings().log_min_level && severity < LOGGING_FATAL) {
+        return;
+    }
+
+    va_start(args, format);
+    RawLogV(severity, file, line, format, args);
+    va_end(args);
+
+    if (severity >= LOGGING_FATAL) {
+        abort();
+    }
+}
+
+// 需要处理的崩溃信号
+static const struct {
+    int         number;
+    uint32_t    __pad;
+    const char *name;
+} kFailureSignals[] = {
+    {SIGSEGV, 0, "SIGSEGV"},
+    {SIGILL,  0, "SIGILL" },
+    {SIGFPE,  0, "SIGFPE" },
+    {SIGABRT, 0, "SIGABRT"},
+    {SIGBUS,  0, "SIGBUS" },
+    {SIGTERM, 0, "SIGTERM"},
+};
+
+// 正在处理崩溃信号的线程ID, 0表示没有线程在处理
+static std::atomic< long > g_crash_thread(0);
+
+// 恢复默认信号处理函数, 再次发送信号, 使进程按照默认方式结束(例如生成coredump)
+static void ResetSignalAndRaise(int signal_number)
+{
+    struct sigaction sig_action;
+
+    memset(&sig_action, 0, sizeof(sig_action));
+    sigemptyset(&sig_action.sa_mask);
+    sig_action.sa_handler = SIG_DFL;
+    sigaction(signal_number, &sig_action, nullptr);
+    raise(signal_number);
+}
+
+// 崩溃信号处理函数, 输出信号信息和调用栈, 并且尽力输出缓存中的日志
+static void FailureSignalHandler(int signal_number, siginfo_t *signal_info, void *ucontext)
+{
+    long current  = syscall(__NR_gettid);
+    long expected = 0;
+
+    if (!g_crash_thread.compare_exchange_strong(expected, current)) {
+        // 同一个线程再次崩溃, 说明崩溃处理本身出错, 直接按默认方式结束
+        if (expected == current) {
+            ResetSignalAndRaise(signal_number);
+            return;
+        }
+        // 其他线程正在处理崩溃, 等待其结束进程, 避免输出交错
+        for (;;) {
+            sleep(1);
+        }
+    }
+
+    const char *name = "unknown signal";
+    for (const auto &entry : kFailureSignals) {
+        if (entry.number == signal_number) {
+            name = entry.name;
+        }
+    }
+
+    RawLogNoExit(LOGGING_FATAL, __FILE__, __LINE__,
+        "*** %s (@%p) received by PID %d (TID %ld); stack trace: ***", name,
+        signal_info ? signal_info->si_addr : nullptr, static_cast< int >(getpid()), current);
+
+    // backtrace()在安装信号处理函数时已经预先调用过, 这里不会再加载libgcc_s.
+    // backtrace_symbols_fd()直接写入文件描述符, 不会分配内存, 只能解析动态符号表.
+    void *frames[RAW_LOG_MAX_FRAMES];
+    int   depth  = backtrace(frames, RAW_LOG_MAX_FRAMES);
+    int   fds[2] = {STDERR_FILENO, RawLogFileFd()};
+    for (int fd : fds) {
+        if (fd >= 0) {
+            backtrace_symbols_fd(frames, depth, fd);
+        }
+    }
+
+    LogEmergencyFlush();
+    ResetSignalAndRaise(signal_number);
+}
+
+// export: 安装崩溃信号处理函数
+bool InstallFailureSignalHandler()
+{
+    static void *g_alt_stack = nullptr;
+    void        *frames[1];
+
+    // 预先调用一次backtrace(), 完成libgcc_s的加载, 信号处理函数中就不会再分配内存
+    backtrace(frames, 1);
+
+    // 使用备用信号栈, 栈溢出导致的SIGSEGV也可以正常处理
+    if (g_alt_stack == nullptr) {
+        stack_t alt_stack;
+        size_t  alt_size = static_cast< size_t >(SIGSTKSZ) + 64 * 1024;
+        g_alt_stack      = malloc(alt_size);
+        if (g_alt_stack != nullptr) {
+            alt_stack.ss_sp    = g_alt_stack;
+            alt_stack.ss_size  = alt_size;
+            alt_stack.ss_flags = 0;
+            sigaltstack(&alt_stack, nullptr);
+        }
+    }
+
+    struct sigaction sig_action;
+    memset(&sig_action, 0, sizeof(sig_action));
+    sigemptyset(&sig_action.sa_mask);
+    sig_action.sa_flags     = SA_SIGINFO | SA_ONSTACK;
+    sig_action.sa_sigaction = FailureSignalHandler;
+
+    for (const auto &entry : kFailureSignals) {
+        if (sigaction(entry.number, &sig_action, nullptr) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}    // namespace logging
@@ -0,0 +1,190 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_ringqueue.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 15:10
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  有界多生产者多消费者环形队列实现.
+ *
+ */
+
+#include "log/easelog_ringqueue.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+namespace logging {
+
+// 在调用者提供的内存上初始化队列, 内存需要按照缓存行对齐, 大小为RINGQUEUE_MEMSIZE,
+// entries_sz必须是2的幂.
+struct ringqueue *ringqueue_init(void *mem, uint32_t entries_sz, uint32_t data_sz)
+{
+    static_assert(sizeof(struct ringqueue) == 3 * RINGQUEUE_CACHELINE_SIZE,
+        "ringqueue size error");
+    static_assert(sizeof(struct ringqueue_slot) == 16, "ringqueue_slot size error");
+
+    if (entries_sz == 0 || (entries_sz & (entries_sz - 1)) != 0) {
+        return nullptr;
+    }
+
+    struct ringqueue *q = new (mem) ringqueue;
+    std::atomic_init(&(q->head), static_cast< uint64_t >(0));
+    std::atomic_init(&(q->tail), static_cast< uint64_t >(0));
+    q->entries_sz = entries_sz;
+    q->mask       = entries_sz - 1;
+    q->slot_size  = static_cast< uint32_t >(RINGQUEUE_SLOT_SIZE(data_sz));
+    q->data_size  = q->slot_size - static_cast< uint32_t >(sizeof(struct ringqueue_slot));
+
+    for (uint32_t i = 0; i < entries_sz; i++) {
+        struct ringqueue_slot *slot = ringqueue_slot_at(q, i);
+        new (&(slot->seq)) std::atomic< uint64_t >(i);
+        slot->len = 0;
+    }
+    return q;
+}
+
+// 批量占用从head开始的连续槽位, 槽位序号等于位置时表示本轮空闲.
+// 先确认连续可用的槽位数量, 再用一次CAS移动head, 返回占用数量, 队列满时返回0.
+static uint32_t ringqueue_claim(std::atomic< uint64_t > *cursor, struct ringqueue *q, uint32_t n,
+    uint64_t offset, uint64_t *pos)
+{
+    uint64_t cur = cursor->load(std::memory_order_relaxed);
+
+    for (;;) {
+        uint64_t seq  = ringqueue_slot_at(q, cur)->seq.load(std::memory_order_acquire);
+        int64_t  diff = static_cast< int64_t >(seq - (cur + offset));
+        if (diff < 0) {
+            // 槽位还没有被上一轮释放(满), 或者还没有发布数据(空)
+            return 0;
+        }
+        if (diff > 0) {
+            // 其他线程已经移动了位置, 重新读取
+            cur = cursor->load(std::memory_order_relaxed);
+            continue;
+        }
+
+        uint32_t count = 1;
+        while (count < n &&
+            ringqueue_slot_at(q, cur + count)->seq.load(std::memory_order_acquire) ==
+                cur + count + offset) {
+            count++;
+        }
+        // CAS失败时cur被更新为最新位置
+        if (cursor->compare_exchange_weak(cur, cur + count, std::memory_order_relaxed)) {
+            *pos = cur;
+            return count;
+        }
+    }
+}
+
+// 生产者占用最多n个连续槽位, 填充数据后需要逐个调用ringqueue_publish
+uint32_t ringqueue_reserve(struct ringqueue *q, uint32_t n, uint64_t *pos)
+{
+    return ringqueue_claim(&(q->head), q, n, 0, pos);
+}
+
+// 发布槽位数据, 消费者可以读取
+void ringqueue_publish(struct ringqueue *q, uint64_t pos)
+{
+    ringqueue_slot_at(q, pos)->seq.store(pos + 1, std::memory_order_release);
+}
+
+// 消费者占用最多n个连续的已发布槽位, 处理完成后需要逐个调用ringqueue_release
+uint32_t ringqueue_acquire(struct ringqueue *q, uint32_t n, uint64_t *pos)
+{
+    return ringqueue_claim(&(q->tail), q, n, 1, pos);
+}
+
+// 释放槽位, 下一轮生产者可以复用
+void ringqueue_release(struct ringqueue *q, uint64_t pos)
+{
+    ringqueue_slot_at(q, pos)->seq.store(pos + q->entries_sz, std::memory_order_release);
+}
+
+// 单消费者查看下一个已发布的槽位, 不出队, 队列空时返回nullptr.
+// 处理完成后仍然需要调用ringqueue_acquire和ringqueue_release出队.
+struct ringqueue_slot *ringqueue_peek(struct ringqueue *q, uint64_t *pos)
+{
+    uint64_t               tail = q->tail.load(std::memory_order_relaxed);
+    struct ringqueue_slot *slot = ringqueue_slot_at(q, tail);
+
+    if (slot->seq.load(std::memory_order_acquire) != tail + 1) {
+        return nullptr;
+    }
+    *pos = tail;
+    return slot;
+}
+
+// 复制一条数据入队, 数据超过槽位大小或者队列满时返回false
+bool ringqueue_enqueue(struct ringqueue *q, const void *data, uint32_t len)
+{
+    uint64_t pos;
+
+    if (len > q->data_size || ringqueue_reserve(q, 1, &pos) == 0) {
+        return false;
+    }
+
+    struct ringqueue_slot *slot = ringqueue_slot_at(q, pos);
+    memcpy(ringqueue_slot_data(slot), data, len);
+    slot->len = len;
+    ringqueue_publish(q, pos);
+    return true;
+}
+
+// 批量复制入队, 一次占用多个槽位, 返回入队数量. 超过槽位大小的数据及其之后的数据不入队.
+uint32_t ringqueue_enqueue_burst(struct ringqueue *q, const void *const *data,
+    const uint32_t *len, uint32_t n)
+{
+    uint32_t fit = 0;
+    uint64_t pos;
+
+    while (fit < n && len[fit] <= q->data_size) {
+        fit++;
+    }
+    if (fit == 0) {
+        return 0;
+    }
+
+    uint32_t count = ringqueue_reserve(q, fit, &pos);
+    for (uint32_t i = 0; i < count; i++) {
+        struct ringqueue_slot *slot = ringqueue_slot_at(q, pos + i);
+        memcpy(ringqueue_slot_data(slot), data[i], len[i]);
+        slot->len = len[i];
+        ringqueue_publish(q, pos + i);
+    }
+    return count;
+}
+
+// 复制一条数据出队, 缓冲区不足时截断, len返回数据原始长度, 队列空时返回false
+bool ringqueue_dequeue(struct ringqueue *q, void *data, uint32_t size, uint32_t *len)
+{
+    uint64_t pos;
+
+    if (ringqueue_acquire(q, 1, &pos) == 0) {
+        return false;
+    }
+
+    struct ringqueue_slot *slot = ringqueue_slot_at(q, pos);
+    *len                        = slot->len;
+    memcpy(data, ringqueue_slot_data(slot), std::min(size, slot->len));
+    ringqueue_release(q, pos);
+    return true;
+}
+
+// 队列中的元素个数, 包括已经占用还没有发布或者释放的槽位, 并发时只是近似值
+uint32_t ringqueue_count(const struct ringqueue *q)
+{
+    uint64_t tail = q->tail.load(std::memory_order_relaxed);
+    uint64_t head = q->head.load(std::memory_order_relaxed);
+
+    return head > tail ? static_cast< uint32_t >(head - tail) : 0;
+}
+
+}    // namespace logging
@@ -0,0 +1,123 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_ringqueue.h
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 15:10
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  有界多生产者多消费者环形队列, 每个槽位带序号(Vyukov算法), 数据结构和函数声明.
+ *
+ */
+
+#ifndef EASELOG_RINGQUEUE_H
+#define EASELOG_RINGQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace logging {
+
+// Bounded multi-producer multi-consumer ring queue.
+//
+// Every slot carries a sequence number. A slot at position pos is free for the
+// producer of that lap when seq == pos, and holds data for the consumer when
+// seq == pos + 1. Producers only contend on head and consumers only on tail,
+// both are on their own cache line, and a full or empty queue is detected
+// from the slot sequence without a shared counter.
+//
+// Payloads are stored inline in fixed-size slots, the queue header and slots
+// live in one caller provided memory block without any pointer, so the same
+// block can be placed in shared memory.
+//
+//  uint64_t pos;
+//  alignas(RINGQUEUE_CACHELINE_SIZE) uint8_t mem[RINGQUEUE_MEMSIZE(512, 240)];
+//  struct ringqueue *q = ringqueue_init(mem, 512, 240);
+//
+//  * Zero-copy enqueue of up to 16 records. *
+//  uint32_t count = ringqueue_reserve(q, 16, &pos);
+//  for (i = 0; i != count; ++i) {
+//      struct ringqueue_slot *slot = ringqueue_slot_at(q, pos + i);
+//      slot->len = fill(ringqueue_slot_data(slot));
+//      ringqueue_publish(q, pos + i);
+//  }
+//
+//  * Zero-copy dequeue, slots are reusable after release. *
+//  count = ringqueue_acquire(q, 16, &pos);
+//  for (i = 0; i != count; ++i) {
+//      struct ringqueue_slot *slot = ringqueue_slot_at(q, pos + i);
+//      process(ringqueue_slot_data(slot), slot->len);
+//      ringqueue_release(q, pos + i);
+//  }
+
+#define RINGQUEUE_CACHELINE_SIZE 64
+
+// 槽位大小, 头部和数据区向上对齐到缓存行, 相邻槽位不会伪共享
+#define RINGQUEUE_SLOT_SIZE(data_sz)                                                          \
+    ((sizeof(struct ringqueue_slot) + (data_sz) + RINGQUEUE_CACHELINE_SIZE - 1) & \
+        ~static_cast< size_t >(RINGQUEUE_CACHELINE_SIZE - 1))
+
+// 队列占用的内存大小, 包括队列头部和所有槽位
+#define RINGQUEUE_MEMSIZE(entries_sz, data_sz) \
+    (sizeof(struct ringqueue) + static_cast< size_t >(entries_sz) * RINGQUEUE_SLOT_SIZE(data_sz))
+
+// 队列槽位头部, 数据区紧跟在头部之后
+struct ringqueue_slot {
+    std::atomic< uint64_t > seq;      // 槽位序号
+    uint32_t                len;      // 数据长度
+    uint32_t                __pad;    // 保留字段
+};
+
+// 队列头部, 生产者位置, 消费者位置和只读配置分别独占一个缓存行
+struct alignas(RINGQUEUE_CACHELINE_SIZE) ringqueue {
+    std::atomic< uint64_t > head;    // 下一个入队位置
+    uint8_t                 __pad0[RINGQUEUE_CACHELINE_SIZE - sizeof(std::atomic< uint64_t >)];
+    std::atomic< uint64_t > tail;    // 下一个出队位置
+    uint8_t                 __pad1[RINGQUEUE_CACHELINE_SIZE - sizeof(std::atomic< uint64_t >)];
+    uint32_t                entries_sz;    // 槽位个数, 2的幂
+    uint32_t                mask;          // 槽位索引掩码
+    uint32_t                slot_size;     // 槽位大小
+    uint32_t                data_size;     // 槽位数据区大小
+    uint8_t                 __pad2[RINGQUEUE_CACHELINE_SIZE - 4 * sizeof(uint32_t)];
+};
+
+// 获取位置对应的槽位
+static inline struct ringqueue_slot *ringqueue_slot_at(struct ringqueue *q, uint64_t pos)
+{
+    uint8_t *slots = reinterpret_cast< uint8_t * >(q + 1);
+    return reinterpret_cast< struct ringqueue_slot * >(slots + (pos & q->mask) * q->slot_size);
+}
+
+// 获取槽位数据区
+static inline uint8_t *ringqueue_slot_data(struct ringqueue_slot *slot)
+{
+    return reinterpret_cast< uint8_t * >(slot + 1);
+}
+
+struct ringqueue *ringqueue_init(void *mem, uint32_t entries_sz, uint32_t data_sz);
+
+uint32_t ringqueue_reserve(struct ringqueue *q, uint32_t n, uint64_t *pos);
+
+void ringqueue_publish(struct ringqueue *q, uint64_t pos);
+
+uint32_t ringqueue_acquire(struct ringqueue *q, uint32_t n, uint64_t *pos);
+
+void ringqueue_release(struct ringqueue *q, uint64_t pos);
+
+struct ringqueue_slot *ringqueue_peek(struct ringqueue *q, uint64_t *pos);
+
+bool ringqueue_enqueue(struct ringqueue *q, const void *data, uint32_t len);
+
+uint32_t ringqueue_enqueue_burst(struct ringqueue *q, const void *const *data,
+    const uint32_t *len, uint32_t n);
+
+bool ringqueue_dequeue(struct ringqueue *q, void *data, uint32_t size, uint32_t *len);
+
+uint32_t ringqueue_count(const struct ringqueue *q);
+
+}    // namespace logging
+#endif    // EASELOG_RINGQUEUE_H
@@ -0,0 +1,321 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_ringqueue_unittest.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 15:40
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  环形队列的单元测试, 多线程压力测试以及和llqueue的性能对比.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_llqueue.h"
+#include "log/easelog_private.h"
+#include "log/easelog_ringqueue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace logging {
+
+#define TEST_QUEUE_SIZE      256
+#define TEST_QUEUE_DATA_SIZE 48
+
+// 按缓存行对齐分配队列内存
+static struct ringqueue *CreateTestRingQueue(uint32_t entries_sz, uint32_t data_sz)
+{
+    void *mem = nullptr;
+
+    if (posix_memalign(&mem, RINGQUEUE_CACHELINE_SIZE, RINGQUEUE_MEMSIZE(entries_sz, data_sz))) {
+        return nullptr;
+    }
+    return ringqueue_init(mem, entries_sz, data_sz);
+}
+
+// 测试单线程下的先进先出, 队列满, 队列空和批量操作
+TEST(RingQueueTest, BasicFifo)
+{
+    struct ringqueue *q = CreateTestRingQueue(4, TEST_QUEUE_DATA_SIZE);
+    uint32_t          value, len;
+    uint64_t          pos;
+
+    ASSERT_NE(q, nullptr);
+    EXPECT_EQ(ringqueue_init(q, 3, TEST_QUEUE_DATA_SIZE), nullptr);
+    EXPECT_EQ(q->slot_size % RINGQUEUE_CACHELINE_SIZE, 0u);
+    EXPECT_GE(q->data_size, static_cast< uint32_t >(TEST_QUEUE_DATA_SIZE));
+
+    /* 空队列 */
+    EXPECT_FALSE(ringqueue_dequeue(q, &value, sizeof(value), &len));
+
+    for (uint32_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(ringqueue_enqueue(q, &i, sizeof(i)));
+    }
+    /* 队列满 */
+    value = 4;
+    EXPECT_FALSE(ringqueue_enqueue(q, &value, sizeof(value)));
+    EXPECT_EQ(ringqueue_count(q), 4u);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(ringqueue_dequeue(q, &value, sizeof(value), &len));
+        EXPECT_EQ(value, i);
+        EXPECT_EQ(len, sizeof(value));
+    }
+    EXPECT_EQ(ringqueue_count(q), 0u);
+
+    /* 超过槽位大小的数据不能入队 */
+    char big[TEST_QUEUE_DATA_SIZE * 2] = {0};
+    EXPECT_FALSE(ringqueue_enqueue(q, big, sizeof(big)));
+
+    /* 批量入队只占用剩余的槽位, 跨越队列尾部回绕 */
+    uint32_t       values[6] = {10, 11, 12, 13, 14, 15};
+    const void    *data[6];
+    uint32_t       lens[6];
+    for (uint32_t i = 0; i < 6; i++) {
+        data[i] = &values[i];
+        lens[i] = sizeof(uint32_t);
+    }
+    EXPECT_EQ(ringqueue_enqueue_burst(q, data, lens, 3), 3u);
+    EXPECT_EQ(ringqueue_enqueue_burst(q, data + 3, lens + 3, 3), 1u);
+
+    /* 批量出队, 槽位数据原地读取 */
+    EXPECT_EQ(ringqueue_acquire(q, 8, &pos), 4u);
+    for (uint32_t i = 0; i < 4; i++) {
+        struct ringqueue_slot *slot = ringqueue_slot_at(q, pos + i);
+        memcpy(&value, ringqueue_slot_data(slot), sizeof(value));
+        EXPECT_EQ(value, 10 + i);
+        ringqueue_release(q, pos + i);
+    }
+    EXPECT_EQ(ringqueue_acquire(q, 8, &pos), 0u);
+
+    free(q);
+}
+
+// 压力测试的消息, 记录生产者编号和序号
+struct TestMessage {
+    uint32_t producer;
+    uint32_t sequence;
+};
+
+#define STRESS_PRODUCERS 4
+#define STRESS_CONSUMERS 3
+#define STRESS_MESSAGES  50000u
+
+// 多生产者多消费者压力测试, 检查消息不丢失, 不重复, 同一生产者的消息按顺序出队
+TEST(RingQueueTest, MultiProducerMultiConsumerStress)
+{
+    struct ringqueue *q = CreateTestRingQueue(TEST_QUEUE_SIZE, TEST_QUEUE_DATA_SIZE);
+    ASSERT_NE(q, nullptr);
+
+    std::atomic< uint32_t >    consumed(0);
+    std::vector< uint32_t >    received(STRESS_PRODUCERS * STRESS_MESSAGES, 0);
+    std::atomic< uint32_t >    order_errors(0);
+    std::vector< std::thread > threads;
+
+    for (uint32_t p = 0; p < STRESS_PRODUCERS; p++) {
+        threads.emplace_back(
+            [q](uint32_t producer) {
+                uint32_t sequence = 0;
+                while (sequence < STRESS_MESSAGES) {
+                    /* 交替使用单条和批量入队 */
+                    if (sequence % 2 == 0) {
+                        TestMessage message = {producer, sequence};
+                        if (ringqueue_enqueue(q, &message, sizeof(message))) {
+                            sequence++;
+                        } else {
+                            std::this_thread::yield();
+                        }
+                        continue;
+                    }
+
+                    uint64_t pos;
+                    uint32_t batch = std::min(8u, STRESS_MESSAGES - sequence);
+                    uint32_t count = ringqueue_reserve(q, batch, &pos);
+                    for (uint32_t i = 0; i < count; i++) {
+                        TestMessage            message = {producer, sequence++};
+                        struct ringqueue_slot *slot    = ringqueue_slot_at(q, pos + i);
+                        memcpy(ringqueue_slot_data(slot), &message, sizeof(message));
+                        slot->len = sizeof(message);
+                        ringqueue_publish(q, pos + i);
+                    }
+                    if (count == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            },
+            p);
+    }
+
+    for (uint32_t c = 0; c < STRESS_CONSUMERS; c++) {
+        threads.emplace_back([q, &consumed, &received, &order_errors]() {
+            uint32_t last[STRESS_PRODUCERS] = {0};
+            bool     seen[STRESS_PRODUCERS] = {false};
+
+            while (consumed.load(std::memory_order_relaxed) < STRESS_PRODUCERS * STRESS_MESSAGES) {
+                uint64_t pos;
+                uint32_t count = ringqueue_acquire(q, 16, &pos);
+                for (uint32_t i = 0; i < count; i++) {
+                    TestMessage            message;
+                    struct ringqueue_slot *slot = ringqueue_slot_at(q, pos + i);
+                    memcpy(&message, ringqueue_slot_data(slot), sizeof(message));
+                    ringqueue_release(q, pos + i);
+
+                    if (seen[message.producer] && message.sequence <= last[message.producer]) {
+                        order_errors.fetch_add(1);
+                    }
+                    seen[message.producer] = true;
+                    last[message.producer] = message.sequence;
+                    received[message.producer * STRESS_MESSAGES + message.sequence]++;
+                }
+                if (count == 0) {
+                    std::this_thread::yield();
+                }
+                consumed.fetch_add(count, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(order_errors.load(), 0u);
+    for (uint32_t i = 0; i < STRESS_PRODUCERS * STRESS_MESSAGES; i++) {
+        ASSERT_EQ(received[i], 1u) << "message " << i;
+    }
+    EXPECT_EQ(ringqueue_count(q), 0u);
+
+    free(q);
+}
+
+#define BENCH_THREADS  4
+#define BENCH_MESSAGES 100000
+
+// 基于原有llqueue的队列对, free队列分配元素, wait队列传递消息, 消费者一次取出全部元素并反转
+static uint64_t BenchmarkLLQueue()
+{
+    static struct llqueue_entry entries[TEST_QUEUE_SIZE];
+    static struct llqueue       free_queue;
+    static struct llqueue       wait_queue;
+    static TestMessage          messages[TEST_QUEUE_SIZE];
+
+    llqueue_init(&free_queue, entries, TEST_QUEUE_SIZE);
+    llqueue_init(&wait_queue, entries, TEST_QUEUE_SIZE);
+    for (uint32_t i = 0; i < TEST_QUEUE_SIZE; i++) {
+        llqueue_enqueue(&free_queue, i);
+    }
+
+    std::vector< std::thread > threads;
+    uint64_t                   start_time = TickCountUs();
+
+    for (uint32_t p = 0; p < BENCH_THREADS; p++) {
+        threads.emplace_back([p]() {
+            for (uint32_t i = 0; i < BENCH_MESSAGES;) {
+                uint32_t idx = llqueue_dequeue(&free_queue);
+                if (idx == LLQUEUE_NULL_IDX) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                messages[idx]     = {p, i++};
+                entries[idx].data = &messages[idx];
+                llqueue_enqueue(&wait_queue, idx);
+            }
+        });
+    }
+
+    uint32_t consumed = 0;
+    while (consumed < BENCH_THREADS * BENCH_MESSAGES) {
+        uint32_t idx = llqueue_dequeue_all(&wait_queue);
+        if (idx == LLQUEUE_NULL_IDX) {
+            std::this_thread::yield();
+            continue;
+        }
+        // 反转为先进先出顺序
+        uint32_t last = LLQUEUE_NULL_IDX;
+        while (idx != LLQUEUE_NULL_IDX) {
+            uint32_t next     = entries[idx].next;
+            entries[idx].next = last;
+            last              = idx;
+            idx               = next;
+        }
+        while (last != LLQUEUE_NULL_IDX) {
+            uint32_t next = entries[last].next;
+            llqueue_enqueue(&free_queue, last);
+            consumed++;
+            last = next;
+        }
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return TickCountUs() - start_time;
+}
+
+// 相同负载下的环形队列, 消息内联存放在槽位中
+static uint64_t BenchmarkRingQueue()
+{
+    struct ringqueue *q = CreateTestRingQueue(TEST_QUEUE_SIZE, TEST_QUEUE_DATA_SIZE);
+
+    std::vector< std::thread > threads;
+    uint64_t                   start_time = TickCountUs();
+
+    for (uint32_t p = 0; p < BENCH_THREADS; p++) {
+        threads.emplace_back(
+            [q](uint32_t producer) {
+                for (uint32_t i = 0; i < BENCH_MESSAGES;) {
+                    TestMessage message = {producer, i};
+                    if (ringqueue_enqueue(q, &message, sizeof(message))) {
+                        i++;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            },
+            p);
+    }
+
+    uint32_t consumed = 0;
+    while (consumed < BENCH_THREADS * BENCH_MESSAGES) {
+        uint64_t pos;
+        uint32_t count = ringqueue_acquire(q, 32, &pos);
+        if (count == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            ringqueue_release(q, pos + i);
+        }
+        consumed += count;
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    free(q);
+    return TickCountUs() - start_time;
+}
+
+// 简易性能对比, 4个生产者和1个消费者, 输出每条消息的平均耗时
+TEST(RingQueueTest, BenchmarkAgainstLLQueue)
+{
+    uint64_t llqueue_us   = BenchmarkLLQueue();
+    uint64_t ringqueue_us = BenchmarkRingQueue();
+
+    std::cout << "llqueue: " << llqueue_us * 1000 / (BENCH_THREADS * BENCH_MESSAGES)
+              << " ns/msg, ringqueue: " << ringqueue_us * 1000 / (BENCH_THREADS * BENCH_MESSAGES)
+              << " ns/msg" << std::endl;
+}
+
+}    // namespace logging
@@ -0,0 +1,413 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_shm.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 17:20
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  多进程共享内存日志传输, 每个进程占用一个环形队列, 由收集线程按时间顺序合并输出.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+#include "log/easelog_ringqueue.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+#define LOG_SHM_MAGIC          0x45534c47    // "ESLG"
+#define LOG_SHM_VERSION        1
+#define LOG_SHM_RING_SIZE      256
+#define LOG_SHM_RING_DATA_SIZE 1000
+#define LOG_SHM_ENQUEUE_RETRY  1000
+
+// 共享内存头部, 只在创建时写入, magic最后写入
+struct alignas(RINGQUEUE_CACHELINE_SIZE) LogShmHeader {
+    std::atomic< uint32_t > magic;          // 初始化完成标记
+    uint32_t                version;        // 内存布局版本
+    uint32_t                max_rings;      // 环形队列个数
+    uint32_t                ring_stride;    // 每个环形队列占用的内存大小, 包括占用者信息
+    uint8_t                 __pad[RINGQUEUE_CACHELINE_SIZE - 4 * sizeof(uint32_t)];
+};
+
+// 环形队列的占用者信息, 独占一个缓存行, 环形队列紧跟在后面
+struct alignas(RINGQUEUE_CACHELINE_SIZE) LogShmRingOwner {
+    std::atomic< int32_t > pid;    // 占用环形队列的进程ID, 0表示空闲
+    uint8_t                __pad[RINGQUEUE_CACHELINE_SIZE - sizeof(std::atomic< int32_t >)];
+};
+
+// 共享内存中的日志记录头部, 日志内容紧跟在头部之后
+struct LogShmRecord {
+    struct timeval tv;          // 生成日志的时间
+    LogSeverity    severity;    // 日志等级, 收集进程按照自己的配置选择输出目的地
+    uint32_t       length;      // 日志长度, 包括前缀和尾部换行符
+};
+
+#define LOG_SHM_RING_STRIDE \
+    (sizeof(LogShmRingOwner) + RINGQUEUE_MEMSIZE(LOG_SHM_RING_SIZE, LOG_SHM_RING_DATA_SIZE))
+
+// 当前进程的共享内存状态
+static uint8_t                          *g_log_shm_base = nullptr;     // 共享内存映射地址
+static std::atomic< struct ringqueue * > g_log_shm_ring(nullptr);      // 当前进程占用的环形队列
+static bool                              g_log_shm_creator = false;    // 是否由当前进程创建
+static std::string                       g_log_shm_name;               // 共享内存名字
+
+// 收集线程, 只在创建共享内存的进程中运行
+static std::thread        *g_log_collector = nullptr;
+static std::atomic< bool > g_log_collector_stop(false);
+
+// 长度不合法被丢弃的日志数量, 共享内存可以被任何连接的进程写入, 收集线程不信任其中的长度
+static std::atomic< uint64_t > g_log_shm_corrupt(0);
+
+static inline LogShmHeader *GetLogShmHeader()
+{
+    return reinterpret_cast< LogShmHeader * >(g_log_shm_base);
+}
+
+static inline LogShmRingOwner *GetLogShmOwner(uint32_t index)
+{
+    return reinterpret_cast< LogShmRingOwner * >(
+        g_log_shm_base + sizeof(LogShmHeader) + index * LOG_SHM_RING_STRIDE);
+}
+
+static inline struct ringqueue *GetLogShmRing(uint32_t index)
+{
+    return reinterpret_cast< struct ringqueue * >(GetLogShmOwner(index) + 1);
+}
+
+// 映射共享内存, 成功后关闭文件描述符, 映射仍然有效, fork之后子进程继承
+static bool MapLogSharedMemory(int fd, size_t size)
+{
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    g_log_shm_base = static_cast< uint8_t * >(base);
+    return true;
+}
+
+// 占用一个空闲的环形队列, 全部被占用时返回nullptr
+static struct ringqueue *ClaimLogShmRing()
+{
+    int32_t pid = static_cast< int32_t >(getpid());
+
+    for (uint32_t i = 0; i < GetLogShmHeader()->max_rings; i++) {
+        int32_t expected = 0;
+        if (GetLogShmOwner(i)->pid.compare_exchange_strong(expected, pid)) {
+            return GetLogShmRing(i);
+        }
+    }
+    return nullptr;
+}
+
+// 释放占用的环形队列
+static void ReleaseLogShmRing(struct ringqueue *ring)
+{
+    (reinterpret_cast< LogShmRingOwner * >(ring) - 1)->pid.store(0);
+}
+
+// export: 创建共享内存, name为空时使用memfd, 只能通过fork共享
+bool CreateLogSharedMemory(const char *name, uint32_t max_processes)
+{
+    int fd;
+
+    if (g_log_shm_base != nullptr || max_processes == 0) {
+        return false;
+    }
+
+    if (name != nullptr) {
+        // 之前异常退出遗留的同名共享内存, 已经映射的进程不受影响
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    } else {
+        fd = memfd_create("easelog", MFD_CLOEXEC);
+    }
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t size = sizeof(LogShmHeader) + max_processes * LOG_SHM_RING_STRIDE;
+    if (ftruncate(fd, static_cast< off_t >(size)) != 0) {
+        close(fd);
+        if (name != nullptr) {
+            shm_unlink(name);
+        }
+        return false;
+    }
+    if (!MapLogSharedMemory(fd, size)) {
+        if (name != nullptr) {
+            shm_unlink(name);
+        }
+        return false;
+    }
+
+    LogShmHeader *header = GetLogShmHeader();
+    header->version      = LOG_SHM_VERSION;
+    header->max_rings    = max_processes;
+    header->ring_stride  = static_cast< uint32_t >(LOG_SHM_RING_STRIDE);
+    for (uint32_t i = 0; i < max_processes; i++) {
+        new (GetLogShmOwner(i)) LogShmRingOwner();
+        GetLogShmOwner(i)->pid.store(0, std::memory_order_relaxed);
+        ringqueue_init(GetLogShmRing(i), LOG_SHM_RING_SIZE, LOG_SHM_RING_DATA_SIZE);
+    }
+    header->magic.store(LOG_SHM_MAGIC, std::memory_order_release);
+
+    g_log_shm_creator = true;
+    g_log_shm_name    = name != nullptr ? name : "";
+    return true;
+}
+
+// export: 其他进程按照名字连接共享内存, 并且占用一个环形队列
+bool AttachLogSharedMemory(const char *name)
+{
+    struct stat st;
+
+    if (g_log_shm_base != nullptr || name == nullptr) {
+        return false;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || static_cast< size_t >(st.st_size) < sizeof(LogShmHeader)) {
+        close(fd);
+        return false;
+    }
+    if (!MapLogSharedMemory(fd, static_cast< size_t >(st.st_size))) {
+        return false;
+    }
+
+    LogShmHeader *header = GetLogShmHeader();
+    size_t        size   = static_cast< size_t >(st.st_size);
+    if (header->magic.load(std::memory_order_acquire) != LOG_SHM_MAGIC ||
+        header->version != LOG_SHM_VERSION || header->ring_stride != LOG_SHM_RING_STRIDE ||
+        size < sizeof(LogShmHeader) + header->max_rings * LOG_SHM_RING_STRIDE) {
+        munmap(g_log_shm_base, size);
+        g_log_shm_base = nullptr;
+        return false;
+    }
+
+    struct ringqueue *ring = ClaimLogShmRing();
+    g_log_shm_ring.store(ring, std::memory_order_release);
+    return ring != nullptr;
+}
+
+// export: 日志写入当前进程的环形队列, 创建共享内存的进程直接输出, 返回false.
+// 日志太长, 队列全部被占用或者收集线程长时间没有取走日志时返回false, 由调用者直接输出.
+bool LogShmEnqueue(LogSeverity severity, const struct timeval &tv, const char *text,
+    uint32_t length)
+{
+    uint64_t pos;
+
+    if (LIKELY(g_log_shm_base == nullptr) || g_log_shm_creator) {
+        return false;
+    }
+    // fork出的子进程在第一次输出日志时占用环形队列, 多个线程同时占用时只保留一个
+    struct ringqueue *ring = g_log_shm_ring.load(std::memory_order_acquire);
+    if (UNLIKELY(ring == nullptr)) {
+        struct ringqueue *claimed = ClaimLogShmRing();
+        if (claimed == nullptr) {
+            return false;
+        }
+        if (g_log_shm_ring.compare_exchange_strong(ring, claimed)) {
+            ring = claimed;
+        } else {
+            ReleaseLogShmRing(claimed);
+        }
+    }
+    if (sizeof(LogShmRecord) + length > ring->data_size) {
+        return false;
+    }
+
+    uint32_t retry = 0;
+    while (ringqueue_reserve(ring, 1, &pos) == 0) {
+        if (++retry >= LOG_SHM_ENQUEUE_RETRY) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    LogShmRecord           record = {tv, severity, length};
+    struct ringqueue_slot *slot   = ringqueue_slot_at(ring, pos);
+    uint8_t               *data   = ringqueue_slot_data(slot);
+    memcpy(data, &record, sizeof(record));
+    memcpy(data + sizeof(record), text, length);
+    slot->len = static_cast< uint32_t >(sizeof(record)) + length;
+    ringqueue_publish(ring, pos);
+    return true;
+}
+
+// export: fork之后在子进程中调用, 子进程继承共享内存映射, 但是需要占用自己的环形队列
+void ResetLogSharedMemoryAfterFork()
+{
+    g_log_shm_ring.store(nullptr, std::memory_order_relaxed);
+    g_log_shm_creator = false;
+    // 收集线程不会被复制到子进程
+    g_log_collector = nullptr;
+}
+
+// 每个环形队列下一条日志的缓存, 用于多路归并
+struct LogShmCursor {
+    struct ringqueue *ring;       // 环形队列
+    LogShmRecord     *record;     // 下一条日志, nullptr表示队列空
+    uint64_t          pos;        // 下一条日志的位置
+};
+
+// 查看环形队列的下一条日志
+static void PeekLogShmCursor(LogShmCursor &cursor)
+{
+    struct ringqueue_slot *slot = ringqueue_peek(cursor.ring, &cursor.pos);
+
+    cursor.record =
+        slot != nullptr ? reinterpret_cast< LogShmRecord * >(ringqueue_slot_data(slot)) : nullptr;
+}
+
+// 按照时间顺序合并输出所有环形队列中的日志, 返回输出的日志数量.
+// 每次持有日志锁输出一批, 避免长时间阻塞当前进程的日志.
+static uint32_t CollectLogSharedMemory(std::vector< LogShmCursor > &cursors)
+{
+    uint32_t                       count = 0;
+    std::unique_lock< std::mutex > lock  = LockLogOutput();
+
+    for (LogShmCursor &cursor : cursors) {
+        PeekLogShmCursor(cursor);
+    }
+
+    while (count < LOG_SHM_RING_SIZE) {
+        LogShmCursor *next = nullptr;
+        for (LogShmCursor &cursor : cursors) {
+            if (cursor.record != nullptr &&
+                (next == nullptr || timercmp(&cursor.record->tv, &next->record->tv, <))) {
+                next = &cursor;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+
+        uint64_t pos;
+        ringqueue_acquire(next->ring, 1, &pos);
+        // 长度和日志等级只读取一次, 按照本进程的常量检查, 不使用共享内存中的data_size.
+        // 负数是VLOG的详细等级, 按照DEBUG处理
+        uint32_t    slot_len = ringqueue_slot_at(next->ring, pos)->len;
+        uint32_t    length   = next->record->length;
+        LogSeverity severity = next->record->severity;
+        if (LIKELY(slot_len >= sizeof(LogShmRecord) && slot_len <= LOG_SHM_RING_DATA_SIZE &&
+                   length <= slot_len - sizeof(LogShmRecord) &&
+                   severity < LOGGING_NUM_SEVERITIES)) {
+            WriteCollectedLogRecordLocked(severity, next->record->tv,
+                reinterpret_cast< const char * >(next->record + 1), length);
+        } else {
+            g_log_shm_corrupt.fetch_add(1, std::memory_order_relaxed);
+        }
+        ringqueue_release(next->ring, pos);
+        PeekLogShmCursor(*next);
+        count++;
+    }
+    SubmitLogUringLocked();
+    return count;
+}
+
+// export: 获取收集线程丢弃的长度或者等级不合法的日志数量
+uint64_t GetLogShmCorruptCount()
+{
+    return g_log_shm_corrupt.load(std::memory_order_relaxed);
+}
+
+// 回收已经退出的进程占用的空闲环形队列
+static void ReapLogShmRings()
+{
+    for (uint32_t i = 0; i < GetLogShmHeader()->max_rings; i++) {
+        int32_t pid = GetLogShmOwner(i)->pid.load(std::memory_order_relaxed);
+        if (pid != 0 && ringqueue_count(GetLogShmRing(i)) == 0 && kill(pid, 0) != 0 &&
+            errno == ESRCH) {
+            GetLogShmOwner(i)->pid.compare_exchange_strong(pid, 0);
+        }
+    }
+}
+
+// 收集线程, 没有日志时休眠1ms, 每秒回收一次退出进程的环形队列
+static void LogCollectorMain()
+{
+    std::vector< LogShmCursor > cursors(GetLogShmHeader()->max_rings);
+    uint64_t                    reap_us = TickCountUs();
+
+    for (uint32_t i = 0; i < cursors.size(); i++) {
+        cursors[i].ring = GetLogShmRing(i);
+    }
+
+    while (!g_log_collector_stop.load(std::memory_order_relaxed)) {
+        if (CollectLogSharedMemory(cursors) == 0) {
+            usleep(1000);
+        }
+        if (TickCountUs() - reap_us >= 1000000) {
+            ReapLogShmRings();
+            reap_us = TickCountUs();
+        }
+    }
+
+    // 退出前输出剩余的日志
+    while (CollectLogSharedMemory(cursors) != 0) {
+    }
+}
+
+// export: 在创建共享内存的进程中启动收集线程
+bool StartLogCollector()
+{
+    static bool g_log_collector_atexit = false;
+
+    if (!g_log_shm_creator || g_log_collector != nullptr) {
+        return false;
+    }
+
+    g_log_collector_stop.store(false, std::memory_order_relaxed);
+    g_log_collector = new std::thread(LogCollectorMain);
+    if (!g_log_collector_atexit) {
+        atexit(StopLogCollector);
+        g_log_collector_atexit = true;
+    }
+    return true;
+}
+
+// export: 停止收集线程, 输出剩余的日志, 并且删除共享内存名字
+void StopLogCollector()
+{
+    if (g_log_collector == nullptr) {
+        return;
+    }
+
+    g_log_collector_stop.store(true, std::memory_order_relaxed);
+    g_log_collector->join();
+    delete g_log_collector;
+    g_log_collector = nullptr;
+
+    if (!g_log_shm_name.empty()) {
+        shm_unlink(g_log_shm_name.c_str());
+        g_log_shm_name.clear();
+    }
+}
+
+}    // namespace logging
@@ -0,0 +1,354 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_slab.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 16:30
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  日志记录内存分配器, 线程私有的分级slab缓存, 跨线程释放批量归还给所属线程.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <stdlib.h>
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace logging {
+
+// 按2的幂分级, 最小256字节, 最大16KB, 更大的记录直接使用malloc
+#define LOG_SLAB_CLASSES   7
+#define LOG_SLAB_MIN_SHIFT 8
+#define LOG_SLAB_SIZE      (64 * 1024)
+// 跨线程释放时, 同一个线程缓存的块攒够一批再归还
+#define LOG_SLAB_BATCH     32
+// 默认内存上限
+#define LOG_SLAB_LIMIT     (16 * 1024 * 1024)
+
+struct LogSlabCache;
+
+// 块头部, 空闲时通过next链接到空闲链表, 头部之后是用户数据
+struct LogSlabBlock {
+    LogSlabCache *owner;         // 所属线程缓存, 大块为nullptr
+    uint32_t      size_class;    // 块大小等级
+    uint32_t      size;          // 块大小, 包括头部
+    LogSlabBlock *next;          // 空闲链表
+    uint64_t      __pad;         // 保证用户数据16字节对齐
+};
+
+// 线程缓存, 所属线程退出后成为孤儿缓存, 由新线程接管, 因此缓存本身不会释放.
+// 远程释放链表由其他线程并发压入, 只由所属线程一次性取出, 单独占用一个缓存行.
+struct LogSlabCache {
+    std::atomic< LogSlabBlock * > remote_free[LOG_SLAB_CLASSES];
+    uint64_t                      __pad0;
+    // 空闲链表只由所属线程修改, 统计字段允许其他线程读取
+    LogSlabBlock                 *local_free[LOG_SLAB_CLASSES];
+    uint64_t                      __pad1;
+    std::atomic< uint64_t >       in_use_bytes;         // 已分配未归还的字节数
+    std::atomic< uint64_t >       alloc_count;          // 分配次数, 只由所属线程修改
+    std::atomic< uint64_t >       remote_free_count;    // 远程释放次数, 归还一批时更新
+    std::atomic< uint64_t >       orphan;               // 所属线程是否已经退出
+};
+
+// 跨线程释放的批量缓存, 同一个线程缓存和大小等级的块串成链表, 一次CAS归还
+struct LogSlabFreeBatch {
+    LogSlabCache *owner;
+    LogSlabBlock *head;
+    LogSlabBlock *tail;
+    uint32_t      size_class;
+    uint32_t      count;
+};
+
+// 保护线程缓存列表和孤儿缓存列表
+static std::mutex                    g_slab_mutex;
+static std::vector< LogSlabCache * > g_slab_caches;
+static std::vector< LogSlabCache * > g_slab_orphans;
+
+static std::atomic< uint64_t > g_slab_limit(LOG_SLAB_LIMIT);
+static std::atomic< uint64_t > g_slab_reserved(0);
+static std::atomic< uint64_t > g_slab_large_bytes(0);
+static std::atomic< uint64_t > g_slab_large_count(0);
+static std::atomic< uint64_t > g_slab_failures(0);
+
+// 线程私有状态, 都是平凡析构的类型, 线程退出过程中仍然可以安全访问
+static thread_local LogSlabCache    *g_slab_cache        = nullptr;
+static thread_local bool             g_slab_cache_exited = false;
+static thread_local LogSlabFreeBatch g_slab_free_batch;
+
+// 所属线程更新统计字段, 单写者不需要原子读改写
+static inline void SlabCounterAdd(std::atomic< uint64_t > &counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// 从内存上限中预留空间, 超过上限时返回false
+static bool ReserveSlabMemory(uint64_t size)
+{
+    uint64_t reserved = g_slab_reserved.load(std::memory_order_relaxed);
+
+    do {
+        if (reserved + size > g_slab_limit.load(std::memory_order_relaxed)) {
+            g_slab_failures.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!g_slab_reserved.compare_exchange_weak(reserved, reserved + size,
+        std::memory_order_relaxed));
+    return true;
+}
+
+// 把批量缓存中的块一次性压入所属线程缓存的远程释放链表, 统计字段也按批更新
+static void FlushSlabFreeBatch(LogSlabFreeBatch &batch)
+{
+    if (batch.count == 0) {
+        return;
+    }
+
+    uint64_t bytes = static_cast< uint64_t >(batch.count) << (batch.size_class + LOG_SLAB_MIN_SHIFT);
+    batch.owner->in_use_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    batch.owner->remote_free_count.fetch_add(batch.count, std::memory_order_relaxed);
+
+    std::atomic< LogSlabBlock * > &list = batch.owner->remote_free[batch.size_class];
+    LogSlabBlock                  *head = list.load(std::memory_order_relaxed);
+    do {
+        batch.tail->next = head;
+    } while (!list.compare_exchange_weak(head, batch.head, std::memory_order_release,
+        std::memory_order_relaxed));
+
+    batch.owner = nullptr;
+    batch.head  = nullptr;
+    batch.tail  = nullptr;
+    batch.count = 0;
+}
+
+// 线程退出时归还批量缓存, 并且把线程缓存放入孤儿列表
+struct LogSlabCacheHolder {
+    ~LogSlabCacheHolder()
+    {
+        FlushSlabFreeBatch(g_slab_free_batch);
+        g_slab_cache_exited = true;
+        if (g_slab_cache == nullptr) {
+            return;
+        }
+
+        std::lock_guard< std::mutex > lock(g_slab_mutex);
+        g_slab_cache->orphan.store(1, std::memory_order_relaxed);
+        g_slab_orphans.push_back(g_slab_cache);
+        g_slab_cache = nullptr;
+    }
+};
+
+static thread_local LogSlabCacheHolder g_slab_holder;
+
+// 获取当前线程的缓存, 优先接管孤儿缓存, 线程退出过程中返回nullptr
+static LogSlabCache *GetThreadSlabCache()
+{
+    if (LIKELY(g_slab_cache != nullptr)) {
+        return g_slab_cache;
+    }
+    if (g_slab_cache_exited) {
+        return nullptr;
+    }
+
+    // 访问线程局部对象, 注册线程退出时的析构函数
+    (void)&g_slab_holder;
+
+    std::lock_guard< std::mutex > lock(g_slab_mutex);
+    if (!g_slab_orphans.empty()) {
+        g_slab_cache = g_slab_orphans.back();
+        g_slab_orphans.pop_back();
+        g_slab_cache->orphan.store(0, std::memory_order_relaxed);
+        return g_slab_cache;
+    }
+
+    void *mem = nullptr;
+    if (posix_memalign(&mem, 64, sizeof(LogSlabCache)) != 0) {
+        return nullptr;
+    }
+    LogSlabCache *cache = new (mem) LogSlabCache;
+    for (uint32_t i = 0; i < LOG_SLAB_CLASSES; i++) {
+        std::atomic_init(&(cache->remote_free[i]), static_cast< LogSlabBlock * >(nullptr));
+        cache->local_free[i] = nullptr;
+    }
+    std::atomic_init(&(cache->in_use_bytes), static_cast< uint64_t >(0));
+    std::atomic_init(&(cache->alloc_count), static_cast< uint64_t >(0));
+    std::atomic_init(&(cache->remote_free_count), static_cast< uint64_t >(0));
+    std::atomic_init(&(cache->orphan), static_cast< uint64_t >(0));
+    g_slab_caches.push_back(cache);
+    g_slab_cache = cache;
+    return cache;
+}
+
+// 一次取出远程释放的全部块
+static LogSlabBlock *CollectRemoteFrees(LogSlabCache *cache, uint32_t size_class)
+{
+    return cache->remote_free[size_class].exchange(nullptr, std::memory_order_acquire);
+}
+
+// 申请一个新的slab, 切分成指定大小等级的块
+static LogSlabBlock *CarveSlab(LogSlabCache *cache, uint32_t size_class)
+{
+    uint32_t size = 1u << (size_class + LOG_SLAB_MIN_SHIFT);
+
+    if (!ReserveSlabMemory(LOG_SLAB_SIZE)) {
+        return nullptr;
+    }
+    uint8_t *slab = static_cast< uint8_t * >(malloc(LOG_SLAB_SIZE));
+    if (slab == nullptr) {
+        g_slab_reserved.fetch_sub(LOG_SLAB_SIZE, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    LogSlabBlock *list = nullptr;
+    for (uint32_t offset = LOG_SLAB_SIZE; offset >= size; offset -= size) {
+        LogSlabBlock *block = reinterpret_cast< LogSlabBlock * >(slab + offset - size);
+        block->owner        = cache;
+        block->size_class   = size_class;
+        block->size         = size;
+        block->next         = list;
+        list                = block;
+    }
+    return list;
+}
+
+// export: 分配日志记录内存, 超过内存上限时返回nullptr
+void *LogSlabAlloc(size_t size)
+{
+    size_t        total = size + sizeof(LogSlabBlock);
+    LogSlabBlock *block;
+
+    // 超过最大等级的记录直接使用malloc, 同样受内存上限限制
+    if (UNLIKELY(total > (1u << (LOG_SLAB_CLASSES - 1 + LOG_SLAB_MIN_SHIFT)))) {
+        if (!ReserveSlabMemory(total)) {
+            return nullptr;
+        }
+        block = static_cast< LogSlabBlock * >(malloc(total));
+        if (block == nullptr) {
+            g_slab_reserved.fetch_sub(total, std::memory_order_relaxed);
+            return nullptr;
+        }
+        block->owner      = nullptr;
+        block->size_class = LOG_SLAB_CLASSES;
+        block->size       = static_cast< uint32_t >(total);
+        g_slab_large_bytes.fetch_add(total, std::memory_order_relaxed);
+        g_slab_large_count.fetch_add(1, std::memory_order_relaxed);
+        return block + 1;
+    }
+
+    LogSlabCache *cache = GetThreadSlabCache();
+    if (cache == nullptr) {
+        return nullptr;
+    }
+
+    uint32_t size_class = 0;
+    while ((1u << (size_class + LOG_SLAB_MIN_SHIFT)) < total) {
+        size_class++;
+    }
+
+    block = cache->local_free[size_class];
+    if (block == nullptr) {
+        block = CollectRemoteFrees(cache, size_class);
+    }
+    if (block == nullptr) {
+        block = CarveSlab(cache, size_class);
+        if (block == nullptr) {
+            return nullptr;
+        }
+    }
+
+    cache->local_free[size_class] = block->next;
+    cache->in_use_bytes.fetch_add(block->size, std::memory_order_relaxed);
+    SlabCounterAdd(cache->alloc_count, 1);
+    return block + 1;
+}
+
+// export: 释放日志记录内存, 本线程分配的块直接放回空闲链表,
+// 其他线程分配的块先放入批量缓存, 攒够一批或者调用LogSlabFlushFrees()时归还.
+void LogSlabFree(void *ptr)
+{
+    LogSlabBlock *block = static_cast< LogSlabBlock * >(ptr) - 1;
+
+    if (block->owner == nullptr) {
+        g_slab_large_bytes.fetch_sub(block->size, std::memory_order_relaxed);
+        g_slab_reserved.fetch_sub(block->size, std::memory_order_relaxed);
+        free(block);
+        return;
+    }
+
+    if (block->owner == g_slab_cache) {
+        LogSlabCache *cache            = g_slab_cache;
+        block->next                    = cache->local_free[block->size_class];
+        cache->local_free[block->size_class] = block;
+        cache->in_use_bytes.fetch_sub(block->size, std::memory_order_relaxed);
+        return;
+    }
+
+    // 线程缓存已经析构时批量缓存不会再归还, 直接压入所属线程缓存的远程释放链表
+    if (UNLIKELY(g_slab_cache_exited)) {
+        LogSlabFreeBatch single = {block->owner, block, block, block->size_class, 1};
+        FlushSlabFreeBatch(single);
+        return;
+    }
+
+    LogSlabFreeBatch &batch = g_slab_free_batch;
+    if (batch.count != 0 &&
+        (batch.owner != block->owner || batch.size_class != block->size_class)) {
+        FlushSlabFreeBatch(batch);
+    }
+    if (batch.count == 0) {
+        // 只释放不分配的线程也需要在退出时归还批量缓存
+        (void)&g_slab_holder;
+        batch.owner      = block->owner;
+        batch.size_class = block->size_class;
+        batch.tail       = block;
+    }
+    block->next = batch.head;
+    batch.head  = block;
+    if (++batch.count == LOG_SLAB_BATCH) {
+        FlushSlabFreeBatch(batch);
+    }
+}
+
+// export: 归还当前线程批量缓存中的块
+void LogSlabFlushFrees()
+{
+    FlushSlabFreeBatch(g_slab_free_batch);
+}
+
+// export: 设置日志记录内存上限, 已经分配的内存不受影响
+void SetLogMemoryLimit(uint64_t limit_bytes)
+{
+    g_slab_limit.store(limit_bytes, std::memory_order_relaxed);
+}
+
+// export: 获取日志记录内存统计
+LogMemoryStats GetLogMemoryStats()
+{
+    LogMemoryStats stats;
+
+    stats.limit_bytes       = g_slab_limit.load(std::memory_order_relaxed);
+    stats.reserved_bytes    = g_slab_reserved.load(std::memory_order_relaxed);
+    stats.in_use_bytes      = g_slab_large_bytes.load(std::memory_order_relaxed);
+    stats.alloc_count       = g_slab_large_count.load(std::memory_order_relaxed);
+    stats.remote_free_count = 0;
+    stats.alloc_failures    = g_slab_failures.load(std::memory_order_relaxed);
+
+    std::lock_guard< std::mutex > lock(g_slab_mutex);
+    for (LogSlabCache *cache : g_slab_caches) {
+        stats.in_use_bytes += cache->in_use_bytes.load(std::memory_order_relaxed);
+        stats.alloc_count += cache->alloc_count.load(std::memory_order_relaxed);
+        stats.remote_free_count += cache->remote_free_count.load(std::memory_order_relaxed);
+    }
+    stats.thread_caches = static_cast< uint32_t >(g_slab_caches.size());
+    stats.orphan_caches = static_cast< uint32_t >(g_slab_orphans.size());
+    return stats;
+}
+
+}    // namespace logging
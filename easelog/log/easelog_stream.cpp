@@ -0,0 +1,190 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_stream.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-19 02:50
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  日志流, 内置类型直接格式化到日志缓冲区, 整数每次查表转换两位数字, 不经过locale和streambuf.
+ *  其他类型和操纵符交给第一次使用时创建的std::ostream适配器, 写入同一个缓冲区.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <stdio.h>
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+namespace logging {
+
+// 两位数字的转换表, "00"到"99"
+static const char kLogDigits100[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char kLogHexDigits[] = "0123456789abcdef";
+
+// 适配器的streambuf, 直接追加到日志缓冲区
+class LogStreamBuf : public std::streambuf {
+public:
+    explicit LogStreamBuf(std::string *buffer) : buffer_(buffer) { }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            buffer_->push_back(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char *data, std::streamsize length) override
+    {
+        buffer_->append(data, static_cast< size_t >(length));
+        return length;
+    }
+
+private:
+    std::string *buffer_;
+};
+
+class LogStreamAdapter {
+public:
+    explicit LogStreamAdapter(std::string *buffer) : buf_(buffer), stream_(&buf_) { }
+
+    LogStreamBuf buf_;
+    std::ostream stream_;
+};
+
+// 从后向前转换无符号整数, 返回第一个数字的位置
+static char *FormatLogUnsigned(uint64_t value, char *end)
+{
+    while (value >= 100) {
+        size_t index = static_cast< size_t >(value % 100) * 2;
+        value /= 100;
+        *--end = kLogDigits100[index + 1];
+        *--end = kLogDigits100[index];
+    }
+    if (value >= 10) {
+        size_t index = static_cast< size_t >(value) * 2;
+        *--end = kLogDigits100[index + 1];
+        *--end = kLogDigits100[index];
+    } else {
+        *--end = static_cast< char >('0' + value);
+    }
+    return end;
+}
+
+LogStream::~LogStream()
+{
+    delete adapter_;
+}
+
+std::ostream &LogStream::ostream()
+{
+    if (adapter_ == nullptr) {
+        adapter_ = new LogStreamAdapter(&buffer_);
+    }
+    return adapter_->stream_;
+}
+
+// 适配器的格式状态被操纵符修改过时, 内置类型也交给适配器格式化
+bool LogStream::IsAdapterFormatted() const
+{
+    const std::ostream &stream = adapter_->stream_;
+
+    return stream.flags() != (std::ios_base::dec | std::ios_base::skipws) ||
+        stream.width() != 0 || stream.precision() != 6 || stream.fill() != ' ';
+}
+
+LogStream &LogStream::operator<<(std::ostream &(*manipulator)(std::ostream &))
+{
+    manipulator(ostream());
+    return *this;
+}
+
+LogStream &LogStream::operator<<(std::ios_base &(*manipulator)(std::ios_base &))
+{
+    manipulator(ostream());
+    return *this;
+}
+
+void LogStream::Append(int64_t value)
+{
+    char  digits[24];
+    char *end   = digits + sizeof(digits);
+    // 取绝对值时先转换为无符号数, INT64_MIN不会溢出
+    uint64_t magnitude = value < 0 ? 0 - static_cast< uint64_t >(value)
+                                   : static_cast< uint64_t >(value);
+    char    *start     = FormatLogUnsigned(magnitude, end);
+
+    if (value < 0) {
+        *--start = '-';
+    }
+    buffer_.append(start, static_cast< size_t >(end - start));
+}
+
+void LogStream::Append(uint64_t value)
+{
+    char  digits[24];
+    char *end   = digits + sizeof(digits);
+    char *start = FormatLogUnsigned(value, end);
+
+    buffer_.append(start, static_cast< size_t >(end - start));
+}
+
+// 和std::ostream默认格式一致, 即"%g", 精度6
+void LogStream::Append(double value)
+{
+    char buffer[32];
+    int  length = snprintf(buffer, sizeof(buffer), "%g", value);
+
+    buffer_.append(buffer, static_cast< size_t >(length));
+}
+
+void LogStream::Append(long double value)
+{
+    char buffer[64];
+    int  length = snprintf(buffer, sizeof(buffer), "%Lg", value);
+
+    buffer_.append(buffer, static_cast< size_t >(length));
+}
+
+// 指针输出为"0x"加十六进制数字, 和std::ostream一致, 空指针输出为"0"
+void LogStream::Append(const void *value)
+{
+    char      digits[2 + 2 * sizeof(uintptr_t)];
+    char     *end     = digits + sizeof(digits);
+    char     *start   = end;
+    uintptr_t address = reinterpret_cast< uintptr_t >(value);
+
+    if (address == 0) {
+        buffer_.push_back('0');
+        return;
+    }
+    do {
+        *--start = kLogHexDigits[address & 0xf];
+        address >>= 4;
+    } while (address != 0);
+    *--start = 'x';
+    *--start = '0';
+    buffer_.append(start, static_cast< size_t >(end - start));
+}
+
+}    // namespace logging
@@ -0,0 +1,331 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_stress_unittest.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-19 02:10
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  并发压力测试, 多个生产者线程在每种输出模式和输出目的地下写日志, 解析输出结果,
+ *  检查日志不丢失, 不重复, 同一生产者按顺序输出, 输出时间戳单调不减, 并且报告吞吐量.
+ *  通过测试注入点随机让出CPU, 扩大竞争窗口. 可以使用EASELOG_STRESS_TSAN编译.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace logging {
+
+#define STRESS_RECORDS    2000u
+#define STRESS_PROCESSES  4u
+#define STRESS_TAG        "stress record"
+#define STRESS_YIELD_MASK 63u
+
+static const uint32_t kStressThreads[] = {1, 2, 4, 8};
+
+// 日志输出目的地
+enum : uint32_t {
+    STRESS_SINK_STDERR     = 0,
+    STRESS_SINK_TEXT       = 1,
+    STRESS_SINK_BINARY     = 2,
+    STRESS_SINK_COMPRESSED = 3,
+    STRESS_SINK_URING      = 4,
+};
+
+struct StressMode {
+    LogMode     mode;
+    uint32_t    sink;
+    const char *name;
+};
+
+// 解析输出得到的检查结果
+struct StressResult {
+    uint64_t records;            // 解析到的日志条数
+    uint64_t lost;               // 没有输出的日志
+    uint64_t duplicated;         // 重复输出的日志
+    uint64_t order_errors;       // 同一生产者的日志乱序
+    uint64_t time_inversions;    // 输出时间戳比上一条日志小
+};
+
+// 测试注入点, 每个线程使用独立的随机数, 大约每64次让出一次CPU
+static void StressYield(uint32_t point)
+{
+    static thread_local uint32_t state = 0;
+
+    if (state == 0) {
+        state = static_cast< uint32_t >(LogSampleSeed()) | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    if ((state & STRESS_YIELD_MASK) == point) {
+        std::this_thread::yield();
+    }
+}
+
+// 检查输出中每个生产者的日志, 日志行以时间戳开头, 固定宽度, 可以按照字符串比较
+static StressResult VerifyStressOutput(const std::string &output, uint32_t producers,
+    uint32_t records)
+{
+    StressResult                         result = {0, 0, 0, 0, 0};
+    std::vector< std::vector< uint8_t > > seen(producers, std::vector< uint8_t >(records, 0));
+    std::vector< int64_t >               last(producers, -1);
+    std::istringstream                   lines(output);
+    std::string                          line;
+    std::string                          last_time;
+
+    while (std::getline(lines, line)) {
+        size_t   found = line.find(STRESS_TAG);
+        uint32_t producer, sequence;
+        if (found == std::string::npos ||
+            sscanf(line.c_str() + found + strlen(STRESS_TAG), " %u %u", &producer, &sequence) !=
+                2 ||
+            producer >= producers || sequence >= records) {
+            continue;
+        }
+        result.records++;
+        result.duplicated += seen[producer][sequence]++ != 0;
+        result.order_errors += static_cast< int64_t >(sequence) <= last[producer];
+        last[producer] = sequence;
+
+        std::string time = line.substr(0, line.find(' '));
+        result.time_inversions += time < last_time;
+        last_time = time;
+    }
+    for (const std::vector< uint8_t > &producer : seen) {
+        for (uint8_t count : producer) {
+            result.lost += count == 0;
+        }
+    }
+    return result;
+}
+
+static std::string ReadStressFile(const FilePath &path, uint32_t sink)
+{
+    std::string output;
+
+    if (sink == STRESS_SINK_BINARY || sink == STRESS_SINK_COMPRESSED) {
+        LogDecodeOptions options = {0, UINT64_MAX, LOG_SEVERITY_MASK_ALL, LOG_DECODE_TEXT, 0, 0};
+        DecodeLogFile(path.c_str(), options,
+            [&output](const char *data, size_t length) { output.append(data, length); }, nullptr);
+        return output;
+    }
+
+    FILE  *file = fopen(path.c_str(), "r");
+    char   buffer[65536];
+    size_t length;
+    if (file == nullptr) {
+        return output;
+    }
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        output.append(buffer, length);
+    }
+    fclose(file);
+    return output;
+}
+
+// 启动生产者线程, 同时开始写日志, 返回从开始到FlushLog()返回的时间, 单位us
+static uint64_t RunStressProducers(uint32_t threads, uint32_t records)
+{
+    std::vector< std::thread > producers;
+    std::atomic< uint32_t >    ready(0);
+    std::atomic< bool >        start(false);
+
+    for (uint32_t t = 0; t < threads; t++) {
+        producers.emplace_back([t, records, &ready, &start]() {
+            ready.fetch_add(1);
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (uint32_t i = 0; i < records; i++) {
+                LOG(INFO) << STRESS_TAG << " " << t << " " << i;
+            }
+        });
+    }
+    while (ready.load() != threads) {
+        std::this_thread::yield();
+    }
+
+    uint64_t start_us = TickCountUs();
+    start.store(true);
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+    FlushLog();
+    return TickCountUs() - start_us;
+}
+
+class LogStressTest : public testing::TestWithParam< StressMode > {
+protected:
+    void SetUp() override
+    {
+        saved_ = GetLoggingSettings();
+        SetLogTestDelay(StressYield);
+    }
+
+    void TearDown() override
+    {
+        SetLogTestDelay(nullptr);
+        SetLogMode(LOG_MODE_SYNC, 0);
+        SetLogFileFormat(LOG_FILE_FORMAT_TEXT);
+        SetLogFileCompression(0, 0);
+        SetLogFileUring(0, 0);
+        InitLogging(saved_);
+    }
+
+    LoggingSettings saved_;
+};
+
+// 每个线程数量下写入日志并检查输出, 所有模式都保证不丢失, 不重复, 同一线程按顺序输出.
+// 输出时间戳在持有日志锁时单调递增, 所以单进程的所有模式下都单调不减.
+TEST_P(LogStressTest, ProducersKeepOrder)
+{
+    const StressMode &mode     = GetParam();
+    LoggingSettings   settings = saved_;
+    FilePath          path     = std::string("easelog_stress_") + mode.name + ".log";
+
+    settings.log_min_level  = LOGGING_INFO;
+    settings.log_timestamp  = true;
+    settings.log_dest       = mode.sink == STRESS_SINK_STDERR ? LOG_TO_STDERR : LOG_TO_FILE;
+    settings.log_file_path  = &path;
+    settings.log_mode       = mode.mode;
+    settings.log_async_rate = mode.mode == LOG_MODE_ADAPTIVE ? 1000 : 0;
+
+    for (uint32_t threads : kStressThreads) {
+        unlink(path.c_str());
+        SetLogFileFormat(mode.sink == STRESS_SINK_BINARY || mode.sink == STRESS_SINK_COMPRESSED
+                ? LOG_FILE_FORMAT_BINARY
+                : LOG_FILE_FORMAT_TEXT);
+        SetLogFileCompression(mode.sink == STRESS_SINK_COMPRESSED ? 64 : 0, 2);
+        SetLogFileUring(mode.sink == STRESS_SINK_URING ? 64 : 0, 4);
+        if (mode.sink == STRESS_SINK_STDERR) {
+            testing::internal::CaptureStderr();
+        }
+        ASSERT_TRUE(InitLogging(settings));
+        SetLogMode(mode.mode, settings.log_async_rate);
+        if (mode.sink == STRESS_SINK_URING && !IsLogFileUringActive()) {
+            unlink(path.c_str());
+            GTEST_SKIP() << "io_uring is unavailable";
+        }
+
+        uint64_t elapsed_us = RunStressProducers(threads, STRESS_RECORDS);
+
+        /* 回到同步模式并关闭日志文件, 写入所有缓存的日志 */
+        SetLogMode(LOG_MODE_SYNC, 0);
+        ASSERT_TRUE(InitLogging(saved_));
+        std::string output = mode.sink == STRESS_SINK_STDERR
+            ? testing::internal::GetCapturedStderr()
+            : ReadStressFile(path, mode.sink);
+        unlink(path.c_str());
+
+        StressResult result = VerifyStressOutput(output, threads, STRESS_RECORDS);
+        EXPECT_EQ(result.records, static_cast< uint64_t >(threads) * STRESS_RECORDS)
+            << mode.name << " " << threads << " threads";
+        EXPECT_EQ(result.lost, 0u) << mode.name << " " << threads << " threads";
+        EXPECT_EQ(result.duplicated, 0u) << mode.name << " " << threads << " threads";
+        EXPECT_EQ(result.order_errors, 0u) << mode.name << " " << threads << " threads";
+        EXPECT_EQ(result.time_inversions, 0u) << mode.name << " " << threads << " threads";
+
+        double seconds = static_cast< double >(elapsed_us) / 1000000.0;
+        std::cout << "stress " << mode.name << ": " << threads << " threads, " << result.records
+                  << " records, " << static_cast< double >(result.records) / seconds / 1000.0
+                  << " krecords/s" << std::endl;
+    }
+}
+
+static const StressMode kStressModes[] = {
+    {LOG_MODE_SYNC, STRESS_SINK_STDERR, "sync_stderr"},
+    {LOG_MODE_SYNC, STRESS_SINK_TEXT, "sync_text"},
+    {LOG_MODE_SYNC, STRESS_SINK_BINARY, "sync_binary"},
+    {LOG_MODE_SYNC, STRESS_SINK_COMPRESSED, "sync_compressed"},
+    {LOG_MODE_SYNC, STRESS_SINK_URING, "sync_uring"},
+    {LOG_MODE_ASYNC, STRESS_SINK_STDERR, "async_stderr"},
+    {LOG_MODE_ASYNC, STRESS_SINK_TEXT, "async_text"},
+    {LOG_MODE_ASYNC, STRESS_SINK_BINARY, "async_binary"},
+    {LOG_MODE_ASYNC, STRESS_SINK_COMPRESSED, "async_compressed"},
+    {LOG_MODE_ASYNC, STRESS_SINK_URING, "async_uring"},
+    {LOG_MODE_ADAPTIVE, STRESS_SINK_STDERR, "adaptive_stderr"},
+    {LOG_MODE_ADAPTIVE, STRESS_SINK_TEXT, "adaptive_text"},
+    {LOG_MODE_ADAPTIVE, STRESS_SINK_BINARY, "adaptive_binary"},
+    {LOG_MODE_ADAPTIVE, STRESS_SINK_COMPRESSED, "adaptive_compressed"},
+    {LOG_MODE_ADAPTIVE, STRESS_SINK_URING, "adaptive_uring"},
+};
+
+static std::string StressModeName(const testing::TestParamInfo< StressMode > &param)
+{
+    return param.param.name;
+}
+
+INSTANTIATE_TEST_SUITE_P(AllModes, LogStressTest, testing::ValuesIn(kStressModes), StressModeName);
+
+// 多进程共享内存模式, 每个子进程一个生产者, 由父进程的收集线程合并输出. 队列长时间满时
+// 子进程直接写入, 时间戳只在同一进程内单调, 所以只检查不丢失, 不重复和同一进程的顺序.
+TEST(LogStressShm, ProcessesKeepOrder)
+{
+#if defined(__SANITIZE_THREAD__)
+    GTEST_SKIP() << "ThreadSanitizer doesn't support logging from forked children";
+#endif
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    pid_t           pids[STRESS_PROCESSES];
+
+    settings.log_min_level = LOGGING_INFO;
+    settings.log_timestamp = true;
+    settings.log_dest      = LOG_TO_STDERR;
+    ASSERT_TRUE(InitLogging(settings));
+    testing::internal::CaptureStderr();
+    ASSERT_TRUE(CreateLogSharedMemory(nullptr, STRESS_PROCESSES));
+    ASSERT_TRUE(StartLogCollector());
+
+    uint64_t start_us = TickCountUs();
+    for (uint32_t p = 0; p < STRESS_PROCESSES; p++) {
+        pids[p] = fork();
+        ASSERT_GE(pids[p], 0);
+        if (pids[p] == 0) {
+            for (uint32_t i = 0; i < STRESS_RECORDS; i++) {
+                LOG(INFO) << STRESS_TAG << " " << p << " " << i;
+            }
+            _exit(0);
+        }
+    }
+    for (uint32_t p = 0; p < STRESS_PROCESSES; p++) {
+        int status;
+        ASSERT_EQ(waitpid(pids[p], &status, 0), pids[p]);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    StopLogCollector();
+    uint64_t    elapsed_us = TickCountUs() - start_us;
+    std::string output     = testing::internal::GetCapturedStderr();
+    ASSERT_TRUE(InitLogging(saved));
+
+    StressResult result = VerifyStressOutput(output, STRESS_PROCESSES, STRESS_RECORDS);
+    EXPECT_EQ(result.records, STRESS_PROCESSES * STRESS_RECORDS);
+    EXPECT_EQ(result.lost, 0u);
+    EXPECT_EQ(result.duplicated, 0u);
+    EXPECT_EQ(result.order_errors, 0u);
+
+    double seconds = static_cast< double >(elapsed_us) / 1000000.0;
+    std::cout << "stress shm: " << STRESS_PROCESSES << " processes, " << result.records
+              << " records, " << static_cast< double >(result.records) / seconds / 1000.0
+              << " krecords/s, " << result.time_inversions << " timestamp inversions"
+              << std::endl;
+}
+
+}    // namespace logging
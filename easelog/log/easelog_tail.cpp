@@ -0,0 +1,596 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_tail.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 21:05
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  通过本地Unix套接字实时订阅日志, 每个订阅者有自己的过滤条件和有界缓冲区.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+#define LOG_TAIL_MAX_SUBSCRIBERS 16
+#define LOG_TAIL_BUFFER_SIZE     (256 * 1024)
+#define LOG_TAIL_FILTER_SIZE     1024
+
+// 订阅者状态, 由g_log_tail_mutex保护, 只有服务线程增删订阅者
+struct LogTailSubscriber {
+    int         fd;              // 客户端连接
+    bool        streaming;       // 已经收到过滤条件, 开始接收日志
+    bool        __pad[3];        // 保留字段
+    std::string request;         // 还没有收完的过滤条件
+    std::string file;            // 文件名通配符, 为空时不过滤
+    std::string func;            // 函数名通配符
+    std::string thread;          // 线程名通配符或者线程ID
+    LogSeverity min_severity;    // 最低日志等级, 负数为详细日志等级
+    uint32_t    __pad2;          // 保留字段
+    std::string pending;         // 等待发送的数据, 不超过LOG_TAIL_BUFFER_SIZE
+    size_t      sent;            // pending中已经发送的长度
+    uint64_t    dropped;         // 缓冲区满时丢弃的日志数量
+};
+
+// 有订阅者时为真, 日志热路径只读取这个标记
+std::atomic< bool > g_log_tail_active(false);
+
+// 所有订阅者的最低日志等级, 没有订阅者时为LOGGING_NUM_SEVERITIES
+static std::atomic< int32_t > g_log_tail_min_severity(LOGGING_NUM_SEVERITIES);
+
+static std::mutex                         g_log_tail_mutex;
+static std::vector< LogTailSubscriber * > g_log_tail_subscribers;
+
+// 服务线程和唤醒管道, 生产者追加数据之后通过管道唤醒服务线程
+static std::thread        *g_log_tail_server = nullptr;
+static std::atomic< bool > g_log_tail_stop(false);
+static std::atomic< bool > g_log_tail_wakeup(false);
+static int                 g_log_tail_listen  = -1;
+static int                 g_log_tail_wake[2] = {-1, -1};
+static std::string         g_log_tail_path;
+
+// 填充套接字地址, '@'开头的名字使用抽象命名空间
+static bool InitLogTailAddress(const char *path, struct sockaddr_un *addr, socklen_t *length)
+{
+    size_t size = strlen(path);
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (size == 0 || size >= sizeof(addr->sun_path)) {
+        return false;
+    }
+    memcpy(addr->sun_path, path, size);
+    if (path[0] == '@') {
+        addr->sun_path[0] = '\0';
+    }
+    *length = static_cast< socklen_t >(offsetof(struct sockaddr_un, sun_path) + size);
+    return true;
+}
+
+// 解析日志等级名字, 详细日志等级写作"verboseN"
+static bool ParseLogTailSeverity(const std::string &name, LogSeverity *severity)
+{
+    const LoggingSettings &settings = GetLoggingSettings();
+
+    for (int32_t i = 0; i < LOGGING_NUM_SEVERITIES; i++) {
+        if (name == settings.log_severity_names[i]) {
+            *severity = i;
+            return true;
+        }
+    }
+    if (name.compare(0, 7, "verbose") == 0 && name.size() > 7) {
+        char *end   = nullptr;
+        long  level = strtol(name.c_str() + 7, &end, 10);
+        if (*end == '\0' && level > 0 && level <= 1000) {
+            *severity = -static_cast< LogSeverity >(level);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 解析订阅者发送的过滤条件, 格式为空格分隔的"key=value"
+static bool ParseLogTailFilter(const std::string &request, LogTailSubscriber *subscriber,
+    std::string *error)
+{
+    size_t pos = 0;
+
+    subscriber->min_severity = LOGGING_DEBUG;
+    while (pos < request.size()) {
+        size_t end = request.find(' ', pos);
+        if (end == std::string::npos) {
+            end = request.size();
+        }
+        std::string item  = request.substr(pos, end - pos);
+        size_t      equal = item.find('=');
+        pos               = end + 1;
+        if (item.empty()) {
+            continue;
+        }
+        if (equal == std::string::npos) {
+            *error = "bad item " + item;
+            return false;
+        }
+
+        std::string key   = item.substr(0, equal);
+        std::string value = item.substr(equal + 1);
+        if (key == "severity") {
+            if (!ParseLogTailSeverity(value, &subscriber->min_severity)) {
+                *error = "bad severity " + value;
+                return false;
+            }
+        } else if (key == "file") {
+            subscriber->file = value;
+        } else if (key == "func") {
+            subscriber->func = value;
+        } else if (key == "thread") {
+            subscriber->thread = value;
+        } else {
+            *error = "unknown key " + key;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 重新计算订阅者的汇总状态, 让LOG_IS_ON和VLOG调用点按照新的订阅条件生效.
+// 开始订阅时先置位标记再降低等级, 结束订阅时先恢复等级再清除标记, 多构造的日志
+// 总能在Flush中识别出来. 调用者不能持有g_log_tail_mutex, 加锁顺序为先g_vlog_mutex.
+static void UpdateLogTailLevels()
+{
+    int32_t min_severity = LOGGING_NUM_SEVERITIES;
+    bool    active       = false;
+    {
+        std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+        for (const LogTailSubscriber *subscriber : g_log_tail_subscribers) {
+            if (subscriber->streaming) {
+                min_severity = std::min(min_severity, subscriber->min_severity);
+                active       = true;
+            }
+        }
+    }
+    if (active) {
+        g_log_tail_active.store(true, std::memory_order_seq_cst);
+    }
+    g_log_tail_min_severity.store(min_severity, std::memory_order_relaxed);
+    UpdateLogCreateLevel();
+    InvalidateVlogCallSites();
+    if (!active) {
+        g_log_tail_active.store(false, std::memory_order_seq_cst);
+    }
+}
+
+// export: 订阅者要求的最低日志等级, 没有订阅者时返回LOGGING_NUM_SEVERITIES
+LogSeverity GetLogTailMinSeverity()
+{
+    return g_log_tail_min_severity.load(std::memory_order_relaxed);
+}
+
+// export: 订阅者对文件要求的详细日志等级, 没有要求时返回INT32_MIN
+int32_t GetLogTailVlogLevel(const char *file)
+{
+    const char *base  = strrchr(file, '/');
+    int32_t     level = INT32_MIN;
+
+    base = base ? base + 1 : file;
+    std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+    for (const LogTailSubscriber *subscriber : g_log_tail_subscribers) {
+        if (subscriber->streaming &&
+            (subscriber->file.empty() || MatchVlogPattern(base, subscriber->file.c_str()))) {
+            level = std::max(level, -subscriber->min_severity);
+        }
+    }
+    return level;
+}
+
+// 追加一段数据到订阅者的缓冲区, 空间不足时返回false
+static bool AppendLogTailPending(LogTailSubscriber *subscriber, const char *data, size_t length)
+{
+    if (subscriber->pending.size() - subscriber->sent + length > LOG_TAIL_BUFFER_SIZE) {
+        return false;
+    }
+    if (subscriber->sent > LOG_TAIL_BUFFER_SIZE / 2) {
+        subscriber->pending.erase(0, subscriber->sent);
+        subscriber->sent = 0;
+    }
+    subscriber->pending.append(data, length);
+    return true;
+}
+
+// 唤醒服务线程发送数据, 服务线程处理之前只写一次管道
+static void WakeLogTailServer()
+{
+    if (!g_log_tail_wakeup.exchange(true, std::memory_order_acq_rel)) {
+        ssize_t ret;
+        HANDLE_EINTR(ret, write(g_log_tail_wake[1], "w", 1));
+        (void)ret;
+    }
+}
+
+// export: 发送一行日志给过滤条件匹配的订阅者, 缓冲区满时丢弃并计数
+void LogTailPublish(LogSeverity severity, const char *file, const char *func,
+    const std::string &text)
+{
+    char thread_name[16] = {0};
+    char thread_id[16]   = {0};
+    bool appended        = false;
+
+    std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+    for (LogTailSubscriber *subscriber : g_log_tail_subscribers) {
+        if (!subscriber->streaming || severity < subscriber->min_severity) {
+            continue;
+        }
+        if (!subscriber->file.empty() && !MatchVlogPattern(file, subscriber->file.c_str())) {
+            continue;
+        }
+        if (!subscriber->func.empty() && !MatchVlogPattern(func, subscriber->func.c_str())) {
+            continue;
+        }
+        if (!subscriber->thread.empty()) {
+            if (thread_id[0] == '\0') {
+                pthread_getname_np(pthread_self(), thread_name, sizeof(thread_name));
+                snprintf(thread_id, sizeof(thread_id), "%d", GetLogThreadId());
+            }
+            if (!MatchVlogPattern(thread_name, subscriber->thread.c_str()) &&
+                subscriber->thread != thread_id) {
+                continue;
+            }
+        }
+        if (AppendLogTailPending(subscriber, text.data(), text.size())) {
+            appended = true;
+        } else {
+            subscriber->dropped++;
+        }
+    }
+    if (appended) {
+        WakeLogTailServer();
+    }
+}
+
+// 尽量发送缓冲区中的数据, 发送完之后补上丢弃日志的提示. 连接出错时返回false.
+// 调用者需要持有g_log_tail_mutex.
+static bool SendLogTailPendingLocked(LogTailSubscriber *subscriber)
+{
+    while (subscriber->sent < subscriber->pending.size()) {
+        ssize_t ret;
+        HANDLE_EINTR(ret,
+            send(subscriber->fd, subscriber->pending.data() + subscriber->sent,
+                subscriber->pending.size() - subscriber->sent, MSG_DONTWAIT | MSG_NOSIGNAL));
+        if (ret < 0) {
+            return errno == EAGAIN;
+        }
+        subscriber->sent += static_cast< size_t >(ret);
+        if (subscriber->sent == subscriber->pending.size() && subscriber->dropped != 0) {
+            char note[64];
+            int  size = snprintf(note, sizeof(note), "--- easelog tail: %lu records dropped ---\n",
+                static_cast< unsigned long >(subscriber->dropped));
+            subscriber->dropped = 0;
+            subscriber->pending.append(note, static_cast< size_t >(size));
+        }
+    }
+    subscriber->pending.clear();
+    subscriber->sent = 0;
+    return true;
+}
+
+// 读取订阅者发送的数据, 收到完整的过滤条件后开始订阅. 连接关闭或者出错时返回false.
+// 订阅之后客户端发送的数据直接丢弃. 应答在等级生效之后发出, 客户端收到应答时订阅已经生效.
+static bool ReadLogTailRequest(LogTailSubscriber *subscriber)
+{
+    char    buffer[256];
+    ssize_t ret;
+
+    HANDLE_EINTR(ret, recv(subscriber->fd, buffer, sizeof(buffer), MSG_DONTWAIT));
+    if (ret == 0 || (ret < 0 && errno != EAGAIN)) {
+        return false;
+    }
+    if (ret < 0 || subscriber->streaming) {
+        return true;
+    }
+
+    {
+        std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+        subscriber->request.append(buffer, static_cast< size_t >(ret));
+        size_t newline = subscriber->request.find('\n');
+        if (newline == std::string::npos) {
+            return subscriber->request.size() < LOG_TAIL_FILTER_SIZE;
+        }
+
+        std::string error;
+        subscriber->request.resize(newline);
+        if (!ParseLogTailFilter(subscriber->request, subscriber, &error)) {
+            error = "ERROR " + error + "\n";
+            AppendLogTailPending(subscriber, error.data(), error.size());
+            SendLogTailPendingLocked(subscriber);
+            return false;
+        }
+        // 缓冲区此时为空, 应答总是在日志之前
+        AppendLogTailPending(subscriber, "OK\n", 3);
+        subscriber->streaming = true;
+    }
+    UpdateLogTailLevels();
+    return true;
+}
+
+// 接受新的连接, 订阅者已满时直接关闭
+static void AcceptLogTailSubscriber()
+{
+    int fd = accept4(g_log_tail_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    // 订阅者可以读取所有日志并且修改日志等级, 只接受同一用户和root的连接
+    struct ucred cred;
+    socklen_t    cred_size = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_size) != 0 ||
+        (cred.uid != geteuid() && cred.uid != 0)) {
+        close(fd);
+        return;
+    }
+
+    std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+    if (g_log_tail_subscribers.size() >= LOG_TAIL_MAX_SUBSCRIBERS) {
+        close(fd);
+        return;
+    }
+    LogTailSubscriber *subscriber = new LogTailSubscriber();
+    subscriber->fd                = fd;
+    subscriber->streaming         = false;
+    subscriber->min_severity      = LOGGING_DEBUG;
+    subscriber->sent              = 0;
+    subscriber->dropped           = 0;
+    g_log_tail_subscribers.push_back(subscriber);
+}
+
+// 移除订阅者, 返回订阅者是否已经影响日志等级
+static bool RemoveLogTailSubscriber(LogTailSubscriber *subscriber)
+{
+    bool streaming = subscriber->streaming;
+    {
+        std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+        g_log_tail_subscribers.erase(std::remove(g_log_tail_subscribers.begin(),
+                                         g_log_tail_subscribers.end(), subscriber),
+            g_log_tail_subscribers.end());
+    }
+    close(subscriber->fd);
+    delete subscriber;
+    return streaming;
+}
+
+// 服务线程, 接受连接, 读取过滤条件, 把缓冲区中的日志发送给订阅者
+static void LogTailServerMain()
+{
+    std::vector< struct pollfd >       fds;
+    std::vector< LogTailSubscriber * > subscribers;
+
+    while (!g_log_tail_stop.load(std::memory_order_relaxed)) {
+        fds.assign(2, pollfd());
+        fds[0].fd     = g_log_tail_listen;
+        fds[0].events = POLLIN;
+        fds[1].fd     = g_log_tail_wake[0];
+        fds[1].events = POLLIN;
+        {
+            std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+            subscribers = g_log_tail_subscribers;
+            for (const LogTailSubscriber *subscriber : subscribers) {
+                struct pollfd fd = {subscriber->fd, POLLIN, 0};
+                if (subscriber->sent < subscriber->pending.size()) {
+                    fd.events |= POLLOUT;
+                }
+                fds.push_back(fd);
+            }
+        }
+
+        int ret = poll(fds.data(), fds.size(), 1000);
+        if (ret <= 0) {
+            continue;
+        }
+
+        // 先清除唤醒标记, 之后追加的数据会重新唤醒
+        if (fds[1].revents & POLLIN) {
+            char    buffer[64];
+            ssize_t size;
+            g_log_tail_wakeup.store(false, std::memory_order_release);
+            HANDLE_EINTR(size, read(g_log_tail_wake[0], buffer, sizeof(buffer)));
+            (void)size;
+        }
+
+        bool changed = false;
+        for (size_t i = 0; i < subscribers.size(); i++) {
+            LogTailSubscriber *subscriber = subscribers[i];
+            bool               alive      = true;
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+                alive = ReadLogTailRequest(subscriber);
+            }
+            if (alive) {
+                std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+                alive = SendLogTailPendingLocked(subscriber);
+            }
+            if (!alive) {
+                changed = RemoveLogTailSubscriber(subscriber) || changed;
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            AcceptLogTailSubscriber();
+        }
+        if (changed) {
+            UpdateLogTailLevels();
+        }
+    }
+}
+
+// 删除上次遗留的套接字文件, 路径存在但不是套接字时返回false
+static bool RemoveStaleLogTailSocket(const char *path)
+{
+    struct stat st;
+    if (lstat(path, &st) != 0) {
+        return errno == ENOENT;
+    }
+    return S_ISSOCK(st.st_mode) && (unlink(path) == 0 || errno == ENOENT);
+}
+
+// export: 启动实时订阅服务
+bool StartLogTail(const char *path)
+{
+    static bool g_log_tail_atexit = false;
+
+    struct sockaddr_un addr;
+    socklen_t          length;
+
+    if (g_log_tail_server != nullptr || !InitLogTailAddress(path, &addr, &length)) {
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (path[0] != '@' && !RemoveStaleLogTailSocket(path)) {
+        close(fd);
+        return false;
+    }
+    // 套接字文件只允许当前用户连接, 在listen之前修改权限, 其他用户没有机会连接
+    if (bind(fd, reinterpret_cast< struct sockaddr * >(&addr), length) != 0 ||
+        (path[0] != '@' && chmod(path, S_IRUSR | S_IWUSR) != 0) ||
+        listen(fd, LOG_TAIL_MAX_SUBSCRIBERS) != 0 ||
+        pipe2(g_log_tail_wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        close(fd);
+        return false;
+    }
+
+    g_log_tail_listen = fd;
+    g_log_tail_path   = path;
+    g_log_tail_stop.store(false, std::memory_order_relaxed);
+    g_log_tail_wakeup.store(false, std::memory_order_relaxed);
+    g_log_tail_server = new std::thread(LogTailServerMain);
+    if (!g_log_tail_atexit) {
+        atexit(StopLogTail);
+        g_log_tail_atexit = true;
+    }
+    return true;
+}
+
+// export: 停止实时订阅服务, 断开所有订阅者
+void StopLogTail()
+{
+    if (g_log_tail_server == nullptr) {
+        return;
+    }
+
+    g_log_tail_stop.store(true, std::memory_order_relaxed);
+    g_log_tail_wakeup.store(true, std::memory_order_relaxed);
+    ssize_t ret;
+    HANDLE_EINTR(ret, write(g_log_tail_wake[1], "w", 1));
+    (void)ret;
+    g_log_tail_server->join();
+    delete g_log_tail_server;
+    g_log_tail_server = nullptr;
+
+    {
+        std::lock_guard< std::mutex > lock(g_log_tail_mutex);
+        for (LogTailSubscriber *subscriber : g_log_tail_subscribers) {
+            SendLogTailPendingLocked(subscriber);
+            close(subscriber->fd);
+            delete subscriber;
+        }
+        g_log_tail_subscribers.clear();
+    }
+    UpdateLogTailLevels();
+
+    close(g_log_tail_listen);
+    close(g_log_tail_wake[0]);
+    close(g_log_tail_wake[1]);
+    g_log_tail_listen  = -1;
+    g_log_tail_wake[0] = -1;
+    g_log_tail_wake[1] = -1;
+    if (g_log_tail_path[0] != '@') {
+        unlink(g_log_tail_path.c_str());
+    }
+    g_log_tail_path.clear();
+}
+
+// export: 连接实时订阅服务并发送过滤条件, 服务端确认之后返回连接, 失败时返回-1
+int ConnectLogTail(const char *path, const char *filter)
+{
+    struct sockaddr_un addr;
+    socklen_t          length;
+    std::string        request(filter != nullptr ? filter : "");
+    std::string        reply;
+
+    if (!InitLogTailAddress(path, &addr, &length)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast< struct sockaddr * >(&addr), length) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    request += '\n';
+    ssize_t ret;
+    HANDLE_EINTR(ret, send(fd, request.data(), request.size(), MSG_NOSIGNAL));
+    if (ret != static_cast< ssize_t >(request.size())) {
+        close(fd);
+        return -1;
+    }
+
+    // 逐个字节读取应答, 不读取应答之后的日志
+    char c = '\0';
+    while (reply.size() < LOG_TAIL_FILTER_SIZE) {
+        HANDLE_EINTR(ret, read(fd, &c, 1));
+        if (ret != 1 || c == '\n') {
+            break;
+        }
+        reply += c;
+    }
+    if (c != '\n' || reply != "OK") {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// export: fork之后在子进程中调用, 服务线程不会被复制到子进程, 放弃继承的订阅者
+void ResetLogTailAfterFork()
+{
+    new (&g_log_tail_mutex) std::mutex();
+    new (&g_log_tail_subscribers) std::vector< LogTailSubscriber * >();
+    g_log_tail_server = nullptr;
+    g_log_tail_min_severity.store(LOGGING_NUM_SEVERITIES, std::memory_order_relaxed);
+    UpdateLogCreateLevel();
+    // vlog锁已经在ResetVlogAfterFork()中重新初始化
+    InvalidateVlogCallSites();
+    g_log_tail_active.store(false, std::memory_order_relaxed);
+}
+
+}    // namespace logging
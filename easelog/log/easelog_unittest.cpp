@@ -17,14 +17,22 @@
 #include "log/easelog_private.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
 #include <signal.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <ucontext.h>
 
+#include <iomanip>
 #include <sstream>
 #include <string>
 #include <optional>
 #include <thread>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -61,6 +69,1606 @@ TEST(LoggingTestBase, BasicLoggingLog)
     LOG_IF(INFO, false) << mock_log_source.Log();
 }
 
+// 测试限流和采样日志宏, 被抑制的调用不会对参数求值
+TEST(LoggingTestBase, RateLimitedLogging)
+{
+    MockLogSource mock_log_source;
+
+    // LOG_EVERY_N: 4, LOG_FIRST_N: 3, LOG_EVERY_T: 1, LOG_SAMPLED(1.0): 10
+    int32_t expected_logs = 4 + 3 + 1 + 10;
+
+    EXPECT_CALL(mock_log_source, Log())
+        .Times(expected_logs)
+        .WillRepeatedly(Return("rate limited log message test"));
+
+    SetMinLogLevel(LOGGING_INFO);
+    for (int i = 0; i < 10; i++) {
+        LOG_EVERY_N(INFO, 3) << mock_log_source.Log();
+        LOG_FIRST_N(INFO, 3) << mock_log_source.Log();
+        LOG_EVERY_T(INFO, 3600) << mock_log_source.Log();
+        LOG_SAMPLED(INFO, 1.0) << mock_log_source.Log();
+        LOG_SAMPLED(INFO, 0.0) << mock_log_source.Log();
+        /* 条件为假或者等级未开启, 不会产生调用次数 */
+        LOG_IF_EVERY_N(INFO, false, 1) << mock_log_source.Log();
+        LOG_IF_FIRST_N(INFO, i < 0, 100) << mock_log_source.Log();
+        LOG_EVERY_N(DEBUG, 1) << mock_log_source.Log();
+    }
+}
+
+// 采样日志的输出比例应该接近指定概率
+TEST(LoggingTestBase, SampledLoggingRatio)
+{
+    int32_t hits = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        if (LogSampledShouldLog(0.25)) {
+            hits++;
+        }
+    }
+    EXPECT_GT(hits, 23000);
+    EXPECT_LT(hits, 27000);
+}
+
+// 同一个VLOG调用点, 用于验证配置变化后调用点会重新解析
+static void VlogFromOneCallSite(MockLogSource &mock_log_source, int32_t verbose_level)
+{
+    VLOG(verbose_level) << mock_log_source.Log();
+}
+
+// 同一个VLOG_IS_ON调用点, 用于验证InitLogging之后调用点会重新解析
+static bool VlogTwoIsOn()
+{
+    return VLOG_IS_ON(2);
+}
+
+// 测试VLOG和vmodule配置
+TEST(LoggingTestBase, VerboseLogging)
+{
+    MockLogSource mock_log_source;
+
+    // vmodule=2: VLOG(1), VLOG(2), 恢复默认后: 0, SetVlogLevel(1): VLOG(1)
+    int32_t expected_logs = 2 + 0 + 1;
+
+    EXPECT_CALL(mock_log_source, Log())
+        .Times(expected_logs)
+        .WillRepeatedly(Return("verbose log message test"));
+
+    SetMinLogLevel(LOGGING_INFO);
+    EXPECT_FALSE(VLOG_IS_ON(1));
+
+    SetVmodule("foo=1,easelog_unit*=2");
+    EXPECT_EQ(GetVlogLevel(__FILE__), 2);
+    EXPECT_TRUE(VLOG_IS_ON(2));
+    EXPECT_FALSE(VLOG_IS_ON(3));
+    for (int32_t level = 1; level <= 3; level++) {
+        VlogFromOneCallSite(mock_log_source, level);
+    }
+
+    /* 清除vmodule配置, 调用点缓存失效后重新解析 */
+    SetVmodule("");
+    EXPECT_FALSE(VLOG_IS_ON(1));
+    VlogFromOneCallSite(mock_log_source, 1);
+
+    /* 默认详细日志等级通过最小日志等级设置 */
+    SetVlogLevel(1);
+    EXPECT_EQ(GetMinLogLevel(), -1);
+    VlogFromOneCallSite(mock_log_source, 1);
+    VlogFromOneCallSite(mock_log_source, 2);
+    VLOG_IF(1, false) << mock_log_source.Log();
+    SetMinLogLevel(LOGGING_INFO);
+
+    /* InitLogging修改最小日志等级时, 已经缓存的调用点也重新解析 */
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    EXPECT_FALSE(VlogTwoIsOn());
+    settings.log_min_level = -2;
+    ASSERT_TRUE(InitLogging(settings));
+    EXPECT_EQ(GetVlogLevel(__FILE__), 2);
+    EXPECT_TRUE(VlogTwoIsOn());
+    ASSERT_TRUE(InitLogging(saved));
+    EXPECT_FALSE(VlogTwoIsOn());
+}
+
+// 第一次解析VLOG调用点时持有vlog锁等待, 直到测试放开
+static std::atomic< bool > g_vlog_hold(false);
+static std::atomic< bool > g_vlog_held(false);
+
+static void HoldVlogMutex(uint32_t point)
+{
+    if (point == LOG_TEST_POINT_VLOG && g_vlog_hold.exchange(false)) {
+        g_vlog_held.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+}
+
+// fork时其他线程持有vlog锁, 子进程中重新解析VLOG调用点不会死锁
+TEST(LoggingTestBase, VlogAfterFork)
+{
+    InitLoggingQueue();
+    InvalidateVlogCallSites();
+    SetLogTestDelay(HoldVlogMutex);
+    g_vlog_hold.store(true);
+    std::thread holder([]() { EXPECT_FALSE(VlogTwoIsOn()); });
+    while (!g_vlog_held.load()) {
+        std::this_thread::yield();
+    }
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        /* 死锁时由SIGALRM结束子进程 */
+        alarm(5);
+        _exit(VlogTwoIsOn() ? 1 : 0);
+    }
+    holder.join();
+    SetLogTestDelay(nullptr);
+    g_vlog_held.store(false);
+
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+// 测试vmodule通配符匹配
+TEST(LoggingTestBase, VlogPatternMatch)
+{
+    EXPECT_TRUE(MatchVlogPattern("easelog_unittest", "easelog_unittest"));
+    EXPECT_TRUE(MatchVlogPattern("easelog_unittest", "easelog*"));
+    EXPECT_TRUE(MatchVlogPattern("easelog_unittest", "*unit*"));
+    EXPECT_TRUE(MatchVlogPattern("easelog_unittest", "ease?og_*test"));
+    EXPECT_TRUE(MatchVlogPattern("/src/net/rpc/channel.cpp", "*/net/*"));
+    EXPECT_FALSE(MatchVlogPattern("easelog_unittest", "easelog"));
+    EXPECT_FALSE(MatchVlogPattern("easelog_unittest", "*prefix*"));
+    EXPECT_FALSE(MatchVlogPattern("", "?"));
+    EXPECT_TRUE(MatchVlogPattern("", "*"));
+}
+
+// 测试backtrace模式, ERROR日志之前输出最近被抑制的DEBUG日志
+TEST(LoggingTestBase, BacktraceOnError)
+{
+    SetMinLogLevel(LOGGING_INFO);
+    SetLogBacktrace(4, LOGGING_ERROR);
+    EXPECT_TRUE(LOG_IS_ON(DEBUG));
+
+    testing::internal::CaptureStderr();
+    for (int i = 0; i < 6; i++) {
+        LOG(DEBUG) << "backtrace debug record " << i;
+    }
+    LOG(INFO) << "backtrace info record";
+    LOG(ERROR) << "backtrace error record";
+    LOG(ERROR) << "backtrace second error record";
+    std::string output = testing::internal::GetCapturedStderr();
+    SetLogBacktrace(0, LOGGING_ERROR);
+    EXPECT_FALSE(LOG_IS_ON(DEBUG));
+
+    /* 只保留最近的4条DEBUG日志, 按照原始顺序输出在ERROR日志之前 */
+    EXPECT_EQ(output.find("backtrace debug record 1"), std::string::npos);
+    size_t info  = output.find("backtrace info record");
+    size_t begin = output.find("backtrace begin: 4 suppressed records");
+    size_t first = output.find("backtrace debug record 2");
+    size_t last  = output.find("backtrace debug record 5");
+    size_t error = output.find("backtrace error record");
+    ASSERT_NE(begin, std::string::npos);
+    EXPECT_LT(info, begin);
+    EXPECT_LT(begin, first);
+    EXPECT_LT(first, last);
+    EXPECT_LT(last, error);
+    /* 捕获的日志在输出缓存时才生成前缀, 格式和直接输出的日志相同 */
+    size_t      line_start = output.rfind('\n', first) + 1;
+    std::string prefix     = output.substr(line_start, first - line_start);
+    EXPECT_NE(prefix.find("<debug> "), std::string::npos);
+    EXPECT_NE(prefix.find("easelog_unittest.cpp(TestBody-"), std::string::npos);
+    /* 缓存输出后清空, 第二条ERROR日志不会重复输出 */
+    EXPECT_EQ(output.find("backtrace begin", begin + 1), std::string::npos);
+}
+
+// 测试线程日志上下文, 嵌套的上下文按顺序输出, 捕获的上下文可以在其他线程恢复
+TEST(LoggingTestBase, ScopedLogContext)
+{
+    LogContext captured;
+
+    SetMinLogLevel(LOGGING_INFO);
+    testing::internal::CaptureStderr();
+    {
+        ScopedLogContext req("req", 42);
+        LOG(INFO) << "context outer record";
+        {
+            ScopedLogContext span("span", std::string("a1"));
+            LOG(INFO) << "context inner record";
+            captured = CaptureLogContext();
+        }
+        LOG(INFO) << "context outer again record";
+
+        /* 工作线程恢复捕获的上下文, 结束后回到线程自己的上下文 */
+        std::thread worker([&captured] {
+            ScopedLogContext local("worker", 1);
+            {
+                ScopedLogContext restore(captured);
+                LOG(INFO) << "context task record";
+            }
+            LOG(INFO) << "context worker record";
+        });
+        worker.join();
+    }
+    LOG(INFO) << "context none record";
+    std::string output = testing::internal::GetCapturedStderr();
+
+    EXPECT_NE(output.find("[req=42] context outer record"), std::string::npos) << output;
+    EXPECT_NE(output.find("[req=42] [span=a1] context inner record"), std::string::npos);
+    EXPECT_NE(output.find("[req=42] context outer again record"), std::string::npos);
+    EXPECT_NE(output.find("[req=42] [span=a1] context task record"), std::string::npos);
+    EXPECT_NE(output.find("] [worker=1] context worker record"), std::string::npos);
+    EXPECT_NE(output.find(")] context none record"), std::string::npos);
+    EXPECT_EQ(captured.rendered, "[req=42] [span=a1] ");
+}
+
+// 测试命名日志对象, 日志等级按照名字前缀分层设置, 不影响全局日志等级
+TEST(LoggingTestBase, NamedLoggers)
+{
+    static Logger wal_logger("storage.wal");
+    static Logger rpc_logger("net.rpc");
+    Logger        other_logger("storagex");
+
+    SetMinLogLevel(LOGGING_INFO);
+    EXPECT_FALSE(wal_logger.IsOn(LOGGING_DEBUG));
+    EXPECT_TRUE(rpc_logger.IsOn(LOGGING_INFO));
+
+    SetLoggerLevel("storage", LOGGING_DEBUG);
+    SetLoggerLevel("", LOGGING_WARNING);
+    EXPECT_TRUE(wal_logger.IsOn(LOGGING_DEBUG));
+    EXPECT_FALSE(rpc_logger.IsOn(LOGGING_INFO));
+    EXPECT_FALSE(other_logger.IsOn(LOGGING_INFO));
+    EXPECT_FALSE(LOG_IS_ON(DEBUG));
+
+    testing::internal::CaptureStderr();
+    LOG_TO(wal_logger, DEBUG) << "logger wal debug record";
+    LOG_TO(rpc_logger, INFO) << "logger rpc info record";
+    LOG_TO(rpc_logger, WARNING) << "logger rpc warning record";
+    LOG(DEBUG) << "logger global debug record";
+    std::string output = testing::internal::GetCapturedStderr();
+
+    EXPECT_NE(output.find("logger wal debug record"), std::string::npos) << output;
+    EXPECT_EQ(output.find("logger rpc info record"), std::string::npos);
+    EXPECT_NE(output.find("logger rpc warning record"), std::string::npos);
+    EXPECT_EQ(output.find("logger global debug record"), std::string::npos);
+
+    /* 移除规则后回到全局日志等级, 全局日志等级变化时同步更新 */
+    ClearLoggerLevel("storage");
+    ClearLoggerLevel("");
+    EXPECT_FALSE(wal_logger.IsOn(LOGGING_DEBUG));
+    EXPECT_TRUE(rpc_logger.IsOn(LOGGING_INFO));
+    SetMinLogLevel(LOGGING_ERROR);
+    EXPECT_FALSE(rpc_logger.IsOn(LOGGING_WARNING));
+    SetMinLogLevel(LOGGING_INFO);
+    EXPECT_TRUE(rpc_logger.IsOn(LOGGING_INFO));
+}
+
+// 测试转义查找, 所有CPU支持的实现和逐字节实现的结果相同
+TEST(LoggingTestBase, EscapeKernels)
+{
+    std::string data(300, 'a');
+    uint32_t    flags[] = {LOG_ESCAPE_CONTROL, LOG_ESCAPE_CONTROL | LOG_ESCAPE_QUOTE,
+        LOG_ESCAPE_CONTROL | LOG_ESCAPE_HIGH, LOG_ESCAPE_CONTROL | LOG_ESCAPE_TAB};
+    const char  specials[] = {'\n', '\t', '\x01', '\x1f', '\x7f', '"', '\\', '\x80', '\xff', ' ',
+        '~'};
+
+    for (uint32_t kernel = LOG_ESCAPE_KERNEL_SCALAR; kernel <= GetLogEscapeKernel(); kernel++) {
+        for (size_t pos = 0; pos < 70; pos++) {
+            for (char special : specials) {
+                for (uint32_t flag : flags) {
+                    data[pos] = special;
+                    size_t expect = FindLogEscape(data.data() + 1, data.size() - 1, flag,
+                        LOG_ESCAPE_KERNEL_SCALAR);
+                    EXPECT_EQ(FindLogEscape(data.data() + 1, data.size() - 1, flag, kernel),
+                        expect) << "kernel " << kernel << " pos " << pos;
+                    data[pos] = 'a';
+                }
+            }
+        }
+    }
+
+    /* 清理日志内容时制表符不需要转义 */
+    data = "tab\tonly";
+    EXPECT_EQ(FindLogEscape(data.data(), data.size(), LOG_ESCAPE_CONTROL | LOG_ESCAPE_TAB,
+                  GetLogEscapeKernel()),
+        data.size());
+    EXPECT_EQ(FindLogEscape(data.data(), data.size(), LOG_ESCAPE_CONTROL, GetLogEscapeKernel()),
+        3u);
+}
+
+// 测试日志内容转义, 换行符和控制字符转义后每条日志只有一行, 非法UTF-8字节转义
+TEST(LoggingTestBase, SanitizeLogMessage)
+{
+    SetMinLogLevel(LOGGING_INFO);
+    SetLogSanitize(LOG_SANITIZE_CONTROL | LOG_SANITIZE_UTF8);
+    testing::internal::CaptureStderr();
+    LOG(INFO) << "sanitize first\nline\r\x1b[31m\ttab " << std::string(40, 'x');
+    LOG(INFO) << "sanitize utf8 \xe4\xb8\xad \xc3\x28 \xed\xa0\x80 \xf0\x9f\x98\x80";
+    LOG(INFO) << "sanitize clean record";
+    SetLogSanitize(LOG_SANITIZE_NONE);
+    LOG(INFO) << "sanitize off\nrecord";
+    std::string output = testing::internal::GetCapturedStderr();
+
+    EXPECT_NE(output.find("sanitize first\\nline\\r\\x1b[31m\ttab xxxx"), std::string::npos)
+        << output;
+    EXPECT_NE(output.find("sanitize utf8 \xe4\xb8\xad \\xc3( \\xed\\xa0\\x80 \xf0\x9f\x98\x80\n"),
+        std::string::npos);
+    EXPECT_NE(output.find("sanitize clean record\n"), std::string::npos);
+    EXPECT_NE(output.find("sanitize off\nrecord\n"), std::string::npos);
+
+    /* JSON字符串转义 */
+    std::string json;
+    std::string text = std::string(20, 'j') + "\"q\" \\ \n\t\x01\x7f end";
+    AppendLogJsonEscaped(json, text.data(), text.size());
+    EXPECT_EQ(json, std::string(20, 'j') + "\\\"q\\\" \\\\ \\n\\t\\u0001\x7f end");
+
+    /* 非法UTF-8字节替换为U+FFFD, 合法的多字节字符原样保留 */
+    json.clear();
+    text = "utf8 \xe4\xb8\xad \xc3\x28 \xed\xa0\x80 \xf0\x9f\x98\x80 \xff";
+    AppendLogJsonEscaped(json, text.data(), text.size());
+    EXPECT_EQ(json, "utf8 \xe4\xb8\xad \\ufffd( \\ufffd\\ufffd\\ufffd \xf0\x9f\x98\x80 \\ufffd");
+}
+
+// 用于测试日志流的自定义类型, 通过std::ostream适配器输出
+struct LogStreamPoint {
+    int32_t x;
+    int32_t y;
+};
+
+static std::ostream &operator<<(std::ostream &stream, const LogStreamPoint &point)
+{
+    return stream << "(" << point.x << ", " << point.y << ")";
+}
+
+// 测试日志流格式化, 内置类型的输出和std::ostream一致, 操纵符和自定义类型交给适配器
+TEST(LoggingTestBase, LogStreamFormatting)
+{
+    LogStream          stream;
+    std::ostringstream expect;
+    int64_t            integers[] = {0, 7, -7, 10, 99, 100, -12345, 1000000007, INT64_MAX,
+        INT64_MIN};
+    double             doubles[]  = {0.0, -0.5, 3.14159265, 1e-7, 123456789.0, 1e300};
+
+    for (int64_t value : integers) {
+        stream << value << ' ';
+        expect << value << ' ';
+    }
+    stream << UINT64_MAX << ' ' << static_cast< short >(-3) << ' ' << 42u << ' ' << true;
+    expect << UINT64_MAX << ' ' << static_cast< short >(-3) << ' ' << 42u << ' ' << true;
+    for (double value : doubles) {
+        stream << ' ' << value << ' ' << static_cast< float >(value);
+        expect << ' ' << value << ' ' << static_cast< float >(value);
+    }
+    EXPECT_EQ(stream.buffer(), expect.str());
+
+    /* 操纵符修改格式之后使用适配器, 恢复之后重新直接格式化 */
+    LogStream      formatted;
+    LogStreamPoint point = {3, -4};
+    formatted << std::hex << 255 << ' ' << std::setw(6) << std::setfill('0') << 42 << std::dec
+              << std::setfill(' ') << ' ' << 255 << ' ' << point << ' '
+              << static_cast< const char * >(nullptr) << std::endl;
+    EXPECT_EQ(formatted.buffer(), "ff 00002a 255 (3, -4) (null)\n");
+
+    LogStream   pointer;
+    const void *address = reinterpret_cast< const void * >(0x1234abcdUL);
+    pointer << address << ' ' << static_cast< const void * >(nullptr);
+    EXPECT_EQ(pointer.buffer(), "0x1234abcd 0");
+}
+
+// 统计子字符串出现的次数
+static size_t CountSubstring(const std::string &text, const std::string &pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos        = text.find(pattern, pos + pattern.size())) {
+        count++;
+    }
+    return count;
+}
+
+// 读取整个日志文件, 文件不存在时返回空字符串
+static std::string ReadLogFile(const FilePath &path)
+{
+    FILE       *file = fopen(path.c_str(), "r");
+    std::string content;
+    char        buffer[4096];
+    size_t      length;
+
+    if (file == nullptr) {
+        return content;
+    }
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, length);
+    }
+    fclose(file);
+    return content;
+}
+
+// 测试重复日志合并, 同一调用点相同内容的连续日志只输出一次
+TEST(LoggingTestBase, CoalesceRepeatedLogging)
+{
+    SetMinLogLevel(LOGGING_INFO);
+    SetLogDedup(60000, 0);
+
+    testing::internal::CaptureStderr();
+    for (int i = 0; i < 5; i++) {
+        LOG(INFO) << "dedup repeated record";
+    }
+    for (int i = 0; i < 2; i++) {
+        LOG(INFO) << "dedup distinct record " << i;
+    }
+    /* 限制单条合并记录的最大重复次数 */
+    SetLogDedup(60000, 2);
+    for (int i = 0; i < 6; i++) {
+        LOG(INFO) << "dedup limited record";
+    }
+    SetLogDedup(0, 0);
+    LOG(INFO) << "dedup disabled record";
+    std::string output = testing::internal::GetCapturedStderr();
+
+    EXPECT_EQ(CountSubstring(output, "dedup repeated record"), 1u);
+    EXPECT_EQ(CountSubstring(output, "last message repeated 4 times"), 1u);
+    EXPECT_LT(output.find("last message repeated 4 times"), output.find("dedup distinct record 0"));
+    EXPECT_EQ(CountSubstring(output, "dedup distinct record"), 2u);
+    EXPECT_EQ(CountSubstring(output, "dedup limited record"), 2u);
+    EXPECT_EQ(CountSubstring(output, "last message repeated 2 times"), 2u);
+    EXPECT_LT(output.rfind("last message repeated 2 times"), output.find("dedup disabled record"));
+}
+
+// 测试FlushLog和进程退出时输出等待中的合并记录, 合并记录输出到重复日志的目的地
+TEST(LoggingTestBase, FlushRepeatedLogging)
+{
+    SetMinLogLevel(LOGGING_INFO);
+    LoggingSettings saved = GetLoggingSettings();
+    SetLogDedup(60000, 0);
+    testing::internal::CaptureStderr();
+    for (int i = 0; i < 5; i++) {
+        LOG(INFO) << "dedup flushed record";
+    }
+    FlushLog();
+    std::string flushed = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(CountSubstring(flushed, "dedup flushed record"), 1u);
+    EXPECT_EQ(CountSubstring(flushed, "last message repeated 4 times"), 1u);
+
+    /* 不同线程的相同日志不合并, 保留各自的线程ID */
+    testing::internal::CaptureStderr();
+    for (int i = 0; i < 2; i++) {
+        std::thread([]() { LOG(INFO) << "dedup thread record"; }).join();
+    }
+    FlushLog();
+    flushed = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(CountSubstring(flushed, "dedup thread record"), 2u);
+    EXPECT_EQ(CountSubstring(flushed, "last message repeated"), 0u);
+
+    /* 正常退出时输出最后一个重复序列 */
+    testing::internal::CaptureStderr();
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        for (int i = 0; i < 3; i++) {
+            LOG(INFO) << "dedup exit record";
+        }
+        exit(0);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    std::string exited = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(CountSubstring(exited, "dedup exit record"), 1u);
+    EXPECT_EQ(CountSubstring(exited, "last message repeated 2 times"), 1u);
+
+    /* ERROR日志同时输出到stderr, 之后的INFO日志只写入文件, 合并记录仍然输出到stderr */
+    LoggingSettings settings = GetLoggingSettings();
+    FilePath        path     = "easelog_dedup_unittest.log";
+    unlink(path.c_str());
+    settings.log_dest         = LOG_TO_FILE;
+    settings.log_file_path    = &path;
+    settings.log_always_print = LOGGING_ERROR;
+    ASSERT_TRUE(InitLogging(settings));
+    testing::internal::CaptureStderr();
+    for (int i = 0; i < 3; i++) {
+        LOG(ERROR) << "dedup error record";
+    }
+    LOG(INFO) << "dedup file only record";
+    std::string output = testing::internal::GetCapturedStderr();
+    SetLogDedup(0, 0);
+    ASSERT_TRUE(InitLogging(saved));
+    std::string content = ReadLogFile(path);
+    unlink(path.c_str());
+    EXPECT_EQ(CountSubstring(output, "last message repeated 2 times"), 1u);
+    EXPECT_EQ(CountSubstring(output, "dedup file only record"), 0u);
+    EXPECT_EQ(CountSubstring(content, "last message repeated 2 times"), 1u);
+    EXPECT_EQ(CountSubstring(content, "dedup file only record"), 1u);
+}
+
+// 测试异步信号安全的格式化函数
+TEST(LoggingTestBase, RawLogFormat)
+{
+    char   buffer[64];
+    size_t length;
+
+    length = RawLogFormat(buffer, sizeof(buffer), "%d %i %u %x %X %o %c %s %%", -42, 7, 42u,
+        0xbeefu, 0xbeefu, 8u, 'c', "str");
+    EXPECT_STREQ(buffer, "-42 7 42 beef BEEF 10 c str %");
+    EXPECT_EQ(length, strlen(buffer));
+
+    RawLogFormat(buffer, sizeof(buffer), "[%5d][%-5d][%05d][%05d][%.2s]", 42, 42, 42, -42, "abc");
+    EXPECT_STREQ(buffer, "[   42][42   ][00042][-0042][ab]");
+
+    RawLogFormat(buffer, sizeof(buffer), "%ld %lld %zu %llu", -1L, -9223372036854775807LL - 1,
+        static_cast< size_t >(123), 18446744073709551615ULL);
+    EXPECT_STREQ(buffer, "-1 -9223372036854775808 123 18446744073709551615");
+
+    RawLogFormat(buffer, sizeof(buffer), "%p", reinterpret_cast< void * >(0x1234));
+    EXPECT_STREQ(buffer, "0x1234");
+
+    /* 超出缓冲区时截断, 保证以'\0'结尾 */
+    length = RawLogFormat(buffer, 8, "%s", "truncated string");
+    EXPECT_EQ(length, 7u);
+    EXPECT_STREQ(buffer, "truncat");
+}
+
+// 测试RAW_LOG输出
+TEST(LoggingTestBase, RawLogging)
+{
+    SetMinLogLevel(LOGGING_INFO);
+
+    testing::internal::CaptureStderr();
+    RAW_LOG(INFO, "raw log message %d %s", 42, "test");
+    RAW_LOG(DEBUG, "raw log suppressed");
+    std::string output = testing::internal::GetCapturedStderr();
+
+    EXPECT_NE(output.find("<info>"), std::string::npos);
+    EXPECT_NE(output.find("easelog_unittest.cpp("), std::string::npos);
+    EXPECT_NE(output.find("RAW: raw log message 42 test\n"), std::string::npos);
+    EXPECT_EQ(output.find("raw log suppressed"), std::string::npos);
+}
+
+// 测试崩溃信号处理函数, 输出信号信息和调用栈后按默认方式结束进程
+TEST(CheckDeathTest, FailureSignalHandler)
+{
+    EXPECT_DEATH(
+        {
+            InstallFailureSignalHandler();
+            raise(SIGSEGV);
+        },
+        "SIGSEGV .* received by PID");
+}
+
+// 测试LOG_IS_ON内联过滤等级随配置更新
+TEST(LoggingTestBase, LogIsOnGate)
+{
+    SetMinLogLevel(LOGGING_WARNING);
+    EXPECT_FALSE(LOG_IS_ON(INFO));
+    EXPECT_TRUE(LOG_IS_ON(WARNING));
+
+    /* 开启backtrace时低等级日志也需要构造 */
+    SetLogBacktrace(8, LOGGING_ERROR);
+    EXPECT_TRUE(LOG_IS_ON(DEBUG));
+    SetLogBacktrace(0, LOGGING_ERROR);
+    EXPECT_FALSE(LOG_IS_ON(DEBUG));
+
+    SetMinLogLevel(LOGGING_INFO);
+    EXPECT_TRUE(LOG_IS_ON(INFO));
+    EXPECT_EQ(LOG_IS_ON(INFO), ShouldCreateLogMessage(LOGGING_INFO));
+}
+
+// 测试CHECK宏成功路径, 操作数只求值一次, 失败消息不会被求值
+TEST(LoggingTestBase, CheckMacros)
+{
+    MockLogSource mock_log_source;
+    int           value = 0;
+
+    EXPECT_CALL(mock_log_source, Log()).Times(0);
+
+    CHECK(++value == 1) << mock_log_source.Log();
+    CHECK_EQ(++value, 2) << mock_log_source.Log();
+    CHECK_NE(value, 0);
+    CHECK_LE(value, 2);
+    CHECK_LT(value, 3);
+    CHECK_GE(value, 2);
+    CHECK_GT(value, 1);
+    CHECK_EQ(std::string("abc"), "abc");
+    PCHECK(value == 2) << mock_log_source.Log();
+    EXPECT_EQ(value, 2);
+
+    /* CHECK_op是单条语句, 不会吞掉后面的else分支 */
+    if (value == 0)
+        CHECK_EQ(value, 0);
+    else
+        value++;
+    EXPECT_EQ(value, 3);
+
+    DCHECK(value == 3);
+    DCHECK_EQ(value, 3) << mock_log_source.Log();
+#if !DCHECK_IS_ON()
+    /* 关闭DCHECK时条件不会被求值 */
+    DCHECK(++value == 0);
+    EXPECT_EQ(value, 3);
+#endif
+}
+
+// 测试CHECK失败时输出条件, 操作数和errno描述后结束进程
+TEST(CheckDeathTest, CheckFailure)
+{
+    EXPECT_DEATH(CHECK(1 + 1 == 3) << "extra message",
+        "Check failed: 1 \\+ 1 == 3\\. extra message");
+
+    int value = 4;
+    EXPECT_DEATH(CHECK_EQ(value, 5) << "compare",
+        "Check failed: value == 5 \\(4 vs\\. 5\\)\\. compare");
+    EXPECT_DEATH(CHECK_GT(std::string("a"), "b"),
+        "Check failed: .* > \"b\" \\(a vs\\. b\\)");
+
+    EXPECT_DEATH(
+        {
+            errno = ENOENT;
+            PCHECK(value == 0);
+        },
+        "Check failed: value == 0\\. No such file or directory \\(2\\)");
+    EXPECT_DEATH(
+        {
+            errno = ENOENT;
+            PCHECK(value == 0) << "open";
+        },
+        "Check failed: value == 0\\. open: No such file or directory \\(2\\)");
+}
+
+// 线程退出时释放日志记录内存, 在slab线程缓存析构之后析构
+struct LogSlabExitFree {
+    ~LogSlabExitFree()
+    {
+        if (ptr != nullptr) {
+            LogSlabFree(ptr);
+        }
+    }
+    void *ptr;
+};
+static thread_local LogSlabExitFree g_slab_exit_free;
+
+// 测试日志记录内存分配器: 跨线程释放批量归还, 孤儿缓存接管和内存上限
+TEST(LoggingTestBase, LogRecordAllocator)
+{
+    LogMemoryStats        before = GetLogMemoryStats();
+    std::vector< void * > blocks;
+
+    /* 子线程分配, 当前线程释放, 子线程退出后缓存成为孤儿缓存 */
+    std::thread producer([&blocks]() {
+        for (int i = 0; i < 40; i++) {
+            void *ptr = LogSlabAlloc(1000);
+            ASSERT_NE(ptr, nullptr);
+            memset(ptr, 'x', 1000);
+            blocks.push_back(ptr);
+        }
+    });
+    producer.join();
+
+    LogMemoryStats stats = GetLogMemoryStats();
+    EXPECT_EQ(stats.alloc_count - before.alloc_count, 40u);
+    EXPECT_GE(stats.in_use_bytes - before.in_use_bytes, 40u * 1000u);
+    EXPECT_EQ(stats.orphan_caches, before.orphan_caches + 1);
+
+    for (void *ptr : blocks) {
+        LogSlabFree(ptr);
+    }
+    LogSlabFlushFrees();
+    stats = GetLogMemoryStats();
+    EXPECT_EQ(stats.remote_free_count - before.remote_free_count, 40u);
+    EXPECT_EQ(stats.in_use_bytes, before.in_use_bytes);
+
+    /* 新线程接管孤儿缓存, 空闲块用完后收回远程释放的块, 不需要新的slab */
+    std::thread adopter([]() {
+        std::vector< void * > reused;
+        for (int i = 0; i < 40; i++) {
+            reused.push_back(LogSlabAlloc(1000));
+        }
+        for (void *ptr : reused) {
+            LogSlabFree(ptr);
+        }
+    });
+    adopter.join();
+
+    LogMemoryStats adopted = GetLogMemoryStats();
+    EXPECT_EQ(adopted.alloc_count - stats.alloc_count, 40u);
+    EXPECT_EQ(adopted.in_use_bytes, before.in_use_bytes);
+    EXPECT_EQ(adopted.reserved_bytes, stats.reserved_bytes);
+    EXPECT_EQ(adopted.thread_caches, stats.thread_caches);
+    EXPECT_EQ(adopted.orphan_caches, stats.orphan_caches);
+
+    /* 只释放不分配的线程退出时归还批量缓存, 线程缓存析构之后释放的块直接归还 */
+    void *remote = LogSlabAlloc(1000);
+    void *late   = LogSlabAlloc(1000);
+    std::thread exiting([remote, late]() {
+        g_slab_exit_free.ptr = late;
+        LogSlabFree(remote);
+    });
+    exiting.join();
+    EXPECT_EQ(GetLogMemoryStats().in_use_bytes, before.in_use_bytes);
+
+    /* 超过内存上限时分配失败 */
+    SetLogMemoryLimit(adopted.reserved_bytes);
+    EXPECT_EQ(LogSlabAlloc(64 * 1024), nullptr);
+    EXPECT_EQ(GetLogMemoryStats().alloc_failures, adopted.alloc_failures + 1);
+    SetLogMemoryLimit(16 * 1024 * 1024);
+
+    /* 槽位放不下的日志经过slab内存输出, 输出后内存归还 */
+    std::string long_message(2000, 'y');
+    SetMinLogLevel(LOGGING_INFO);
+    testing::internal::CaptureStderr();
+    LOG(INFO) << long_message;
+    std::string output = testing::internal::GetCapturedStderr();
+    EXPECT_NE(output.find(long_message + "\n"), std::string::npos);
+    EXPECT_EQ(GetLogMemoryStats().in_use_bytes, before.in_use_bytes);
+}
+
+// 检查多个线程的日志全部输出, 并且同一线程的日志按顺序输出
+static void ExpectLogSequences(const std::string &output, const char *tag, uint32_t threads,
+    const std::vector< uint32_t > &counts)
+{
+    std::vector< uint32_t > next(threads, 0);
+    std::istringstream      lines(output);
+    std::string             line;
+    uint32_t                order_errors = 0;
+
+    while (std::getline(lines, line)) {
+        size_t   found = line.find(tag);
+        uint32_t thread, sequence;
+        if (found == std::string::npos ||
+            sscanf(line.c_str() + found + strlen(tag), " %u %u", &thread, &sequence) != 2 ||
+            thread >= threads) {
+            continue;
+        }
+        order_errors += sequence != next[thread];
+        next[thread] = sequence + 1;
+    }
+    EXPECT_EQ(order_errors, 0u);
+    for (uint32_t i = 0; i < threads; i++) {
+        EXPECT_EQ(next[i], counts[i]) << "thread " << i;
+    }
+}
+
+// 测试后台线程模式和自适应模式, 切换模式时日志不丢失, 不乱序
+TEST(LoggingTestBase, AdaptiveLogMode)
+{
+    SetMinLogLevel(LOGGING_INFO);
+
+    /* 后台线程模式下生产者只入队, FlushLog之后全部输出 */
+    testing::internal::CaptureStderr();
+    SetLogMode(LOG_MODE_ASYNC, 0);
+    EXPECT_EQ(GetLogMode(), LOG_MODE_ASYNC);
+    EXPECT_TRUE(IsLogBackendActive());
+    std::vector< std::thread > threads;
+    for (uint32_t t = 0; t < 3; t++) {
+        threads.emplace_back(
+            [](uint32_t thread) {
+                for (uint32_t i = 0; i < 500; i++) {
+                    LOG(INFO) << "async record " << thread << " " << i;
+                }
+            },
+            t);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    FlushLog();
+    SetLogMode(LOG_MODE_SYNC, 0);
+    EXPECT_FALSE(IsLogBackendActive());
+    std::string output = testing::internal::GetCapturedStderr();
+    ExpectLogSequences(output, "async record", 3, {500, 500, 500});
+
+    /* 自适应模式下高速率时切换到后台线程, 空闲后切换回同步模式 */
+    std::vector< uint32_t >  counts(3, 0);
+    std::atomic< bool >      stop(false);
+    std::atomic< bool >      switched(false);
+    testing::internal::CaptureStderr();
+    SetLogMode(LOG_MODE_ADAPTIVE, 1000);
+    EXPECT_FALSE(IsLogBackendActive());
+    threads.clear();
+    for (uint32_t t = 0; t < 3; t++) {
+        threads.emplace_back(
+            [&counts, &stop](uint32_t thread) {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    LOG(INFO) << "adaptive record " << thread << " " << counts[thread]++;
+                }
+            },
+            t);
+    }
+    for (int i = 0; i < 300 && !switched; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        switched = IsLogBackendActive();
+    }
+    stop = true;
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(switched.load());
+    for (int i = 0; i < 300 && IsLogBackendActive(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_FALSE(IsLogBackendActive());
+    FlushLog();
+    SetLogMode(LOG_MODE_SYNC, 0);
+    output = testing::internal::GetCapturedStderr();
+    ExpectLogSequences(output, "adaptive record", 3, counts);
+}
+
+// 用于构造组提交, 每次fdatasync之前等待2ms, 期间其他线程的日志等待同一次同步
+static void SlowLogFileSync(uint32_t point)
+{
+    if (point == LOG_TEST_POINT_SYNC) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+// 测试高等级日志组提交落盘, 并发的等待者共享fdatasync, 低等级日志不等待
+TEST(LoggingTestBase, DurableFileLogging)
+{
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    FilePath        path     = "easelog_durable_unittest.log";
+
+    unlink(path.c_str());
+    settings.log_dest      = LOG_TO_FILE;
+    settings.log_file_path = &path;
+    settings.log_min_level = LOGGING_INFO;
+    ASSERT_TRUE(InitLogging(settings));
+    SetLogFileSync(LOGGING_ERROR);
+
+    /* 普通日志不触发同步 */
+    uint64_t syncs = GetLogFileSyncCount();
+    for (int i = 0; i < 100; i++) {
+        LOG(INFO) << "durable info record " << i;
+    }
+    EXPECT_EQ(GetLogFileSyncCount(), syncs);
+
+    /* 每条ERROR日志返回时都已经落盘, 并发时同步次数少于日志条数 */
+    testing::internal::CaptureStderr();
+    SetLogTestDelay(SlowLogFileSync);
+    std::vector< std::thread > threads;
+    for (uint32_t t = 0; t < 4; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 50; i++) {
+                LOG(ERROR) << "durable error record " << i;
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    SetLogTestDelay(nullptr);
+    testing::internal::GetCapturedStderr();
+    uint64_t durable_syncs = GetLogFileSyncCount() - syncs;
+    EXPECT_GE(durable_syncs, 1u);
+    EXPECT_LT(durable_syncs, 150u);
+
+    SetLogFileSync(LOGGING_NUM_SEVERITIES);
+    ASSERT_TRUE(InitLogging(saved));
+
+    FILE       *file = fopen(path.c_str(), "r");
+    std::string content;
+    char        buffer[4096];
+    size_t      length;
+    ASSERT_NE(file, nullptr);
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, length);
+    }
+    fclose(file);
+    unlink(path.c_str());
+    EXPECT_EQ(CountSubstring(content, "durable info record"), 100u);
+    EXPECT_EQ(CountSubstring(content, "durable error record"), 200u);
+}
+
+#define URING_THREADS 4u
+#define URING_RECORDS 5000u
+
+// 测试io_uring写入日志文件, 多个缓冲区同时写入时日志不乱序, FlushLog返回时全部写入文件
+TEST(LoggingTestBase, UringFileLogging)
+{
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    FilePath        path     = "easelog_uring_unittest.log";
+
+    unlink(path.c_str());
+    settings.log_dest      = LOG_TO_FILE;
+    settings.log_file_path = &path;
+    settings.log_min_level = LOGGING_INFO;
+    SetLogFileUring(64, 4);
+    ASSERT_TRUE(InitLogging(settings));
+    LOG(INFO) << "uring first record";
+    if (!IsLogFileUringActive()) {
+        SetLogFileUring(0, 0);
+        ASSERT_TRUE(InitLogging(saved));
+        unlink(path.c_str());
+        GTEST_SKIP() << "io_uring is unavailable";
+    }
+
+    std::vector< std::thread > threads;
+    for (uint32_t t = 0; t < URING_THREADS; t++) {
+        threads.emplace_back([t]() {
+            for (uint32_t i = 0; i < URING_RECORDS; i++) {
+                LOG(INFO) << "uring record " << t << " " << i << " " << std::string(64, 'u');
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    FlushLog();
+
+    /* 文件仍然打开, FlushLog之后内容已经完整 */
+    FILE       *file = fopen(path.c_str(), "r");
+    std::string content;
+    char        buffer[4096];
+    size_t      length;
+    ASSERT_NE(file, nullptr);
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, length);
+    }
+    fclose(file);
+    EXPECT_EQ(CountSubstring(content, "uring first record"), 1u);
+    EXPECT_EQ(CountSubstring(content, "uring record"), URING_THREADS * URING_RECORDS);
+    ExpectLogSequences(content, "uring record", URING_THREADS,
+        std::vector< uint32_t >(URING_THREADS, URING_RECORDS));
+
+    /* 没有正在写入的请求时从文件末尾继续写入, 不覆盖其他写入者追加的内容 */
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, "uring external line\n", 20), 20);
+    close(fd);
+    LOG(INFO) << "uring after external";
+    FlushLog();
+    content = ReadLogFile(path);
+    EXPECT_EQ(CountSubstring(content, "uring external line\n"), 1u);
+    EXPECT_EQ(CountSubstring(content, "uring after external"), 1u);
+
+    /* fork之后只有子进程回到write()追加写入, 父进程继续使用io_uring, 从文件末尾继续写入 */
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        for (uint32_t i = 0; i < 100; i++) {
+            LOG(INFO) << "uring child record " << i;
+        }
+        _exit(IsLogFileUringActive() ? 1 : 0);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_TRUE(IsLogFileUringActive());
+    for (uint32_t i = 0; i < 100; i++) {
+        LOG(INFO) << "uring parent record " << i;
+    }
+    FlushLog();
+    content = ReadLogFile(path);
+    EXPECT_EQ(CountSubstring(content, "uring child record"), 100u);
+    EXPECT_EQ(CountSubstring(content, "uring parent record"), 100u);
+
+    /* 关闭日志文件时等待写入完成, 之后回到write()写入 */
+    SetLogFileUring(0, 0);
+    ASSERT_TRUE(InitLogging(saved));
+    EXPECT_FALSE(IsLogFileUringActive());
+    unlink(path.c_str());
+}
+
+// 获取当前时间, 单位us
+static uint64_t NowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast< uint64_t >(tv.tv_sec) * 1000000 + static_cast< uint64_t >(tv.tv_usec);
+}
+
+// 测试日志文件时间索引, 按照时间范围和日志等级读取时只扫描相关的日志块
+TEST(LoggingTestBase, LogFileIndex)
+{
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    FilePath        path     = "easelog_index_unittest.log";
+
+    unlink(path.c_str());
+    unlink((path + ".idx").c_str());
+    settings.log_dest      = LOG_TO_FILE;
+    settings.log_file_path = &path;
+    settings.log_min_level = LOGGING_INFO;
+    settings.log_timestamp = true;
+    SetLogFileIndex(1, 0);
+    ASSERT_TRUE(InitLogging(settings));
+
+    for (int i = 0; i < 300; i++) {
+        LOG(INFO) << "index before record " << i;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t begin_us = NowUs();
+    for (int i = 0; i < 100; i++) {
+        LOG(INFO) << "index inside record " << i;
+        if (i % 2 == 0) {
+            LOG(WARNING) << "index inside warning " << i;
+        }
+    }
+    uint64_t end_us = NowUs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < 300; i++) {
+        LOG(INFO) << "index after record " << i;
+    }
+
+    /* 关闭日志文件时写入最后一个索引块 */
+    ASSERT_TRUE(InitLogging(saved));
+    SetLogFileIndex(0, 0);
+
+    LogRangeStats stats;
+    std::string   lines;
+    auto          collect = [&lines](const char *line, size_t length) {
+        lines.append(line, length);
+    };
+
+    ASSERT_TRUE(ReadLogFileRange(path.c_str(), 0, UINT64_MAX, LOG_SEVERITY_MASK_ALL, collect,
+        &stats));
+    EXPECT_EQ(stats.lines, 750u);
+    EXPECT_EQ(stats.scanned_bytes, stats.file_bytes);
+    EXPECT_GT(stats.index_entries, 10u);
+
+    lines.clear();
+    ASSERT_TRUE(ReadLogFileRange(path.c_str(), begin_us, end_us, LogSeverityMask(LOGGING_WARNING),
+        collect, &stats));
+    EXPECT_EQ(stats.lines, 50u);
+    EXPECT_EQ(CountSubstring(lines, "index inside warning"), 50u);
+    EXPECT_LT(stats.scanned_bytes * 4, stats.file_bytes);
+
+    lines.clear();
+    ASSERT_TRUE(ReadLogFileRange(path.c_str(), begin_us, end_us, LOG_SEVERITY_MASK_ALL, collect,
+        &stats));
+    EXPECT_EQ(CountSubstring(lines, "index inside record"), 100u);
+    EXPECT_EQ(stats.lines, 150u);
+
+    /* 没有索引时扫描整个文件, 结果相同 */
+    unlink((path + ".idx").c_str());
+    ASSERT_TRUE(ReadLogFileRange(path.c_str(), begin_us, end_us, LogSeverityMask(LOGGING_WARNING),
+        collect, &stats));
+    EXPECT_EQ(stats.lines, 50u);
+    EXPECT_EQ(stats.index_entries, 0u);
+    EXPECT_EQ(stats.scanned_bytes, stats.file_bytes);
+    unlink(path.c_str());
+
+    /* 较长的日志前缀和tickcount在等级名字之前, 仍然按照等级过滤 */
+    settings.log_prefix    = "easelog-index-long-prefix";
+    settings.log_tickcount = true;
+    ASSERT_TRUE(InitLogging(settings));
+    LOG(INFO) << "index prefix record";
+    LOG(WARNING) << "index prefix warning";
+    ASSERT_TRUE(InitLogging(saved));
+    lines.clear();
+    ASSERT_TRUE(ReadLogFileRange(path.c_str(), 0, UINT64_MAX, LogSeverityMask(LOGGING_WARNING),
+        collect, &stats));
+    EXPECT_EQ(stats.lines, 1u);
+    EXPECT_EQ(CountSubstring(lines, "index prefix warning"), 1u);
+    unlink(path.c_str());
+}
+
+#define BINARY_THREADS 4u
+#define BINARY_RECORDS 2000u
+
+// 测试二进制日志文件, 并行解码后和文本格式相同, 时间和等级过滤跳过无关的块,
+// 损坏的部分跳过到下一个块
+TEST(LoggingTestBase, BinaryLogFile)
+{
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    FilePath        path     = "easelog_binary_unittest.log";
+
+    unlink(path.c_str());
+    settings.log_dest       = LOG_TO_FILE;
+    settings.log_file_path  = &path;
+    settings.log_min_level  = LOGGING_INFO;
+    settings.log_timestamp  = true;
+    settings.log_process_id = true;
+    settings.log_thread_id  = true;
+    SetLogFileFormat(LOG_FILE_FORMAT_BINARY);
+    ASSERT_TRUE(InitLogging(settings));
+
+    /* 开始时间之前的日志超过一个块 */
+    for (uint32_t i = 0; i < BINARY_RECORDS * 4; i++) {
+        LOG(INFO) << "binary before " << i;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t                   begin_us = NowUs();
+    std::vector< std::thread > threads;
+    for (uint32_t t = 0; t < BINARY_THREADS; t++) {
+        threads.emplace_back([t]() {
+            pthread_setname_np(pthread_self(), ("binary" + std::to_string(t)).c_str());
+            for (uint32_t i = 0; i < BINARY_RECORDS; i++) {
+                LOG(INFO) << "binary record " << t << " " << i;
+                if (i % 4 == 0) {
+                    LOG(WARNING) << "binary warning " << t << " " << i;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    uint64_t end_us = NowUs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (uint32_t i = 0; i < BINARY_RECORDS; i++) {
+        LOG(INFO) << "binary after \"quoted\"\t" << i;
+    }
+    ASSERT_TRUE(InitLogging(saved));
+    SetLogFileFormat(LOG_FILE_FORMAT_TEXT);
+
+    LogDecodeOptions options = {0, UINT64_MAX, LOG_SEVERITY_MASK_ALL, LOG_DECODE_TEXT, 4, 0};
+    LogDecodeStats   stats;
+    std::string      output;
+    auto             collect = [&output](const char *data, size_t length) {
+        output.append(data, length);
+    };
+
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_EQ(stats.records, BINARY_RECORDS * (5 + BINARY_THREADS * 5 / 4));
+    EXPECT_EQ(stats.corrupt_bytes, 0u);
+    EXPECT_GT(stats.blocks, 4u);
+    EXPECT_LT(stats.file_bytes * 2, output.size());
+    ExpectLogSequences(output, "binary record", BINARY_THREADS,
+        std::vector< uint32_t >(BINARY_THREADS, BINARY_RECORDS));
+    EXPECT_EQ(CountSubstring(output, "<warning> "), BINARY_RECORDS * BINARY_THREADS / 4);
+    EXPECT_EQ(CountSubstring(output, "]: [binary3("), BINARY_RECORDS * BINARY_THREADS * 5 / 16);
+    EXPECT_NE(output.find(") - easelog_unittest.cpp(operator()-"), std::string::npos);
+    EXPECT_NE(output.find("binary after \"quoted\"\t0\n"), std::string::npos);
+
+    /* 时间和等级过滤 */
+    output.clear();
+    options.begin_us      = begin_us;
+    options.end_us        = end_us;
+    options.severity_mask = LogSeverityMask(LOGGING_WARNING);
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_EQ(stats.records, BINARY_RECORDS * BINARY_THREADS / 4);
+    EXPECT_EQ(CountSubstring(output, "binary warning"), BINARY_RECORDS * BINARY_THREADS / 4);
+    EXPECT_GT(stats.skipped_blocks, 0u);
+
+    /* JSON输出, 单线程解码结果相同 */
+    output.clear();
+    options.output  = LOG_DECODE_JSON;
+    options.threads = 1;
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_EQ(CountSubstring(output, "\"severity\":\"warning\""),
+        BINARY_RECORDS * BINARY_THREADS / 4);
+    EXPECT_EQ(CountSubstring(output, "\"thread\":\"binary0\""), BINARY_RECORDS / 4);
+
+    /* 按行读取的接口拒绝二进制文件 */
+    EXPECT_FALSE(ReadLogFileRange(path.c_str(), 0, UINT64_MAX, LOG_SEVERITY_MASK_ALL,
+        [](const char *, size_t) {}, nullptr));
+
+    /* 损坏文件中间的内容, 其他块仍然可以解码 */
+    int fd = open(path.c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    char garbage[64];
+    memset(garbage, 0xff, sizeof(garbage));
+    EXPECT_EQ(pwrite(fd, garbage, sizeof(garbage), static_cast< off_t >(stats.file_bytes / 2)),
+        static_cast< ssize_t >(sizeof(garbage)));
+    close(fd);
+    options = {0, UINT64_MAX, LOG_SEVERITY_MASK_ALL, LOG_DECODE_TEXT, 4, 0};
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_GT(stats.corrupt_bytes, 0u);
+    EXPECT_LT(stats.records, BINARY_RECORDS * (5 + BINARY_THREADS * 5 / 4));
+    EXPECT_GT(stats.records, BINARY_RECORDS * 5);
+    unlink(path.c_str());
+}
+
+// 构造一个只有一个调用点, 一个线程和一条日志的二进制块, 调用点的等级由参数指定
+static std::string MakeLogBinaryBlock(uint8_t severity, const char *text)
+{
+    LogBinaryBlockHeader header;
+    memcpy(header.magic, LOG_BINARY_MAGIC, sizeof(header.magic));
+    header.first_us = 1000000;
+    header.version  = LOG_BINARY_VERSION;
+    header.check    = LogBinaryBlockCheck(header);
+
+    std::string block(reinterpret_cast< const char * >(&header), sizeof(header));
+    /* 调用点: id 0, 等级(zigzag), 行号1, 文件名, 函数名 */
+    block += std::string("C\x00", 2);
+    block.push_back(static_cast< char >(severity));
+    block += "\x02\x06" "file.c" "\x04" "func";
+    /* 线程: id 0, 进程ID 1, 线程ID 1, 线程名, 程序名 */
+    block += std::string("T\x00\x02\x02\x04main\x04prog", 14);
+    /* 日志: 调用点0, 线程0, 时间差0 */
+    block += std::string("R\x00\x00\x00", 4);
+    block.push_back(static_cast< char >(strlen(text)));
+    block += text;
+    return block;
+}
+
+// 调用点字典中超出范围的日志等级按照格式错误处理, 不用于计算掩码和查找等级名字
+TEST(LoggingTestBase, DecodeBadCallSiteSeverity)
+{
+    FilePath    path("easelog_bad_severity.log");
+    std::string content = MakeLogBinaryBlock(2 * LOGGING_ERROR, "good record") +
+        MakeLogBinaryBlock(2 * LOGGING_NUM_SEVERITIES, "bad record") +
+        MakeLogBinaryBlock(3, "verbose record");
+    FILE *file = fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(fwrite(content.data(), 1, content.size(), file), content.size());
+    fclose(file);
+
+    LogDecodeOptions options = {0, UINT64_MAX, LOG_SEVERITY_MASK_ALL, LOG_DECODE_TEXT, 1, 0};
+    LogDecodeStats   stats;
+    std::string      output;
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options,
+        [&output](const char *data, size_t length) { output.append(data, length); }, &stats));
+    EXPECT_EQ(stats.blocks, 3u);
+    EXPECT_EQ(stats.records, 2u);
+    EXPECT_GT(stats.corrupt_bytes, 0u);
+    EXPECT_NE(output.find("<error> "), std::string::npos);
+    EXPECT_NE(output.find("good record"), std::string::npos);
+    EXPECT_EQ(output.find("bad record"), std::string::npos);
+    EXPECT_NE(output.find("<VERBOSE2> "), std::string::npos);
+    unlink(path.c_str());
+}
+
+// 测试内置的LZ压缩算法, 可压缩和不可压缩的数据, 以及损坏的压缩数据
+TEST(LoggingTestBase, LzCodec)
+{
+    std::string text;
+    for (uint32_t i = 0; i < 4000; i++) {
+        text += "2026-10-18T23:30:00.000000+08:00 <info> easelog[42]: record " +
+            std::to_string(i) + "\n";
+    }
+    std::string packed(text.size(), '\0');
+    std::string unpacked(text.size(), '\0');
+    size_t      length = LogLzCompress(text.data(), text.size(), &packed[0], packed.size());
+    ASSERT_NE(length, 0u);
+    EXPECT_LT(length * 4, text.size());
+    ASSERT_TRUE(LogLzDecompress(packed.data(), length, &unpacked[0], unpacked.size()));
+    EXPECT_EQ(unpacked, text);
+
+    /* 长的重复序列, 匹配和输出重叠 */
+    std::string repeat = "ab" + std::string(70000, 'x') + "cd";
+    std::string output(repeat.size(), '\0');
+    length = LogLzCompress(repeat.data(), repeat.size(), &packed[0], packed.size());
+    ASSERT_NE(length, 0u);
+    ASSERT_TRUE(LogLzDecompress(packed.data(), length, &output[0], output.size()));
+    EXPECT_EQ(output, repeat);
+
+    /* 随机数据压缩后不会变小 */
+    std::string random(65536, '\0');
+    uint32_t    seed = 12345;
+    for (char &c : random) {
+        seed = seed * 1103515245 + 12345;
+        c    = static_cast< char >(seed >> 16);
+    }
+    EXPECT_EQ(LogLzCompress(random.data(), random.size(), &packed[0], packed.size()), 0u);
+
+    /* 截断或者长度不符的压缩数据 */
+    length = LogLzCompress(text.data(), text.size(), &packed[0], packed.size());
+    EXPECT_FALSE(LogLzDecompress(packed.data(), length / 2, &unpacked[0], unpacked.size()));
+    EXPECT_FALSE(LogLzDecompress(packed.data(), length, &unpacked[0], unpacked.size() - 1));
+}
+
+#define COMPRESS_THREADS 4u
+#define COMPRESS_RECORDS 5000u
+#define COMPRESS_DURABLE 25u
+
+// 测试压缩的日志文件, 多线程写入后解压解码, 内容和顺序都完整
+TEST(LoggingTestBase, CompressedLogFile)
+{
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    FilePath        path     = "easelog_compress_unittest.log";
+    LogCompressStats before  = GetLogCompressStats();
+
+    unlink(path.c_str());
+    settings.log_dest      = LOG_TO_FILE;
+    settings.log_file_path = &path;
+    settings.log_min_level = LOGGING_INFO;
+    SetLogFileFormat(LOG_FILE_FORMAT_BINARY);
+    SetLogFileCompression(64, 2);
+    ASSERT_TRUE(InitLogging(settings));
+    LOG(INFO) << "compress first record";
+    EXPECT_TRUE(IsLogFileCompressed());
+
+    std::vector< std::thread > threads;
+    for (uint32_t t = 0; t < COMPRESS_THREADS; t++) {
+        threads.emplace_back([t]() {
+            for (uint32_t i = 0; i < COMPRESS_RECORDS; i++) {
+                LOG(INFO) << "compress record " << t << " " << i << " " << std::string(32, 'c');
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    FlushLog();
+    LogCompressStats after = GetLogCompressStats();
+    EXPECT_GT(after.frames - before.frames, 4u);
+    EXPECT_LT(after.file_bytes - before.file_bytes, after.raw_bytes - before.raw_bytes);
+
+    /* 文件仍然打开, FlushLog之后所有帧都已经写入 */
+    LogDecodeOptions options = {0, UINT64_MAX, LOG_SEVERITY_MASK_ALL, LOG_DECODE_TEXT, 4, 0};
+    LogDecodeStats   stats;
+    std::string      output;
+    auto             collect = [&output](const char *data, size_t length) {
+        output.append(data, length);
+    };
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_EQ(stats.corrupt_bytes, 0u);
+    EXPECT_EQ(stats.records, COMPRESS_THREADS * COMPRESS_RECORDS + 1);
+    EXPECT_EQ(CountSubstring(output, "compress first record"), 1u);
+    ExpectLogSequences(output, "compress record", COMPRESS_THREADS,
+        std::vector< uint32_t >(COMPRESS_THREADS, COMPRESS_RECORDS));
+
+    /* 每次只解压一个帧, 跨越帧的块留到下一个窗口, 结果不变 */
+    std::string whole;
+    whole.swap(output);
+    SetLogDecodeInflateBytes(1);
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_EQ(stats.corrupt_bytes, 0u);
+    EXPECT_EQ(output, whole);
+
+    /* 开始时间之前的帧不解压, 直接跳过 */
+    usleep(20000);
+    uint64_t begin_us = NowUs();
+    for (uint32_t i = 0; i < 100; i++) {
+        LOG(INFO) << "compress late record " << i;
+    }
+    FlushLog();
+    options.begin_us = begin_us;
+    output.clear();
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    SetLogDecodeInflateBytes(16 * 1024 * 1024);
+    EXPECT_GT(stats.skipped_frames, 0u);
+    EXPECT_EQ(stats.records, 100u);
+    EXPECT_EQ(CountSubstring(output, "compress record"), 0u);
+    EXPECT_EQ(CountSubstring(output, "compress late record"), 100u);
+    options.begin_us = 0;
+    output.clear();
+
+    /* 并发的落盘日志等待所在的块压缩写入之后才同步, 返回时不需要FlushLog就可以解码 */
+    SetLogFileSync(LOGGING_ERROR);
+    SetLogTestDelay(SlowLogFileSync);
+    uint64_t syncs = GetLogFileSyncCount();
+    testing::internal::CaptureStderr();
+    threads.clear();
+    for (uint32_t t = 0; t < COMPRESS_THREADS; t++) {
+        threads.emplace_back([t]() {
+            for (uint32_t i = 0; i < COMPRESS_DURABLE; i++) {
+                LOG(ERROR) << "compress durable record " << t << " " << i;
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    testing::internal::GetCapturedStderr();
+    SetLogTestDelay(nullptr);
+    SetLogFileSync(LOGGING_NUM_SEVERITIES);
+    EXPECT_GE(GetLogFileSyncCount() - syncs, 1u);
+    EXPECT_LT(GetLogFileSyncCount() - syncs, COMPRESS_THREADS * COMPRESS_DURABLE);
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_EQ(stats.corrupt_bytes, 0u);
+    ExpectLogSequences(output, "compress durable record", COMPRESS_THREADS,
+        std::vector< uint32_t >(COMPRESS_THREADS, COMPRESS_DURABLE));
+    output.clear();
+
+    /* 关闭日志文件时写入所有块, 文本格式解压后原样输出 */
+    SetLogFileFormat(LOG_FILE_FORMAT_TEXT);
+    ASSERT_TRUE(InitLogging(saved));
+    unlink(path.c_str());
+    ASSERT_TRUE(InitLogging(settings));
+    LOG(INFO) << "compress text record";
+    ASSERT_TRUE(InitLogging(saved));
+    SetLogFileCompression(0, 0);
+    EXPECT_FALSE(IsLogFileCompressed());
+    output.clear();
+    ASSERT_TRUE(DecodeLogFile(path.c_str(), options, collect, &stats));
+    EXPECT_EQ(CountSubstring(output, "compress text record\n"), 1u);
+    EXPECT_FALSE(ReadLogFileRange(path.c_str(), 0, UINT64_MAX, LOG_SEVERITY_MASK_ALL,
+        [](const char *, size_t) {}, nullptr));
+    unlink(path.c_str());
+}
+
+#define TAIL_FLOOD_RECORDS 20000u
+
+// 读取订阅连接上的日志, 超过|idle_ms|没有新数据时返回
+static std::string ReadLogTail(int fd, int idle_ms)
+{
+    std::string   output;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    char          buffer[4096];
+
+    while (poll(&pfd, 1, idle_ms) > 0) {
+        ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            break;
+        }
+        output.append(buffer, static_cast< size_t >(size));
+    }
+    return output;
+}
+
+static void LogTailRecords()
+{
+    LOG(DEBUG) << "tail debug record";
+    VLOG(2) << "tail verbose record";
+    VLOG(3) << "tail verbose3 record";
+    LOG(INFO) << "tail info record";
+}
+
+static void LogTailFlood()
+{
+    for (uint32_t i = 0; i < TAIL_FLOOD_RECORDS; i++) {
+        LOG(DEBUG) << "tail flood record " << i << " " << std::string(64, 'x');
+    }
+}
+
+// 测试实时订阅, 订阅期间匹配的低等级日志只发送给订阅者, 断开之后恢复原来的等级.
+// 读取缓慢的订阅者丢弃日志, 不会阻塞写日志的线程.
+TEST(LoggingTestBase, LiveTail)
+{
+    std::string path = "@easelog-tail-" + std::to_string(getpid());
+
+    SetMinLogLevel(LOGGING_INFO);
+    ASSERT_TRUE(StartLogTail(path.c_str()));
+    EXPECT_FALSE(StartLogTail(path.c_str()));
+    EXPECT_EQ(ConnectLogTail(path.c_str(), "severity=bogus"), -1);
+    EXPECT_EQ(ConnectLogTail(path.c_str(), "color=red"), -1);
+    EXPECT_FALSE(LOG_IS_ON(DEBUG));
+
+    int fd = ConnectLogTail(path.c_str(), "severity=verbose2 file=easelog_unit*.cpp func=LogTail*");
+    ASSERT_GE(fd, 0);
+    EXPECT_TRUE(LOG_IS_ON(DEBUG));
+    EXPECT_TRUE(VLOG_IS_ON(2));
+    EXPECT_FALSE(VLOG_IS_ON(3));
+
+    testing::internal::CaptureStderr();
+    LogTailRecords();
+    LOG(DEBUG) << "tail other record";
+    std::string output = testing::internal::GetCapturedStderr();
+    std::string tail   = ReadLogTail(fd, 200);
+
+    /* 订阅者只收到过滤条件匹配的日志, 低等级日志不会输出到其他目的地 */
+    EXPECT_NE(tail.find("tail debug record"), std::string::npos) << tail;
+    EXPECT_NE(tail.find("tail verbose record"), std::string::npos) << tail;
+    EXPECT_NE(tail.find("tail info record"), std::string::npos) << tail;
+    EXPECT_EQ(tail.find("tail verbose3 record"), std::string::npos) << tail;
+    EXPECT_EQ(tail.find("tail other record"), std::string::npos) << tail;
+    EXPECT_NE(output.find("tail info record"), std::string::npos);
+    EXPECT_EQ(output.find("tail debug record"), std::string::npos);
+    EXPECT_EQ(output.find("tail verbose record"), std::string::npos);
+    EXPECT_EQ(output.find("tail other record"), std::string::npos);
+
+    /* 断开之后服务线程恢复原来的等级 */
+    close(fd);
+    for (int i = 0; i < 200 && LOG_IS_ON(DEBUG); i++) {
+        usleep(10000);
+    }
+    EXPECT_FALSE(LOG_IS_ON(DEBUG));
+    EXPECT_FALSE(VLOG_IS_ON(2));
+
+    /* 订阅者暂停读取, 缓冲区满之后丢弃日志并在恢复时提示 */
+    fd = ConnectLogTail(path.c_str(), "severity=debug func=LogTailFlood");
+    ASSERT_GE(fd, 0);
+    LogTailFlood();
+    tail = ReadLogTail(fd, 200);
+    EXPECT_GT(CountSubstring(tail, "tail flood record"), 0u);
+    EXPECT_LT(CountSubstring(tail, "tail flood record"), TAIL_FLOOD_RECORDS);
+    EXPECT_NE(tail.find("records dropped"), std::string::npos);
+
+    /* 其他用户的连接被拒绝 */
+    if (geteuid() == 0) {
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0) {
+            _exit(setuid(65534) == 0 && ConnectLogTail(path.c_str(), "severity=info") < 0 ? 0 : 1);
+        }
+        int status = 0;
+        ASSERT_EQ(waitpid(pid, &status, 0), pid);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    /* 停止服务时断开所有订阅者 */
+    StopLogTail();
+    EXPECT_EQ(ReadLogTail(fd, 1000), "");
+    close(fd);
+    EXPECT_FALSE(LOG_IS_ON(DEBUG));
+
+    /* 套接字文件只有当前用户可以访问, 路径上的其他文件不会被删除 */
+    path = "easelog_tail_unittest.sock";
+    unlink(path.c_str());
+    close(open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644));
+    EXPECT_FALSE(StartLogTail(path.c_str()));
+    EXPECT_EQ(access(path.c_str(), F_OK), 0);
+    unlink(path.c_str());
+    ASSERT_TRUE(StartLogTail(path.c_str()));
+    struct stat st;
+    ASSERT_EQ(stat(path.c_str(), &st), 0);
+    EXPECT_TRUE(S_ISSOCK(st.st_mode));
+    EXPECT_EQ(st.st_mode & 0777, 0600u);
+    fd = ConnectLogTail(path.c_str(), "severity=info");
+    EXPECT_GE(fd, 0);
+    close(fd);
+    StopLogTail();
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
+
+#define SHM_PROCESSES 4
+#define SHM_RECORDS   200
+
+// 测试多进程共享内存日志, fork出的子进程写入各自的环形队列, 由父进程的收集线程合并输出.
+// 子进程中的进程ID在fork之后重新获取, 同一进程的日志按顺序输出.
+TEST(LoggingTestBase, SharedMemoryCollector)
+{
+    pid_t pids[SHM_PROCESSES];
+
+    SetMinLogLevel(LOGGING_INFO);
+    SetLogItems(true, true, true, false);
+    /* 父进程先输出日志, 缓存进程ID */
+    LOG(INFO) << "shm parent record";
+
+    testing::internal::CaptureStderr();
+    ASSERT_TRUE(CreateLogSharedMemory(nullptr, SHM_PROCESSES));
+    EXPECT_FALSE(CreateLogSharedMemory(nullptr, SHM_PROCESSES));
+    ASSERT_TRUE(StartLogCollector());
+
+    /* 需要落盘的日志不经过共享内存, 子进程直接写入文件并且等待fdatasync */
+    LoggingSettings saved    = GetLoggingSettings();
+    LoggingSettings settings = saved;
+    FilePath        path     = "easelog_shm_durable_unittest.log";
+    unlink(path.c_str());
+    settings.log_dest      = LOG_TO_FILE;
+    settings.log_file_path = &path;
+    ASSERT_TRUE(InitLogging(settings));
+    SetLogFileSync(LOGGING_ERROR);
+    pid_t durable_pid = fork();
+    ASSERT_GE(durable_pid, 0);
+    if (durable_pid == 0) {
+        uint64_t syncs = GetLogFileSyncCount();
+        LOG(ERROR) << "shm durable record";
+        _exit(GetLogFileSyncCount() > syncs ? 0 : 1);
+    }
+    int durable_status;
+    ASSERT_EQ(waitpid(durable_pid, &durable_status, 0), durable_pid);
+    EXPECT_TRUE(WIFEXITED(durable_status) && WEXITSTATUS(durable_status) == 0);
+    SetLogFileSync(LOGGING_NUM_SEVERITIES);
+    ASSERT_TRUE(InitLogging(saved));
+    EXPECT_EQ(CountSubstring(ReadLogFile(path), "shm durable record"), 1u);
+    unlink(path.c_str());
+
+    for (uint32_t p = 0; p < SHM_PROCESSES; p++) {
+        pids[p] = fork();
+        ASSERT_GE(pids[p], 0);
+        if (pids[p] == 0) {
+            for (uint32_t i = 0; i < SHM_RECORDS; i++) {
+                LOG(INFO) << "shm record " << p << " " << i;
+            }
+            /* 等级超出范围的记录被收集线程丢弃 */
+            if (p == 0) {
+                struct timeval tv;
+                gettimeofday(&tv, nullptr);
+                LogShmEnqueue(64, tv, "shm bad severity\n", 17);
+            }
+            _exit(0);
+        }
+    }
+    for (uint32_t p = 0; p < SHM_PROCESSES; p++) {
+        int status;
+        ASSERT_EQ(waitpid(pids[p], &status, 0), pids[p]);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    StopLogCollector();
+    EXPECT_EQ(GetLogShmCorruptCount(), 1u);
+    std::string output = testing::internal::GetCapturedStderr();
+
+    EXPECT_EQ(output.find("shm bad severity"), std::string::npos);
+    ExpectLogSequences(output, "shm record", SHM_PROCESSES,
+        std::vector< uint32_t >(SHM_PROCESSES, SHM_RECORDS));
+    for (uint32_t p = 0; p < SHM_PROCESSES; p++) {
+        std::string record = "shm record " + std::to_string(p) + " 0";
+        size_t      line   = output.rfind('\n', output.find(record)) + 1;
+        EXPECT_NE(output.substr(line, output.find(record) - line)
+                      .find('[' + std::to_string(pids[p]) + ']'),
+            std::string::npos)
+            << output.substr(line, output.find(record) - line);
+    }
+}
+
 #define REPEAT_TIMES 1000
 
 // 简易性能测试, 输入1000条日志, 记录耗时
@@ -81,12 +1689,10 @@ TEST(LoggingTestBase, BasicPerformance)
 #undef REPEAT_TIMES
 #define REPEAT_TIMES 20
 
-static bool g_log_enable_random_sleep = false;
-
-// 用于构造并发时序, 随机等待 10-50ms
-void RandomSleep()
+// 用于构造并发时序, 输出日志之前随机等待 10-50ms
+static void RandomSleep(uint32_t point)
 {
-    if (g_log_enable_random_sleep) {
+    if (point == LOG_TEST_POINT_WRITE) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10 + rand() % 40));
     }
 }
@@ -94,7 +1700,7 @@ void RandomSleep()
 // 测试多线程写日志
 TEST(LoggingTestBase, MultiThreadLogging)
 {
-    g_log_enable_random_sleep = true;
+    SetLogTestDelay(RandomSleep);
 
     // 线程名字 thread1, thread2, thread3
     std::thread t1([]() {
@@ -121,6 +1727,7 @@ TEST(LoggingTestBase, MultiThreadLogging)
     t1.join();
     t2.join();
     t3.join();
+    SetLogTestDelay(nullptr);
 }
 
 }    // namespace logging
@@ -0,0 +1,471 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_uring.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 22:20
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  使用io_uring异步写入日志文件, 日志拷贝到注册的缓冲区, 写满或者一批日志输出完时提交,
+ *  写入线程不等待磁盘, 只有所有缓冲区都在写入时才等待完成. 直接使用系统调用, 不依赖liburing.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#define EASELOG_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#endif
+#endif
+
+namespace logging {
+
+// io_uring的设置, 下次打开日志文件时生效, 缓冲区个数为0时关闭
+static uint32_t g_log_uring_buffer_size = 0;
+static uint32_t g_log_uring_buffers     = 0;
+
+// 是否正在使用io_uring写入日志文件, 异步信号安全
+static std::atomic< bool > g_log_uring_active(false);
+
+// export: 设置io_uring写入, 下次打开日志文件时生效
+void SetLogFileUring(uint32_t buffer_kb, uint32_t buffers)
+{
+    g_log_uring_buffer_size = buffer_kb * 1024;
+    g_log_uring_buffers     = buffer_kb != 0 ? buffers : 0;
+}
+
+// export: 判断日志文件是否正在使用io_uring写入
+bool IsLogFileUringActive()
+{
+    return g_log_uring_active.load(std::memory_order_relaxed);
+}
+
+#if defined(EASELOG_HAVE_IO_URING)
+
+// 提交缓冲区, 每个缓冲区同一时间最多只有一个写入请求
+struct LogUringBuffer {
+    char    *data;      // 缓冲区内存, 注册为固定缓冲区
+    uint64_t offset;    // 缓冲区内容在日志文件中的偏移
+    uint32_t length;    // 已经填充的长度
+    uint32_t busy;      // 是否正在写入
+};
+
+// io_uring写入状态, 由日志锁保护
+struct LogUring {
+    int                            ring_fd;     // io_uring实例
+    int                            file_fd;     // 不带O_APPEND的日志文件描述符, 按偏移写入
+    uint32_t                       fixed;       // 缓冲区是否注册成功, 失败时使用普通写入
+    uint32_t                       current;     // 正在填充的缓冲区
+    uint32_t                       inflight;    // 正在写入的缓冲区个数
+    uint32_t                       size;        // 每个缓冲区的大小
+    uint64_t                       offset;      // 日志文件的下一个写入位置
+    uint32_t                      *sq_tail;
+    uint32_t                      *sq_mask;
+    uint32_t                      *sq_array;
+    uint32_t                      *cq_head;
+    uint32_t                      *cq_tail;
+    uint32_t                      *cq_mask;
+    struct io_uring_sqe           *sqes;
+    struct io_uring_cqe           *cqes;
+    void                          *sq_ring;
+    void                          *cq_ring;
+    size_t                         sq_ring_size;
+    size_t                         cq_ring_size;
+    size_t                         sqes_size;
+    char                          *memory;      // 所有缓冲区的内存
+    std::vector< LogUringBuffer >  buffers;
+};
+
+static LogUring g_log_uring = {-1, -1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr, nullptr, nullptr, nullptr, nullptr, 0, 0, 0, nullptr, {}};
+
+static int LogUringSetup(uint32_t entries, struct io_uring_params *params)
+{
+    return static_cast< int >(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int LogUringEnter(uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{
+    long ret;
+
+    HANDLE_EINTR(ret,
+        syscall(__NR_io_uring_enter, g_log_uring.ring_fd, to_submit, min_complete, flags, nullptr,
+            0));
+    return static_cast< int >(ret);
+}
+
+static int LogUringRegister(uint32_t opcode, const void *arg, uint32_t count)
+{
+    return static_cast< int >(syscall(__NR_io_uring_register, g_log_uring.ring_fd, opcode, arg,
+        count));
+}
+
+// 同步写入一段数据, 用于补齐部分写入和崩溃时的输出
+static void PwriteAll(int fd, const char *data, size_t length, uint64_t offset)
+{
+    size_t written = 0;
+
+    while (written < length) {
+        ssize_t ret;
+        HANDLE_EINTR(ret, pwrite(fd, data + written, length - written,
+                              static_cast< off_t >(offset + written)));
+        // Give up, nothing we can do now.
+        if (ret <= 0) {
+            break;
+        }
+        written += static_cast< size_t >(ret);
+    }
+}
+
+// 收割完成的写入请求, 部分写入时同步补齐剩余部分, 写入失败时同步重写整个缓冲区
+static void ReapLogUring()
+{
+    uint32_t head = __atomic_load_n(g_log_uring.cq_head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(g_log_uring.cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        const struct io_uring_cqe &cqe    = g_log_uring.cqes[head & *g_log_uring.cq_mask];
+        LogUringBuffer            &buffer = g_log_uring.buffers[cqe.user_data];
+        if (cqe.res < 0) {
+            PwriteAll(g_log_uring.file_fd, buffer.data, buffer.length, buffer.offset);
+        } else if (static_cast< uint32_t >(cqe.res) < buffer.length) {
+            PwriteAll(g_log_uring.file_fd, buffer.data + cqe.res,
+                buffer.length - static_cast< uint32_t >(cqe.res),
+                buffer.offset + static_cast< uint32_t >(cqe.res));
+        }
+        buffer.busy   = 0;
+        buffer.length = 0;
+        g_log_uring.inflight--;
+    }
+    __atomic_store_n(g_log_uring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+// 提交正在填充的缓冲区, 切换到下一个缓冲区
+static void SubmitLogUringBuffer()
+{
+    uint32_t        index  = g_log_uring.current;
+    LogUringBuffer &buffer = g_log_uring.buffers[index];
+    uint32_t        tail   = *g_log_uring.sq_tail;
+    uint32_t        slot   = tail & *g_log_uring.sq_mask;
+
+    if (buffer.busy || buffer.length == 0) {
+        return;
+    }
+
+    // 缓冲区个数等于提交队列长度, 提交队列不会满
+    struct io_uring_sqe &sqe = g_log_uring.sqes[slot];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode    = g_log_uring.fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe.fd        = g_log_uring.file_fd;
+    sqe.addr      = reinterpret_cast< uintptr_t >(buffer.data);
+    sqe.len       = buffer.length;
+    sqe.off       = buffer.offset;
+    sqe.buf_index = static_cast< uint16_t >(g_log_uring.fixed ? index : 0);
+    sqe.user_data = index;
+    g_log_uring.sq_array[slot] = slot;
+    __atomic_store_n(g_log_uring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (LogUringEnter(1, 0, 0) != 1) {
+        // 提交失败时同步写入, 撤销提交队列中的请求
+        __atomic_store_n(g_log_uring.sq_tail, tail, __ATOMIC_RELEASE);
+        PwriteAll(g_log_uring.file_fd, buffer.data, buffer.length, buffer.offset);
+        buffer.length = 0;
+        return;
+    }
+    buffer.busy = 1;
+    g_log_uring.inflight++;
+    g_log_uring.current = (index + 1) % static_cast< uint32_t >(g_log_uring.buffers.size());
+}
+
+// export: 写入一段日志到提交缓冲区, 缓冲区写满时提交, 调用者需要持有日志锁
+void LogUringWriteLocked(const char *data, size_t length)
+{
+    uint32_t size = g_log_uring.size;
+
+    while (length != 0) {
+        LogUringBuffer *buffer = &g_log_uring.buffers[g_log_uring.current];
+        if (buffer->busy) {
+            // 所有缓冲区都在写入, 等待最早的请求完成
+            ReapLogUring();
+            while (buffer->busy && LogUringEnter(0, 1, IORING_ENTER_GETEVENTS) >= 0) {
+                ReapLogUring();
+            }
+        }
+        if (UNLIKELY(buffer->busy)) {
+            // 等待失败时同步写入, 按偏移写入不影响正在写入的请求
+            PwriteAll(g_log_uring.file_fd, data, length, g_log_uring.offset);
+            g_log_uring.offset += length;
+            return;
+        }
+        if (buffer->length == 0) {
+            // 没有正在写入的请求时从文件末尾重新开始, 其他进程追加的内容和copytruncate
+            // 截断之后不会被覆盖或者留下空洞
+            if (g_log_uring.inflight == 0) {
+                off_t end = lseek(g_log_uring.file_fd, 0, SEEK_END);
+                if (end >= 0) {
+                    g_log_uring.offset = static_cast< uint64_t >(end);
+                }
+            }
+            buffer->offset = g_log_uring.offset;
+        }
+
+        size_t copy = std::min(length, static_cast< size_t >(size - buffer->length));
+        memcpy(buffer->data + buffer->length, data, copy);
+        buffer->length += static_cast< uint32_t >(copy);
+        g_log_uring.offset += copy;
+        data += copy;
+        length -= copy;
+        if (buffer->length == size) {
+            SubmitLogUringBuffer();
+        }
+    }
+}
+
+// export: 一批日志输出完时提交缓冲区, 收割已经完成的请求, 不等待, 调用者需要持有日志锁
+void SubmitLogUringLocked()
+{
+    if (!IsLogFileUringActive()) {
+        return;
+    }
+    ReapLogUring();
+    SubmitLogUringBuffer();
+}
+
+// export: 提交缓冲区并等待所有写入完成, 调用者需要持有日志锁
+void WaitLogUringLocked()
+{
+    if (!IsLogFileUringActive()) {
+        return;
+    }
+    ReapLogUring();
+    SubmitLogUringBuffer();
+    while (g_log_uring.inflight != 0 && LogUringEnter(0, 1, IORING_ENTER_GETEVENTS) >= 0) {
+        ReapLogUring();
+    }
+}
+
+// export: 崩溃时同步写入一段日志, 先写入还没有提交的缓冲区, 正在写入的请求由内核完成.
+// 只使用异步信号安全的调用, 调用者需要持有日志锁.
+void LogUringEmergencyWriteLocked(const char *data, size_t length)
+{
+    LogUringBuffer &buffer = g_log_uring.buffers[g_log_uring.current];
+
+    if (!buffer.busy && buffer.length != 0) {
+        PwriteAll(g_log_uring.file_fd, buffer.data, buffer.length, buffer.offset);
+        buffer.length = 0;
+    }
+    PwriteAll(g_log_uring.file_fd, data, length, g_log_uring.offset);
+    g_log_uring.offset += length;
+}
+
+// 释放io_uring实例和缓冲区, 不等待正在写入的请求
+static void ReleaseLogUring()
+{
+    if (g_log_uring.sqes != nullptr) {
+        munmap(g_log_uring.sqes, g_log_uring.sqes_size);
+    }
+    if (g_log_uring.cq_ring != nullptr && g_log_uring.cq_ring != g_log_uring.sq_ring) {
+        munmap(g_log_uring.cq_ring, g_log_uring.cq_ring_size);
+    }
+    if (g_log_uring.sq_ring != nullptr) {
+        munmap(g_log_uring.sq_ring, g_log_uring.sq_ring_size);
+    }
+    if (g_log_uring.ring_fd >= 0) {
+        close(g_log_uring.ring_fd);
+    }
+    if (g_log_uring.file_fd >= 0) {
+        close(g_log_uring.file_fd);
+    }
+    free(g_log_uring.memory);
+    g_log_uring = {-1, -1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, 0, 0, 0, nullptr, {}};
+}
+
+// 映射提交队列和完成队列
+static bool MapLogUring(const struct io_uring_params &params)
+{
+    g_log_uring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    g_log_uring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    g_log_uring.sqes_size    = params.sq_entries * sizeof(io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        g_log_uring.sq_ring_size = std::max(g_log_uring.sq_ring_size, g_log_uring.cq_ring_size);
+        g_log_uring.cq_ring_size = g_log_uring.sq_ring_size;
+    }
+
+    void *sq = mmap(nullptr, g_log_uring.sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, g_log_uring.ring_fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        return false;
+    }
+    g_log_uring.sq_ring = sq;
+
+    void *cq = sq;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq = mmap(nullptr, g_log_uring.cq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, g_log_uring.ring_fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            return false;
+        }
+    }
+    g_log_uring.cq_ring = cq;
+
+    void *sqes = mmap(nullptr, g_log_uring.sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, g_log_uring.ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    g_log_uring.sqes = static_cast< struct io_uring_sqe * >(sqes);
+
+    char *sq_base        = static_cast< char * >(sq);
+    char *cq_base        = static_cast< char * >(cq);
+    g_log_uring.sq_tail  = reinterpret_cast< uint32_t * >(sq_base + params.sq_off.tail);
+    g_log_uring.sq_mask  = reinterpret_cast< uint32_t * >(sq_base + params.sq_off.ring_mask);
+    g_log_uring.sq_array = reinterpret_cast< uint32_t * >(sq_base + params.sq_off.array);
+    g_log_uring.cq_head  = reinterpret_cast< uint32_t * >(cq_base + params.cq_off.head);
+    g_log_uring.cq_tail  = reinterpret_cast< uint32_t * >(cq_base + params.cq_off.tail);
+    g_log_uring.cq_mask  = reinterpret_cast< uint32_t * >(cq_base + params.cq_off.ring_mask);
+    g_log_uring.cqes = reinterpret_cast< struct io_uring_cqe * >(cq_base + params.cq_off.cqes);
+    return true;
+}
+
+// 进程退出时等待正在写入的请求完成, 关闭io_uring实例时内核会取消还没有开始的请求
+static void WaitLogUringAtExit()
+{
+    std::unique_lock< std::mutex > lock = LockLogOutput();
+    WaitLogUringLocked();
+}
+
+// export: 为新打开的日志文件创建io_uring实例, 不可用时返回false, 日志文件继续使用write()写入.
+// 调用者需要持有日志锁.
+bool OpenLogUring(const FilePath &path, int log_fd)
+{
+    static bool g_log_uring_atexit = false;
+
+    uint32_t               count = g_log_uring_buffers;
+    struct io_uring_params params;
+
+    if (count == 0) {
+        return false;
+    }
+    off_t offset = lseek(log_fd, 0, SEEK_END);
+    if (offset < 0) {
+        return false;
+    }
+
+    memset(&params, 0, sizeof(params));
+    g_log_uring.ring_fd = LogUringSetup(count, &params);
+    if (g_log_uring.ring_fd < 0 || params.sq_entries < count || !MapLogUring(params)) {
+        ReleaseLogUring();
+        return false;
+    }
+    size_t size = g_log_uring_buffer_size;
+    void  *memory;
+    if (posix_memalign(&memory, 4096, count * size) != 0) {
+        ReleaseLogUring();
+        return false;
+    }
+    g_log_uring.memory = static_cast< char * >(memory);
+    HANDLE_EINTR(g_log_uring.file_fd, open(path.c_str(), O_WRONLY | O_CLOEXEC));
+    if (g_log_uring.file_fd < 0) {
+        ReleaseLogUring();
+        return false;
+    }
+
+    std::vector< struct iovec > iovecs(count);
+    g_log_uring.buffers.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        LogUringBuffer &buffer = g_log_uring.buffers[i];
+        buffer.data            = g_log_uring.memory + i * size;
+        buffer.offset          = 0;
+        buffer.length          = 0;
+        buffer.busy            = 0;
+        iovecs[i].iov_base     = buffer.data;
+        iovecs[i].iov_len      = size;
+    }
+    // 注册固定缓冲区省去每次写入时的页面映射, 受RLIMIT_MEMLOCK限制, 失败时使用普通写入
+    g_log_uring.fixed  = LogUringRegister(IORING_REGISTER_BUFFERS, iovecs.data(), count) == 0;
+    g_log_uring.offset = static_cast< uint64_t >(offset);
+    g_log_uring.size   = static_cast< uint32_t >(size);
+    g_log_uring_active.store(true, std::memory_order_relaxed);
+    if (!g_log_uring_atexit) {
+        atexit(WaitLogUringAtExit);
+        g_log_uring_atexit = true;
+    }
+    return true;
+}
+
+// export: 等待所有写入完成并释放io_uring实例, 调用者需要持有日志锁
+void CloseLogUring()
+{
+    if (!IsLogFileUringActive()) {
+        return;
+    }
+    WaitLogUringLocked();
+    g_log_uring_active.store(false, std::memory_order_relaxed);
+    ReleaseLogUring();
+}
+
+// export: fork之后在子进程中调用, io_uring实例和父进程共享, 子进程不等待父进程的写入,
+// 只释放自己的映射和文件描述符, 日志文件回到write()写入. 父进程继续使用io_uring,
+// 没有正在写入的请求时从文件末尾继续写入, 不覆盖子进程追加的日志
+void ResetLogUringAfterFork()
+{
+    if (!IsLogFileUringActive()) {
+        return;
+    }
+    g_log_uring_active.store(false, std::memory_order_relaxed);
+    ReleaseLogUring();
+}
+
+#else
+
+void LogUringWriteLocked(const char *data, size_t length)
+{
+    (void)data;
+    (void)length;
+}
+
+void SubmitLogUringLocked() { }
+
+void WaitLogUringLocked() { }
+
+void LogUringEmergencyWriteLocked(const char *data, size_t length)
+{
+    (void)data;
+    (void)length;
+}
+
+// 没有io_uring时总是使用write()写入日志文件
+bool OpenLogUring(const FilePath &path, int log_fd)
+{
+    (void)path;
+    (void)log_fd;
+    return false;
+}
+
+void CloseLogUring() { }
+
+void ResetLogUringAfterFork() { }
+
+#endif    // EASELOG_HAVE_IO_URING
+
+}    // namespace logging
@@ -0,0 +1,212 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/log/easelog_vlog.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 10:12
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  实现VLOG详细日志等级和按模块(vmodule)配置的详细日志等级.
+ *
+ */
+
+#include "log/easelog.h"
+#include "log/easelog_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace logging {
+
+// VLOG配置代数, 每次配置变化时递增, 调用点缓存的代数不一致时重新解析.
+// 从1开始, 这样零初始化的调用点状态总是无效的.
+std::atomic< uint32_t > g_vlog_generation(1);
+
+// 单条vmodule匹配规则
+struct VmodulePattern {
+    std::string pattern;
+    int32_t     verbose_level;
+    // 是否匹配完整路径, 规则中包含路径分隔符时使用完整路径匹配
+    bool        match_full_path;
+    uint8_t     __pad[3];
+};
+
+// 保护vmodule规则列表, 同时保证调用点解析和配置代数的一致性
+static std::mutex                    g_vlog_mutex;
+static std::vector< VmodulePattern > g_vmodule_patterns;
+
+// Given a file path like "/foo/bar/baz-inl.cc", returns the module name
+// "baz", i.e. the file name without directory, extension and "-inl" suffix.
+static std::string GetVlogModuleName(const char *file)
+{
+    const char *base = strrchr(file, '/');
+    std::string module(base ? base + 1 : file);
+
+    size_t dot = module.find('.');
+    if (dot != std::string::npos) {
+        module.resize(dot);
+    }
+
+    static const char kInlSuffix[] = "-inl";
+    size_t            suffix_len   = sizeof(kInlSuffix) - 1;
+    if (module.size() > suffix_len &&
+        module.compare(module.size() - suffix_len, suffix_len, kInlSuffix) == 0) {
+        module.resize(module.size() - suffix_len);
+    }
+    return module;
+}
+
+// export: 通配符匹配, 支持'*'(任意多个字符)和'?'(单个字符), 其余字符按字面比较.
+// 采用回溯最近一个'*'的贪心算法, 最坏复杂度O(m*n), 不会递归.
+bool MatchVlogPattern(const char *string, const char *pattern)
+{
+    const char *star_pattern = nullptr;
+    const char *star_string  = nullptr;
+
+    while (*string != '\0') {
+        if (*pattern == '*') {
+            star_pattern = ++pattern;
+            star_string  = string;
+        } else if (*pattern == '?' || *pattern == *string) {
+            pattern++;
+            string++;
+        } else if (star_pattern != nullptr) {
+            pattern = star_pattern;
+            string  = ++star_string;
+        } else {
+            return false;
+        }
+    }
+
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
+
+// 解析vmodule字符串, 格式为"pattern=N,pattern=N", 非法规则直接忽略
+static std::vector< VmodulePattern > ParseVmodule(const char *vmodule)
+{
+    std::vector< VmodulePattern > patterns;
+    std::string                   spec(vmodule ? vmodule : "");
+    size_t                        start = 0;
+
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+
+        std::string item(spec, start, end - start);
+        size_t      equal = item.rfind('=');
+        start             = end + 1;
+        if (equal == std::string::npos || equal == 0 || equal + 1 == item.size()) {
+            continue;
+        }
+
+        char *level_end = nullptr;
+        long  level     = strtol(item.c_str() + equal + 1, &level_end, 10);
+        if (*level_end != '\0') {
+            continue;
+        }
+
+        VmodulePattern entry;
+        entry.pattern         = item.substr(0, equal);
+        entry.verbose_level   = static_cast< int32_t >(level);
+        entry.match_full_path = entry.pattern.find_first_of("\\/") != std::string::npos;
+        patterns.push_back(entry);
+    }
+    return patterns;
+}
+
+// 计算文件的详细日志等级, 调用者需要持有g_vlog_mutex
+static int32_t GetVlogLevelLocked(const char *file)
+{
+    if (!g_vmodule_patterns.empty()) {
+        std::string module = GetVlogModuleName(file);
+        for (const VmodulePattern &entry : g_vmodule_patterns) {
+            const char *target = entry.match_full_path ? file : module.c_str();
+            if (MatchVlogPattern(target, entry.pattern.c_str())) {
+                return entry.verbose_level;
+            }
+        }
+    }
+
+    // 没有匹配的规则, 使用最小日志等级对应的默认详细日志等级
+    return -GetMinLogLevel();
+}
+
+// export: 使所有调用点的缓存失效, 下次调用时重新解析
+void InvalidateVlogCallSites()
+{
+    std::lock_guard< std::mutex > lock(g_vlog_mutex);
+    g_vlog_generation.fetch_add(1, std::memory_order_release);
+}
+
+// export: 调用点缓存失效时的慢路径, 解析结果和当前配置代数一起写回调用点
+bool VlogIsOnSlow(VlogCallSite &site, int32_t verbose_level)
+{
+    std::lock_guard< std::mutex > lock(g_vlog_mutex);
+    LogTestDelay(LOG_TEST_POINT_VLOG);
+
+    uint32_t generation = g_vlog_generation.load(std::memory_order_relaxed);
+    int32_t  level      = GetVlogLevelLocked(site.file);
+
+    // 实时订阅期间, 匹配的调用点使用订阅者要求的详细日志等级
+    if (UNLIKELY(IsLogTailActive())) {
+        level = std::max(level, GetLogTailVlogLevel(site.file));
+    }
+
+    site.state.store(static_cast< uint64_t >(generation) << 32 | static_cast< uint32_t >(level),
+        std::memory_order_relaxed);
+    return verbose_level <= level;
+}
+
+// export: 获取文件对应的详细日志等级
+int32_t GetVlogLevel(const char *file)
+{
+    std::lock_guard< std::mutex > lock(g_vlog_mutex);
+    return GetVlogLevelLocked(file);
+}
+
+// export: 设置默认详细日志等级, 等价于把最小日志等级设置为对应的负数
+void SetVlogLevel(int32_t verbose_level)
+{
+    SetMinLogLevel(-verbose_level);
+}
+
+// export: 设置按模块配置的详细日志等级
+void SetVmodule(const char *vmodule)
+{
+    std::vector< VmodulePattern > patterns = ParseVmodule(vmodule);
+
+    std::lock_guard< std::mutex > lock(g_vlog_mutex);
+    g_vmodule_patterns.swap(patterns);
+    g_vlog_generation.fetch_add(1, std::memory_order_release);
+}
+
+// 日志初始化时加载vmodule配置
+void MaybeInitializeVlogInfo(const char *vmodule)
+{
+    if (vmodule != nullptr) {
+        SetVmodule(vmodule);
+    }
+}
+
+// export: fork之后在子进程中调用, vmodule规则锁可能被fork时的其他线程持有
+void ResetVlogAfterFork()
+{
+    new (&g_vlog_mutex) std::mutex();
+    InvalidateVlogCallSites();
+}
+
+}    // namespace logging
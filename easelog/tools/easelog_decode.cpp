@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/tools/easelog_decode.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 20:15
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  命令行工具, 并行解码二进制日志文件, 输出文本或者JSON. 压缩的日志文件先解压.
+ *
+ */
+
+#include "log/easelog.h"
+#include "tools/easelog_options.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace logging;
+
+static void Usage(const char *program)
+{
+    fprintf(stderr,
+        "usage: %s [-b begin] [-e end] [-s severities] [-j] [-t threads] [-v] file\n"
+        "  -b, -e  time range [begin, end), local time \"YYYY-MM-DDTHH:MM:SS[.uuuuuu]\"\n"
+        "          or \"@seconds\" since the epoch, default unbounded\n"
+        "  -s      comma separated severity names, eg. \"warning,error\", default all\n"
+        "  -j      output one JSON object per line instead of text\n"
+        "  -t      decoding threads, default one per CPU\n"
+        "  -v      print decoding statistics to stderr\n"
+        "  file    binary log file, or compressed log file; compressed text files are\n"
+        "          printed as is, without filtering\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    LogDecodeOptions options = {0, UINT64_MAX, LOG_SEVERITY_MASK_ALL, LOG_DECODE_TEXT, 0, 0};
+    bool             verbose = false;
+    LogDecodeStats   stats;
+    int              opt;
+
+    while ((opt = getopt(argc, argv, "b:e:s:jt:vh")) != -1) {
+        switch (opt) {
+        case 'b':
+            if (!ParseTime(optarg, &options.begin_us)) {
+                fprintf(stderr, "invalid begin time: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'e':
+            if (!ParseTime(optarg, &options.end_us)) {
+                fprintf(stderr, "invalid end time: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 's':
+            if (!ParseSeverities(optarg, &options.severity_mask)) {
+                fprintf(stderr, "invalid severities: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'j':
+            options.output = LOG_DECODE_JSON;
+            break;
+        case 't':
+            options.threads = static_cast< uint32_t >(strtoul(optarg, nullptr, 10));
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    bool ok = DecodeLogFile(argv[optind], options,
+        [](const char *data, size_t length) { fwrite(data, 1, length, stdout); }, &stats);
+    if (!ok) {
+        fprintf(stderr, "can't decode %s\n", argv[optind]);
+        return 1;
+    }
+    if (verbose) {
+        fprintf(stderr,
+            "%lu records, %lu blocks decoded, %lu skipped, %lu frames skipped, "
+            "%lu of %lu bytes corrupt\n",
+            static_cast< unsigned long >(stats.records),
+            static_cast< unsigned long >(stats.blocks),
+            static_cast< unsigned long >(stats.skipped_blocks),
+            static_cast< unsigned long >(stats.skipped_frames),
+            static_cast< unsigned long >(stats.corrupt_bytes),
+            static_cast< unsigned long >(stats.file_bytes));
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/tools/easelog_options.h
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 20:10
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  命令行工具共用的参数解析, 时间范围和日志等级.
+ *
+ */
+
+#ifndef EASELOG_TOOLS_OPTIONS_H_
+#define EASELOG_TOOLS_OPTIONS_H_
+
+#include "log/easelog.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+namespace logging {
+
+// 解析时间参数, 返回us, 格式错误时返回false
+static bool ParseTime(const char *text, uint64_t *time_us)
+{
+    struct tm local_time;
+    int       usec = 0;
+
+    if (text[0] == '@') {
+        char  *end;
+        double seconds = strtod(text + 1, &end);
+        if (*end != '\0' || seconds < 0) {
+            return false;
+        }
+        *time_us = static_cast< uint64_t >(seconds * 1000000.0);
+        return true;
+    }
+
+    memset(&local_time, 0, sizeof(local_time));
+    const char *rest = strptime(text, "%Y-%m-%dT%H:%M:%S", &local_time);
+    if (rest == nullptr) {
+        return false;
+    }
+    // 小数部分最多6位, 不足6位时补齐
+    if (*rest == '.') {
+        int digits = 0;
+        for (rest++; *rest >= '0' && *rest <= '9' && digits < 6; rest++, digits++) {
+            usec = usec * 10 + (*rest - '0');
+        }
+        for (; digits < 6; digits++) {
+            usec *= 10;
+        }
+    }
+    if (*rest != '\0') {
+        return false;
+    }
+    local_time.tm_isdst = -1;
+    time_t t            = mktime(&local_time);
+    if (t < 0) {
+        return false;
+    }
+    *time_us = static_cast< uint64_t >(t) * 1000000 + static_cast< uint64_t >(usec);
+    return true;
+}
+
+// 解析逗号分隔的日志等级名字
+static bool ParseSeverities(const char *text, uint32_t *severity_mask)
+{
+    const LoggingSettings &settings = GetLoggingSettings();
+    std::string            names(text);
+    size_t                 start = 0;
+
+    *severity_mask = 0;
+    while (start <= names.size()) {
+        size_t      end  = names.find(',', start);
+        std::string name = names.substr(start, end == std::string::npos ? end : end - start);
+        LogSeverity severity;
+        for (severity = 0; severity < LOGGING_NUM_SEVERITIES; severity++) {
+            if (name == settings.log_severity_names[severity]) {
+                break;
+            }
+        }
+        if (severity == LOGGING_NUM_SEVERITIES) {
+            return false;
+        }
+        *severity_mask |= LogSeverityMask(severity);
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+}    // namespace logging
+
+#endif    // EASELOG_TOOLS_OPTIONS_H_
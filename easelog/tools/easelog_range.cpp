@@ -0,0 +1,92 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/tools/easelog_range.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 18:30
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  命令行工具, 使用日志文件的时间索引输出指定时间范围和日志等级的日志.
+ *
+ */
+
+#include "log/easelog.h"
+#include "tools/easelog_options.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace logging;
+
+static void Usage(const char *program)
+{
+    fprintf(stderr,
+        "usage: %s [-b begin] [-e end] [-s severities] [-v] file\n"
+        "  -b, -e  time range [begin, end), local time \"YYYY-MM-DDTHH:MM:SS[.uuuuuu]\"\n"
+        "          or \"@seconds\" since the epoch, default unbounded\n"
+        "  -s      comma separated severity names, eg. \"warning,error\", default all\n"
+        "  -v      print index statistics to stderr\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t      begin_us      = 0;
+    uint64_t      end_us        = UINT64_MAX;
+    uint32_t      severity_mask = LOG_SEVERITY_MASK_ALL;
+    bool          verbose       = false;
+    LogRangeStats stats;
+    int           opt;
+
+    while ((opt = getopt(argc, argv, "b:e:s:vh")) != -1) {
+        switch (opt) {
+        case 'b':
+            if (!ParseTime(optarg, &begin_us)) {
+                fprintf(stderr, "invalid begin time: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'e':
+            if (!ParseTime(optarg, &end_us)) {
+                fprintf(stderr, "invalid end time: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 's':
+            if (!ParseSeverities(optarg, &severity_mask)) {
+                fprintf(stderr, "invalid severities: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    bool ok = ReadLogFileRange(argv[optind], begin_us, end_us, severity_mask,
+        [](const char *line, size_t length) { fwrite(line, 1, length, stdout); }, &stats);
+    if (!ok) {
+        fprintf(stderr, "can't read %s\n", argv[optind]);
+        return 1;
+    }
+    if (verbose) {
+        fprintf(stderr, "%lu lines, scanned %lu of %lu bytes, %lu index entries\n",
+            static_cast< unsigned long >(stats.lines),
+            static_cast< unsigned long >(stats.scanned_bytes),
+            static_cast< unsigned long >(stats.file_bytes),
+            static_cast< unsigned long >(stats.index_entries));
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2024 Once Day <once_day@qq.com>, All rights reserved.
+ *
+ * @FilePath: /easelog/tools/easelog_tail.cpp
+ * @Author: Once Day <once_day@qq.com>.
+ * @Date: 2026-10-18 21:40
+ * @info: Encoder=utf-8,Tabsize=4,Eol=\n.
+ *
+ * @Description:
+ *  命令行工具, 连接进程的实时订阅套接字, 按照过滤条件输出日志.
+ *
+ */
+
+#include "log/easelog.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+
+using namespace logging;
+
+static void Usage(const char *program)
+{
+    fprintf(stderr,
+        "usage: %s [-s severity] [-f file] [-F func] [-t thread] socket\n"
+        "  -s      lowest severity, eg. \"debug\" or \"verbose2\", default debug\n"
+        "  -f, -F  file name and function name patterns, '*' and '?' wildcards\n"
+        "  -t      thread name pattern, or thread ID\n"
+        "  socket  path given to StartLogTail(), '@' for the abstract namespace\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string filter;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "s:f:F:t:h")) != -1) {
+        switch (opt) {
+        case 's':
+            filter += std::string(" severity=") + optarg;
+            break;
+        case 'f':
+            filter += std::string(" file=") + optarg;
+            break;
+        case 'F':
+            filter += std::string(" func=") + optarg;
+            break;
+        case 't':
+            filter += std::string(" thread=") + optarg;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    int fd = ConnectLogTail(argv[optind], filter.c_str());
+    if (fd < 0) {
+        fprintf(stderr, "can't subscribe to %s\n", argv[optind]);
+        return 1;
+    }
+
+    char    buffer[4096];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+        fwrite(buffer, 1, static_cast< size_t >(size), stdout);
+        fflush(stdout);
+    }
+    close(fd);
+    return 0;
+}